@@ -0,0 +1,98 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "meshAdjacency.h"
+#include "tagIndexMap.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// the original path: one getElementsByCoordinates call per boundary segment midpoint,
+// the element tags found are turned into block positions like EdgeAdjacency returns
+void probeMidpoints(const vector<int>& curves, const vector<double>& coord, const TagIndexMap& nodeIndex, const TagIndexMap& elementIndex, vector<int>& elementsIds)
+{
+  vector<int> elementTypes;
+  vector<vector<size_t> > elementTags, nodeTags;
+  vector<size_t> elementTag;
+  for(int i = 0; i < curves.size(); i++)
+  {
+    gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags, 1, abs(curves[i]));
+    for(int k = 0; k < nodeTags[0].size(); k += 2)
+    {
+      size_t id1 = nodeIndex.find(nodeTags[0][k]), id2 = nodeIndex.find(nodeTags[0][k+1]);
+      double xx = (coord[3*id1] + coord[3*id2])/2.0;
+      double yy = (coord[3*id1+1] + coord[3*id2+1])/2.0;
+      double zz = (coord[3*id1+2] + coord[3*id2+2])/2.0;
+      gmsh::model::mesh::getElementsByCoordinates(xx, yy, zz, elementTag, 2, true);
+      for(int kk = 0; kk < elementTag.size(); kk++)
+      {
+        elementsIds.push_back(elementIndex.find(elementTag[kk]));
+      }
+    }
+  }
+}
+
+
+// usage: adjacencyBenchmark [levels]
+// every level halves boundaryLc and holeLc, so the element count grows about 4x
+int main(int argc, char **argv)
+{
+  int levels = argc > 1 ? atoi(argv[1]) : 5;
+  gmsh::initialize();
+
+  cout<<"elements  segments  probe(s)  build(s)  lookup(s)  speedup  same"<<endl;
+  double boundaryLc = 1, holeLc = 0.4;
+  for(int level = 0; level < levels; level++)
+  {
+    gmsh::model::add("adjacency" + to_string(level));
+    vector<int> boundaryCurves;
+    vector<vector<int> > holesCurves;
+    buildTwoDGeometry(boundaryLc, holeLc, boundaryCurves, holesCurves);
+    gmsh::model::geo::synchronize();
+    gmsh::model::mesh::generate(2);
+
+    vector<size_t> nodeTags;
+    vector<double> coord, parametricCoord;
+    gmsh::model::mesh::getNodes(nodeTags, coord, parametricCoord, -1, -1, false, false);
+    vector<int> elementTypes;
+    vector<vector<size_t> > elementTags, nodeTagss;
+    gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTagss, 2, -1);
+
+    vector<int> allCurves = boundaryCurves;
+    for(int h = 0; h < holesCurves.size(); h++)
+    {
+      allCurves.insert(allCurves.end(), holesCurves[h].begin(), holesCurves[h].end());
+    }
+
+    TagIndexMap nodeIndex, elementIndex;
+    nodeIndex.build(nodeTags);
+    elementIndex.build(elementTags[0]);
+
+    auto t0 = chrono::steady_clock::now();
+    vector<int> probeIds;
+    probeMidpoints(allCurves, coord, nodeIndex, elementIndex, probeIds);
+    auto t1 = chrono::steady_clock::now();
+    EdgeAdjacency adjacency;
+    adjacency.build(nodeTagss[0], elementTypes[0]);
+    auto t2 = chrono::steady_clock::now();
+    vector<int> tableIds;
+    adjacency.getElementsOnCurves(allCurves, tableIds);
+    auto t3 = chrono::steady_clock::now();
+
+    bool same = probeIds == tableIds;
+    double probe = seconds(t0, t1), table = seconds(t1, t3);
+    cout<<elementTags[0].size()<<"  "<<tableIds.size()<<"  "<<probe<<"  "<<seconds(t1, t2)<<"  "<<seconds(t2, t3)
+        <<"  "<<(table > 0 ? probe/table : 0)<<"  "<<(same ? "yes" : "no")<<endl;
+
+    gmsh::model::remove();
+    boundaryLc /= 2;
+    holeLc /= 2;
+  }
+
+  gmsh::finalize();
+  return 0;
+}
@@ -0,0 +1,99 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <cstdlib>
+#include "meshData.h"
+#include "sparsityPattern.h"
+#include "stiffnessAssembly.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// n x n grid of the unit square cut in 2 n^2 triangles, the nodes are moved a
+// little so the element matrices are not all the same
+void generate(size_t n, MeshData& mesh)
+{
+  size_t np = n + 1;
+  vector<size_t> nodeTags(np*np);
+  vector<double> coord(3*np*np);
+  srand(1);
+  for(size_t i = 0; i < nodeTags.size(); i++)
+  {
+    double shift = 0.2 * ((double)rand() / RAND_MAX - 0.5);
+    nodeTags[i] = i + 1;
+    coord[3*i] = ((double)(i % np) + shift) / n;
+    coord[3*i+1] = ((double)(i / np) - shift) / n;
+    coord[3*i+2] = 0;
+  }
+  mesh.setNodes(nodeTags, coord);
+  vector<size_t> elementTags, triNodeTags;
+  for(size_t c = 0; c < n*n; c++)
+  {
+    size_t a = c / n * np + c % n, b = a + 1, d = a + np, e = d + 1;
+    size_t q[6] = {a, b, e, a, e, d};
+    for(int k = 0; k < 6; k++)
+    {
+      triNodeTags.push_back(q[k] + 1);
+    }
+    elementTags.push_back(elementTags.size() + 1);
+    elementTags.push_back(elementTags.size() + 1);
+  }
+  mesh.addBlock(TRIANGLE, elementTags, triNodeTags);
+}
+
+
+// usage: assemblyBenchmark [n] [maxThreads] [reps]
+int main(int argc, char **argv)
+{
+  size_t n = argc > 1 ? atol(argv[1]) : 1000;
+  int maxThreads = argc > 2 ? atoi(argv[2]) : getNumThreads();
+  int reps = argc > 3 ? atoi(argv[3]) : 3;
+  MeshData mesh;
+  generate(n, mesh);
+  const ElementBlock& triangles = mesh.getBlock(0);
+  SparsityPattern pattern;
+  pattern.build(triangles, mesh.getNumNodes());
+
+  auto t0 = chrono::steady_clock::now();
+  ElementColouring colouring;
+  colouring.build(triangles, mesh.getNumNodes());
+  auto t1 = chrono::steady_clock::now();
+  cout<<triangles.size()<<" triangles, "<<colouring.getNumColours()<<" colours of "<<colouring.getChunkSize()<<" element chunks in "<<seconds(t0, t1)<<"s"<<endl;
+
+  vector<double> reference, values;
+  double serial = 1e30;
+  for(int r = 0; r < reps; r++)
+  {
+    t0 = chrono::steady_clock::now();
+    assembleStiffnessSerial(mesh, triangles, pattern, reference);
+    serial = min(serial, seconds(t0, chrono::steady_clock::now()));
+  }
+  cout<<"serial reference: "<<triangles.size() / serial<<" elements/s"<<endl;
+
+  double scale = 0;
+  for(size_t i = 0; i < reference.size(); i++)
+  {
+    scale = max(scale, fabs(reference[i]));
+  }
+  // 1, 2, 4, ... threads, and maxThreads
+  for(int t = 1; t <= maxThreads; t = (t < maxThreads && 2 * t > maxThreads) ? maxThreads : 2 * t)
+  {
+    double best = 1e30;
+    for(int r = 0; r < reps; r++)
+    {
+      t0 = chrono::steady_clock::now();
+      assembleStiffness(mesh, triangles, colouring, pattern, values, t);
+      best = min(best, seconds(t0, chrono::steady_clock::now()));
+    }
+    double error = 0;
+    for(size_t i = 0; i < values.size(); i++)
+    {
+      error = max(error, fabs(values[i] - reference[i]));
+    }
+    cout<<t<<" threads: "<<triangles.size() / best<<" elements/s, speedup "<<serial / best
+        <<", largest difference to the reference "<<error / scale<<endl;
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "batchMesher.h"
+#include "meshData.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// n small cases: a random quadrilateral with a square hole
+void makeCases(size_t n, vector<PolygonRecord>& cases)
+{
+  srand(1);
+  cases.resize(n);
+  for(size_t i = 0; i < n; i++)
+  {
+    PolygonRecord& c = cases[i];
+    c.clear();
+    c.setName("case_" + to_string(i));
+    vector<double>& outer = c.addRing();
+    double sx[4] = {0, 1, 1, 0}, sy[4] = {0, 0, 1, 1};
+    for(int k = 0; k < 4; k++)
+    {
+      outer.push_back(4 * sx[k] + 0.5 * rand() / RAND_MAX);
+      outer.push_back(4 * sy[k] + 0.5 * rand() / RAND_MAX);
+      outer.push_back(0);
+    }
+    vector<double>& hole = c.addRing();
+    double h = 0.5 + 1.0 * rand() / RAND_MAX;
+    for(int k = 0; k < 4; k++)
+    {
+      hole.push_back(2 + h * (sx[k] - 0.5));
+      hole.push_back(2 + h * (sy[k] - 0.5));
+      hole.push_back(0);
+    }
+  }
+}
+
+
+// usage: batchMeshBenchmark [cases] [lc] [workers]
+// one gmsh::initialize / finalize per case, as the demos do, against the batch
+// mesher on 1 and on workers long-lived processes, without output files
+int main(int argc, char **argv)
+{
+  size_t n = argc > 1 ? atol(argv[1]) : 1000;
+  double lc = argc > 2 ? atof(argv[2]) : 0.5;
+  int numWorkers = argc > 3 ? atoi(argv[3]) : 4;
+  vector<PolygonRecord> cases;
+  makeCases(n, cases);
+
+  auto t0 = chrono::steady_clock::now();
+  for(size_t i = 0; i < n; i++)
+  {
+    gmsh::initialize();
+    gmsh::option::setNumber("General.Terminal", 0);
+    gmsh::model::add("case");
+    vector<PolygonRecord> one(1, cases[i]);
+    GmshPolygonSink sink(lc);
+    sink.addBatch(one, 1);
+    sink.finish();
+    gmsh::model::mesh::generate(2);
+    MeshData mesh;
+    mesh.loadFromGmsh(2);
+    gmsh::finalize();
+  }
+  auto t1 = chrono::steady_clock::now();
+  double reference = n / seconds(t0, t1);
+  cout<<"initialize per case: "<<reference<<" cases/s"<<endl;
+
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 0);
+  for(int workers = 1; ; workers = min(2 * workers, numWorkers))
+  {
+    BatchMesher mesher(workers, lc);
+    if(!mesher.run(cases))
+    {
+      cout<<mesher.getError()<<endl;
+      break;
+    }
+    mesher.printReport(cout);
+    cout<<mesher.getCasesPerSecond() / reference<<"x initialize per case"<<endl;
+    if(workers >= numWorkers)
+      break;
+  }
+  gmsh::finalize();
+  return 0;
+}
@@ -0,0 +1,93 @@
+#ifndef BENCHMARK_UTILS_H
+#define BENCHMARK_UTILS_H
+
+#include <gmsh.h>
+#include <vector>
+#include <chrono>
+
+
+// helpers shared by the benchmark programs
+
+
+inline double seconds(std::chrono::steady_clock::time_point s, std::chrono::steady_clock::time_point e)
+{
+  return std::chrono::duration<double>(e - s).count();
+}
+
+// seconds since s
+inline double seconds(std::chrono::steady_clock::time_point s)
+{
+  return seconds(s, std::chrono::steady_clock::now());
+}
+
+// twoDExample.cpp: the rectangle [0,5]x[0,4] with two square holes, not synchronized;
+// the curves of the boundary and of every hole are appended to boundaryCurves / holesCurves
+inline void buildTwoDGeometry(double boundaryLc, double holeLc, std::vector<int>& boundaryCurves, std::vector<std::vector<int> >& holesCurves)
+{
+  double bx[5] = {0, 5, 5, 0, 0}, by[5] = {0, 0, 4, 4, 2};
+  double hx[2][4] = {{1, 2, 2, 1}, {3, 4, 4, 3}}, hy[4] = {1, 1, 2, 2};
+  std::vector<int> loop, curves, planeSurface;
+  for(int i = 0; i < 5; i++)
+  {
+    loop.push_back(gmsh::model::geo::addPoint(bx[i], by[i], 0, boundaryLc));
+  }
+  for(size_t i = 0; i < loop.size(); i++)
+  {
+    curves.push_back(gmsh::model::geo::addLine(loop[i], loop[(i+1)%loop.size()]));
+  }
+  boundaryCurves.insert(boundaryCurves.end(), curves.begin(), curves.end());
+  planeSurface.push_back(gmsh::model::geo::addCurveLoop(curves));
+  for(int h = 0; h < 2; h++)
+  {
+    loop.clear();
+    curves.clear();
+    for(int i = 0; i < 4; i++)
+    {
+      loop.push_back(gmsh::model::geo::addPoint(hx[h][i], hy[i], 0, holeLc));
+    }
+    for(size_t i = 0; i < loop.size(); i++)
+    {
+      curves.push_back(gmsh::model::geo::addLine(loop[i], loop[(i+1)%loop.size()]));
+    }
+    planeSurface.push_back(-gmsh::model::geo::addCurveLoop(curves));
+    holesCurves.push_back(curves);
+  }
+  gmsh::model::geo::addPlaneSurface(planeSurface);
+}
+
+inline void buildTwoDGeometry(double boundaryLc, double holeLc)
+{
+  std::vector<int> boundaryCurves;
+  std::vector<std::vector<int> > holesCurves;
+  buildTwoDGeometry(boundaryLc, holeLc, boundaryCurves, holesCurves);
+}
+
+// threeDDemo.cpp: the cube [-4,4]^3, not synchronized
+inline void buildCubeGeometry(double lc)
+{
+  for(int i = 0; i < 8; i++)
+  {
+    double x = (i%4 == 0 || i%4 == 3) ? -4 : 4, y = (i%4 < 2) ? -4 : 4, z = i < 4 ? -4 : 4;
+    gmsh::model::geo::addPoint(x, y, z, lc, i+1);
+  }
+  for(int i = 0; i < 4; i++)
+  {
+    gmsh::model::geo::addLine(i+1, (i+1)%4+1, i+1);
+    gmsh::model::geo::addLine(i+5, (i+1)%4+5, i+5);
+    gmsh::model::geo::addLine(i+1, i+5, i+9);
+  }
+  gmsh::model::geo::addCurveLoop({1, 2, 3, 4}, 1);
+  gmsh::model::geo::addCurveLoop({5, 6, 7, 8}, 2);
+  gmsh::model::geo::addCurveLoop({1, 10, -5, -9}, 3);
+  gmsh::model::geo::addCurveLoop({2, 11, -6, -10}, 4);
+  gmsh::model::geo::addCurveLoop({3, 12, -7, -11}, 5);
+  gmsh::model::geo::addCurveLoop({-4, 12, 8, -9}, 6);
+  for(int i = 1; i <= 6; i++)
+  {
+    gmsh::model::geo::addPlaneSurface({i}, i);
+  }
+  gmsh::model::geo::addSurfaceLoop({1, 2, 3, 4, 5, 6}, 1);
+  gmsh::model::geo::addVolume({1}, 1);
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include <iostream>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "boundaryLoops.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// one circle of n segments and numHoles small circles inside it, segments shuffled
+// and every other one flipped, like the line elements of several curves in no order
+void generate(size_t n, int numHoles, MeshData& mesh, vector<unsigned int>& segments)
+{
+  vector<size_t> tags;
+  vector<double> xyz;
+  segments.clear();
+  size_t first = 0;
+  for(int h = 0; h <= numHoles; h++)
+  {
+    size_t m = h == 0 ? n : n / 10;
+    double r = h == 0 ? 1 : 0.02, cx = h == 0 ? 0 : -0.5 + (double)h / (numHoles + 1), cy = 0;
+    for(size_t i = 0; i < m; i++)
+    {
+      tags.push_back(tags.size() + 1);
+      xyz.push_back(cx + r * cos(2 * M_PI * i / m));
+      xyz.push_back(cy + r * sin(2 * M_PI * i / m));
+      xyz.push_back(0);
+      unsigned int a = (unsigned int)(first + i), b = (unsigned int)(first + (i + 1) % m);
+      if(rand() % 2)
+        swap(a, b);
+      segments.push_back(a);
+      segments.push_back(b);
+    }
+    first += m;
+  }
+  mesh.setNodes(tags, xyz);
+  for(size_t i = segments.size() / 2; i > 1; i--)
+  {
+    size_t j = rand() % i;
+    swap(segments[2*(i-1)], segments[2*j]);
+    swap(segments[2*(i-1)+1], segments[2*j+1]);
+  }
+}
+
+// the usual walk: node -> segments in a std::multimap, a search per step
+size_t mapWalk(const vector<unsigned int>& segments, vector<unsigned int>& nodes)
+{
+  multimap<unsigned int, size_t> incident;
+  for(size_t k = 0; k < segments.size(); k++)
+    incident.insert(make_pair(segments[k], k));
+  vector<char> visited(segments.size() / 2, 0);
+  size_t numLoops = 0;
+  nodes.clear();
+  for(size_t s = 0; s < visited.size(); s++)
+  {
+    if(visited[s])
+      continue;
+    numLoops++;
+    size_t cur = s;
+    unsigned int node = segments[2*s];
+    while(!visited[cur])
+    {
+      visited[cur] = 1;
+      nodes.push_back(node);
+      node = segments[2*cur] == node ? segments[2*cur+1] : segments[2*cur];
+      auto range = incident.equal_range(node);
+      for(auto iter = range.first; iter != range.second; ++iter)
+      {
+        if(iter->second / 2 != cur)
+        {
+          cur = iter->second / 2;
+          break;
+        }
+      }
+    }
+  }
+  return numLoops;
+}
+
+
+// usage: boundaryLoopBenchmark [maxSegments] [numHoles]
+int main(int argc, char **argv)
+{
+  size_t maxSegments = argc > 1 ? atol(argv[1]) : 4000000;
+  int numHoles = argc > 2 ? atoi(argv[2]) : 8;
+
+  cout<<"segments   loops  walk(s)  Msegments/s  all ccw  multimap(s)"<<endl;
+  for(size_t n = 62500; n <= maxSegments; n *= 4)
+  {
+    MeshData mesh;
+    vector<unsigned int> segments;
+    generate(n, numHoles, mesh, segments);
+    vector<size_t> segmentTags;
+
+    BoundaryLoops loops;
+    auto t0 = chrono::steady_clock::now();
+    loops.build(mesh, segments, segmentTags, LOOP_COUNTERCLOCKWISE);
+    double walk = seconds(t0);
+
+    bool ccw = true;
+    for(size_t c = 0; c < loops.size(); c++)
+      ccw = ccw && loops.isClosed(c) && loops.getArea(c) > 0;
+
+    vector<unsigned int> nodes;
+    t0 = chrono::steady_clock::now();
+    size_t numLoops = mapWalk(segments, nodes);
+    double reference = seconds(t0);
+
+    cout<<segments.size() / 2<<"  "<<loops.size()<<" ("<<numLoops<<")  "<<walk<<"  "<<segments.size() / 2 / walk / 1e6
+        <<"  "<<(ccw ? "yes" : "no")<<"  "<<reference<<endl;
+  }
+  return 0;
+}
@@ -0,0 +1,86 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "edgeNumbering.h"
+#include "meshData.h"
+#include "tagIndexMap.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// usage: edgeNumberingBenchmark [levels] [threads]
+// every level halves boundaryLc and holeLc, so the element count grows about 4x
+int main(int argc, char **argv)
+{
+  int levels = argc > 1 ? atoi(argv[1]) : 6;
+  int numThreads = argc > 2 ? atoi(argv[2]) : 0;
+  gmsh::initialize();
+
+  cout<<"elements  edges  number(s)  midpoints(s)  setOrder(2)(s)  speedup  max distance"<<endl;
+  double boundaryLc = 1, holeLc = 0.4;
+  for(int level = 0; level < levels; level++)
+  {
+    gmsh::model::add("edges" + to_string(level));
+    buildTwoDGeometry(boundaryLc, holeLc);
+    gmsh::model::geo::synchronize();
+    gmsh::model::mesh::generate(2);
+
+    vector<size_t> nodeTags;
+    vector<double> coord, parametricCoord;
+    gmsh::model::mesh::getNodes(nodeTags, coord, parametricCoord, -1, -1, true, false);
+    vector<int> elementTypes;
+    vector<vector<size_t> > elementTags, nodeTagss;
+    gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTagss, 2, -1);
+    int tri = findElementType(elementTypes, TRIANGLE);
+    MeshData mesh;
+    mesh.setNodes(nodeTags, coord);
+    const ElementBlock& triangles = mesh.addBlock(TRIANGLE, elementTags[tri], nodeTagss[tri]);
+
+    auto t0 = chrono::steady_clock::now();
+    EdgeNumbering edges;
+    edges.build(triangles, numThreads);
+    auto t1 = chrono::steady_clock::now();
+    const ElementBlock& triangles6 = addMidEdgeNodes(mesh, edges, numThreads);
+    auto t2 = chrono::steady_clock::now();
+    // setOrder(2) and the extraction of its result, the gmsh path to the same arrays
+    gmsh::model::mesh::setOrder(2);
+    gmsh::model::mesh::getNodes(nodeTags, coord, parametricCoord, -1, -1, true, false);
+    gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTagss, 2, -1);
+    auto t3 = chrono::steady_clock::now();
+
+    // midpoints of the same element tag, compared by coordinates since the
+    // node tags of the new nodes are numbered differently
+    int tri6 = findElementType(elementTypes, TRIANGLE6);
+    TagIndexMap nodeIndex, elementIndex;
+    nodeIndex.build(nodeTags);
+    elementIndex.build(triangles6.getElementTags());
+    double maxDistance = tri6 < 0 ? -1 : 0;
+    for(size_t i = 0; tri6 >= 0 && i < elementTags[tri6].size(); i++)
+    {
+      ElementView ours = triangles6[elementIndex.find(elementTags[tri6][i])];
+      for(int j = 3; j < 6; j++)
+      {
+        size_t id = nodeIndex.find(nodeTagss[tri6][6*i+j]);
+        double dx = coord[3*id] - mesh.getX(ours[j]);
+        double dy = coord[3*id+1] - mesh.getY(ours[j]);
+        double dz = coord[3*id+2] - mesh.getZ(ours[j]);
+        maxDistance = max(maxDistance, sqrt(dx*dx + dy*dy + dz*dz));
+      }
+    }
+
+    double ours = seconds(t0, t2), gmshTime = seconds(t2, t3);
+    cout<<triangles.size()<<"  "<<edges.getNumEdges()<<"  "<<seconds(t0, t1)<<"  "<<seconds(t1, t2)<<"  "<<gmshTime
+        <<"  "<<(ours > 0 ? gmshTime/ours : 0)<<"  "<<maxDistance<<endl;
+
+    gmsh::model::remove();
+    boundaryLc /= 2;
+    holeLc /= 2;
+  }
+
+  gmsh::finalize();
+  return 0;
+}
@@ -0,0 +1,123 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include "meshData.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// sum of element centroids, written once for every element type
+struct CentroidSum
+{
+  CentroidSum(const MeshData& mesh) : _x(&mesh.getXs()[0]), _sum(0) {}
+  template<int Type> void operator () (const TypedBlockView<Type>& block)
+  {
+    const int n = TypedBlockView<Type>::numNodes;
+    double sum = 0;
+    for(size_t i = 0; i < block.size(); i++)
+    {
+      const unsigned int* nodes = block.nodes(i);
+      double c = 0;
+      for(int j = 0; j < n; j++)
+      {
+        c += _x[nodes[j]];
+      }
+      sum += c / n;
+    }
+    _sum += sum;
+  }
+  const double* _x;
+  double _sum;
+};
+
+
+// the same sum with the stride read from the block at run time
+double runtimeStrideSum(const MeshData& mesh)
+{
+  const double* x = &mesh.getXs()[0];
+  double sum = 0;
+  for(size_t b = 0; b < mesh.getNumBlocks(); b++)
+  {
+    const ElementBlock& block = mesh.getBlock(b);
+    for(size_t i = 0; i < block.size(); i++)
+    {
+      ElementView e = block[i];
+      double c = 0;
+      for(int j = 0; j < e.size(); j++)
+      {
+        c += x[e[j]];
+      }
+      sum += c / e.size();
+    }
+  }
+  return sum;
+}
+
+
+// mixed mesh: random nodes, one block each of lines, triangles, quads, tets and hexes
+void generate(size_t numElements, MeshData& mesh)
+{
+  size_t numNodes = numElements;
+  vector<size_t> nodeTags(numNodes);
+  vector<double> coord(3*numNodes);
+  for(size_t i = 0; i < numNodes; i++)
+  {
+    nodeTags[i] = i+1;
+    coord[3*i] = rand() / (double)RAND_MAX;
+  }
+  mesh.setNodes(nodeTags, coord);
+  int types[5] = {LINE, TRIANGLE, QUADRANGLE, TETRAHEDRON, HEXAHEDRON};
+  size_t tag = 1;
+  for(int t = 0; t < 5; t++)
+  {
+    int n = getElementNumNodes(types[t]);
+    vector<size_t> elementTags(numElements/5), connectivity(n*elementTags.size());
+    for(size_t i = 0; i < elementTags.size(); i++)
+    {
+      elementTags[i] = tag++;
+    }
+    for(size_t i = 0; i < connectivity.size(); i++)
+    {
+      connectivity[i] = 1 + (i/n + rand() % 32) % numNodes;
+    }
+    mesh.addBlock(types[t], elementTags, connectivity);
+  }
+}
+
+
+// usage: elementViewBenchmark [numElements] [repetitions]
+int main(int argc, char **argv)
+{
+  size_t numElements = argc > 1 ? atol(argv[1]) : 5000000;
+  int repetitions = argc > 2 ? atoi(argv[2]) : 10;
+  MeshData mesh;
+  generate(numElements, mesh);
+
+  // best of the repetitions; the memory clobber keeps the compiler from
+  // computing a repeated pass only once
+  double runtime = 0, runtimeTime = 1e30, typedTime = 1e30;
+  CentroidSum typed(mesh);
+  for(int r = 0; r < repetitions; r++)
+  {
+    asm volatile("" ::: "memory");
+    auto t0 = chrono::steady_clock::now();
+    runtime = runtimeStrideSum(mesh);
+    asm volatile("" ::: "memory");
+    runtimeTime = min(runtimeTime, seconds(t0));
+
+    t0 = chrono::steady_clock::now();
+    typed._sum = 0;
+    for(size_t b = 0; b < mesh.getNumBlocks(); b++)
+      visitBlock(mesh.getBlock(b), typed);
+    asm volatile("" ::: "memory");
+    typedTime = min(typedTime, seconds(t0));
+  }
+
+  cout<<"elements: "<<numElements<<" in "<<mesh.getNumBlocks()<<" blocks"<<endl;
+  cout<<"run time stride (ElementView): "<<runtimeTime<<"s"<<endl;
+  cout<<"typed view (visitBlock):       "<<typedTime<<"s, speedup "<<runtimeTime/typedTime<<endl;
+  cout<<"same result: "<<(runtime - typed._sum < 1e-6*runtime && typed._sum - runtime < 1e-6*runtime ? "yes" : "no")<<endl;
+  return 0;
+}
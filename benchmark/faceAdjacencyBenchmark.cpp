@@ -0,0 +1,88 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "faceAdjacency.h"
+#include "meshData.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// n x n x n cubes, every cube split in 6 tetrahedra around its main diagonal,
+// the faces between cubes match so the mesh is conforming
+void generate(size_t n, MeshData& mesh)
+{
+  size_t np = n + 1;
+  vector<size_t> nodeTags(np*np*np);
+  vector<double> coord(3*nodeTags.size());
+  for(size_t i = 0; i < nodeTags.size(); i++)
+  {
+    nodeTags[i] = i + 1;
+    coord[3*i] = (double)(i % np);
+    coord[3*i+1] = (double)(i / np % np);
+    coord[3*i+2] = (double)(i / np / np);
+  }
+  mesh.setNodes(nodeTags, coord);
+
+  // corners of a cube: bit 0 = x, bit 1 = y, bit 2 = z, the paths 0 -> 7 along the edges
+  const int paths[6][2] = {{1, 3}, {1, 5}, {2, 3}, {2, 6}, {4, 5}, {4, 6}};
+  vector<size_t> elementTags, tetNodeTags;
+  elementTags.reserve(6*n*n*n);
+  tetNodeTags.reserve(24*n*n*n);
+  for(size_t k = 0; k < n; k++)
+    for(size_t j = 0; j < n; j++)
+      for(size_t i = 0; i < n; i++)
+      {
+        size_t c[8];
+        for(int b = 0; b < 8; b++)
+        {
+          c[b] = 1 + (i + (b & 1)) + np * ((j + (b >> 1 & 1)) + np * (k + (b >> 2 & 1)));
+        }
+        for(int t = 0; t < 6; t++)
+        {
+          elementTags.push_back(elementTags.size() + 1);
+          tetNodeTags.push_back(c[0]);
+          tetNodeTags.push_back(c[paths[t][0]]);
+          tetNodeTags.push_back(c[paths[t][1]]);
+          tetNodeTags.push_back(c[7]);
+        }
+      }
+  mesh.addBlock(TETRAHEDRON, elementTags, tetNodeTags);
+}
+
+
+// usage: faceAdjacencyBenchmark [n] [threads]
+// n^3 cubes, 6 n^3 tetrahedra; the boundary of the block has 12 n^2 faces
+int main(int argc, char **argv)
+{
+  size_t n = argc > 1 ? atol(argv[1]) : 100;
+  int numThreads = argc > 2 ? atoi(argv[2]) : 0;
+
+  MeshData mesh;
+  generate(n, mesh);
+  const ElementBlock& tets = *mesh.findBlock(TETRAHEDRON);
+
+  auto t0 = chrono::steady_clock::now();
+  FaceAdjacency faces;
+  faces.build(tets, numThreads);
+  auto t1 = chrono::steady_clock::now();
+  size_t boundary = 0;
+  for(size_t i = 0; i < tets.size(); i++)
+  {
+    for(int j = 0; j < 4; j++)
+    {
+      if(faces.getNeighbour(i, j) < 0)
+        boundary++;
+    }
+  }
+  auto t2 = chrono::steady_clock::now();
+
+  // table memory, the bucketed face entries (12 bytes per tetrahedron face) are freed after build
+  double memory = (faces.getNumFaces()*(3*sizeof(unsigned int) + 2*sizeof(int)) + tets.size()*4*sizeof(int)
+                   + faces.getBoundaryFaces().size()*sizeof(int)) / 1048576.0;
+  cout<<"tets  faces  boundary  build(s)  Mtets/s  neighbours(s)  memory(MB)  correct"<<endl;
+  cout<<tets.size()<<"  "<<faces.getNumFaces()<<"  "<<faces.getBoundaryFaces().size()<<"  "<<seconds(t0, t1)
+      <<"  "<<tets.size()/seconds(t0, t1)/1e6<<"  "<<seconds(t1, t2)<<"  "<<memory
+      <<"  "<<(boundary == 12*n*n && faces.getBoundaryFaces().size() == boundary ? "yes" : "no")<<endl;
+  return 0;
+}
@@ -0,0 +1,78 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "regionInterfaces.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// n x n squares cut in two triangles each, regions are k x k blocks of squares
+void generate(int n, int k, MeshData& mesh, vector<int>& regions)
+{
+  vector<size_t> nodeTags, elementTags, connectivity;
+  vector<double> xyz;
+  for(int j = 0; j <= n; j++)
+  {
+    for(int i = 0; i <= n; i++)
+    {
+      nodeTags.push_back(nodeTags.size() + 1);
+      xyz.push_back(i);
+      xyz.push_back(j);
+      xyz.push_back(0);
+    }
+  }
+  regions.clear();
+  for(int j = 0; j < n; j++)
+  {
+    for(int i = 0; i < n; i++)
+    {
+      size_t a = (size_t)j * (n + 1) + i + 1, b = a + 1, c = a + n + 2, d = a + n + 1;
+      int region = (int)((long long)j * k / n) * k + (int)((long long)i * k / n);
+      size_t t[6] = {a, b, c, a, c, d};
+      connectivity.insert(connectivity.end(), t, t + 6);
+      elementTags.push_back(elementTags.size() + 1);
+      elementTags.push_back(elementTags.size() + 1);
+      regions.push_back(region);
+      regions.push_back(region);
+    }
+  }
+  mesh.setNodes(nodeTags, xyz);
+  mesh.addBlock(TRIANGLE, elementTags, connectivity);
+}
+
+
+// usage: interfaceBenchmark [n] [maxRegions per side]
+int main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000;
+  int maxK = argc > 2 ? atoi(argv[2]) : 32;
+
+  cout<<"triangles  regions  interfaces(expected)  segments  build(s)  Mtriangles/s"<<endl;
+  for(int k = 2; k <= maxK; k *= 2)
+  {
+    MeshData mesh;
+    vector<int> regions;
+    generate(n, k, mesh, regions);
+    const ElementBlock& block = *mesh.findBlock(TRIANGLE);
+
+    auto t0 = chrono::steady_clock::now();
+    RegionInterfaces interfaces;
+    interfaces.build(mesh, block, regions);
+    double build = seconds(t0);
+
+    // every interface of a block grid is one open chain with a triangle on both sides of every segment
+    size_t segments = 0;
+    bool ok = true;
+    for(size_t i = 0; i < interfaces.size(); i++)
+    {
+      segments += interfaces.getNumSegments(i);
+      ok = ok && interfaces.getNumChains(i) == 1;
+      for(size_t s = 0; s < interfaces.getNumSegments(i); s++)
+        ok = ok && regions[interfaces.getElementA(i, s)] == interfaces.getRegionA(i) && regions[interfaces.getElementB(i, s)] == interfaces.getRegionB(i);
+    }
+    cout<<block.size()<<"  "<<k * k<<"  "<<interfaces.size()<<"("<<2 * k * (k - 1)<<")  "<<segments<<"  "<<build
+        <<"  "<<block.size() / build / 1e6<<(ok ? "" : "  wrong sides")<<endl;
+  }
+  return 0;
+}
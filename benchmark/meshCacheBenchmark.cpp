@@ -0,0 +1,62 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "meshCache.h"
+#include "meshData.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// usage: meshCacheBenchmark [levels] [runs]
+// every level halves the mesh sizes; the first run of a level is a miss
+// (generate + extract + store), the next ones are hits
+int main(int argc, char **argv)
+{
+  int levels = argc > 1 ? atoi(argv[1]) : 5;
+  int runs = argc > 2 ? atoi(argv[2]) : 3;
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 0);
+  MeshCache cache("meshCacheBenchmark");
+  cache.clear();
+  double boundaryLc = 0.5, holeLc = 0.2;
+  for(int level = 0; level < levels; level++, boundaryLc /= 2, holeLc /= 2)
+  {
+    double miss = 0, hit = 1e30;
+    size_t elements = 0;
+    for(int r = 0; r <= runs; r++)
+    {
+      gmsh::model::add("cache");
+      auto t0 = chrono::steady_clock::now();
+      MeshCacheKey key;
+      // the geometry is fixed, so the mesh sizes and the mesh options are the whole input
+      buildTwoDGeometry(boundaryLc, holeLc);
+      gmsh::model::geo::synchronize();
+      key.add(string("twoDExample"));
+      key.add(boundaryLc);
+      key.add(holeLc);
+      key.addGmshMeshOptions();
+      MeshData mesh;
+      MeshCacheArrays arrays;
+      if(!cache.load(key.getKey(), mesh, arrays))
+      {
+        gmsh::model::mesh::generate(2);
+        mesh.loadFromGmsh(2);
+        cache.store(key.getKey(), mesh, arrays);
+      }
+      double s = seconds(t0, chrono::steady_clock::now());
+      if(r == 0)
+        miss = s;
+      else
+        hit = min(hit, s);
+      elements = mesh.getNumElements(2);
+      gmsh::model::remove();
+    }
+    cout<<"lc "<<boundaryLc<<" / "<<holeLc<<": "<<elements<<" triangles, miss "<<miss<<"s, hit "<<hit<<"s, "<<miss / hit<<"x"<<endl;
+  }
+  cache.printStats(cout);
+  cache.clear();
+  gmsh::finalize();
+  return 0;
+}
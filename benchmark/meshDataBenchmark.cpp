@@ -0,0 +1,143 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "memoryUsage.h"
+#include "meshData.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// the node / triangle classes the examples used before MeshData
+class Point
+{
+  public:
+    Point(const double x = 0, const double y = 0, const double z = 0):_x(x), _y(y), _z(z) {}
+    double getX() const {return _x;}
+
+  private:
+    double _x, _y, _z;
+};
+
+class Triangle
+{
+  public:
+    void append(unsigned int id) {_ids.push_back(id);}
+    const vector<unsigned int>& getIds() const {return _ids;}
+
+  private:
+    vector<unsigned int> _ids;
+};
+
+
+// structured n x n grid split into 2 n^2 triangles, in the layout getNodes / getElements return
+void generateGrid(int n, vector<size_t>& nodeTags, vector<double>& coord, vector<size_t>& elementTags, vector<size_t>& triNodeTags)
+{
+  size_t numNodes = (size_t)(n+1)*(n+1);
+  nodeTags.resize(numNodes);
+  coord.resize(3*numNodes);
+  for(int j = 0; j <= n; j++)
+  {
+    for(int i = 0; i <= n; i++)
+    {
+      size_t k = (size_t)j*(n+1) + i;
+      nodeTags[k] = k+1;
+      coord[3*k] = (double)i/n;
+      coord[3*k+1] = (double)j/n;
+      coord[3*k+2] = 0;
+    }
+  }
+  size_t numTriangles = 2*(size_t)n*n;
+  elementTags.resize(numTriangles);
+  triNodeTags.resize(3*numTriangles);
+  size_t e = 0;
+  for(int j = 0; j < n; j++)
+  {
+    for(int i = 0; i < n; i++)
+    {
+      size_t a = nodeTags[(size_t)j*(n+1) + i], b = a+1, c = a+n+1, d = c+1;
+      size_t tri[6] = {a, b, d, a, d, c};
+      for(int t = 0; t < 6; t++)
+      {
+        triNodeTags[3*e+t] = tri[t];
+      }
+      elementTags[e] = e+1;
+      elementTags[e+1] = e+2;
+      e += 2;
+    }
+  }
+}
+
+
+// build one path in this process and print its time and peak memory over the input arrays
+void run(int n, bool soa)
+{
+  vector<size_t> nodeTags, elementTags, triNodeTags;
+  vector<double> coord;
+  generateGrid(n, nodeTags, coord, elementTags, triNodeTags);
+  const size_t base = getResidentMemory();
+
+  auto t0 = chrono::steady_clock::now();
+  double check = 0;
+  if(soa)
+  {
+    MeshData mesh;
+    mesh.setNodes(nodeTags, coord);
+    const ElementBlock& triangles = mesh.addBlock(2, elementTags, triNodeTags);
+    for(size_t i = 0; i < triangles.size(); i++)
+    {
+      check += mesh.getX(triangles[i][2]);
+    }
+  } else {
+    vector<Point> nodes;
+    nodes.reserve(1000);
+    for(size_t i = 0; i < coord.size(); i += 3)
+    {
+      nodes.push_back(Point(coord[i], coord[i+1], coord[i+2]));
+    }
+    vector<Triangle> triangles;
+    triangles.reserve(1000);
+    for(size_t i = 0; i < triNodeTags.size(); i += 3)
+    {
+      Triangle tri;
+      tri.append(triNodeTags[i]-1);
+      tri.append(triNodeTags[i+1]-1);
+      tri.append(triNodeTags[i+2]-1);
+      triangles.push_back(tri);
+    }
+    for(size_t i = 0; i < triangles.size(); i++)
+    {
+      check += nodes[triangles[i].getIds()[2]].getX();
+    }
+  }
+  double elapsed = seconds(t0);
+
+  cout<<(soa ? "MeshData      " : "Point/Triangle")<<"  "<<elementTags.size()<<"  "<<elapsed
+      <<"  "<<((double)getPeakResidentMemory() - base)/1048576.0<<"  ("<<check<<")"<<endl;
+}
+
+
+// usage: meshDataBenchmark [n]
+// every path runs in its own process so peak memory is not shared between them
+int main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000;
+  cout<<"path            triangles  build+walk(s)  peak over input(MB)"<<endl;
+  for(int soa = 0; soa < 2; soa++)
+  {
+    cout.flush();
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+      run(n, soa == 1);
+      cout.flush();
+      _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+  }
+  return 0;
+}
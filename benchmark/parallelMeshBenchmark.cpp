@@ -0,0 +1,85 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <unistd.h>
+#include "polygonReader.h"
+#include "parallelMesher.h"
+#include "phaseTimer.h"
+using namespace std;
+
+
+// n x n unit square regions, neighbours share their edges
+void buildRegions(int n, double lc, vector<int>& surfaceTags)
+{
+  GmshPolygonSink sink(lc);
+  vector<PolygonRecord> batch(n);
+  for(int j = 0; j < n; j++)
+  {
+    for(int i = 0; i < n; i++)
+    {
+      batch[i].clear();
+      vector<double>& ring = batch[i].addRing();
+      double x[4] = {(double)i, i+1.0, i+1.0, (double)i}, y[4] = {(double)j, (double)j, j+1.0, j+1.0};
+      for(int k = 0; k < 4; k++)
+      {
+        ring.push_back(x[k]);
+        ring.push_back(y[k]);
+        ring.push_back(0);
+      }
+    }
+    sink.addBatch(batch, n);
+  }
+  gmsh::model::geo::synchronize();
+  surfaceTags = sink.getSurfaceTags();
+}
+
+
+// usage: parallelMeshBenchmark [n] [lc] [maxWorkers]
+int main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 8;
+  double lc = argc > 2 ? atof(argv[2]) : 0.02;
+  int maxWorkers = argc > 3 ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+  gmsh::initialize();
+
+  // one model meshed serially by gmsh as the reference
+  vector<int> surfaceTags;
+  gmsh::model::add("serial");
+  buildRegions(n, lc, surfaceTags);
+  PhaseTimer timer;
+  timer.start("serial");
+  gmsh::model::mesh::generate(2);
+  timer.stop();
+  double serial = timer.getSeconds("serial");
+  gmsh::model::remove();
+  cout<<"regions: "<<n*n<<", gmsh serial generate(2): "<<serial<<"s"<<endl;
+  cout<<"workers  nodes  triangles  curves(s)  workers(s)  merge(s)  total(s)  speedup"<<endl;
+
+  vector<int> workers;
+  for(int w = 1; w < maxWorkers; w *= 2)
+    workers.push_back(w);
+  workers.push_back(maxWorkers);
+  for(int i = 0; i < workers.size(); i++)
+  {
+    int w = workers[i];
+    gmsh::model::add("parallel");
+    buildRegions(n, lc, surfaceTags);
+    MeshData mesh;
+    ParallelMesher mesher(w);
+    if(!mesher.generate(surfaceTags, mesh))
+    {
+      cout<<mesher.getError()<<endl;
+      break;
+    }
+    const PhaseTimer& t = mesher.getTimer();
+    cout<<w<<"  "<<mesh.getNumNodes()<<"  "<<mesh.findBlock(2)->size()<<"  "<<t.getSeconds("curves")<<"  "<<t.getSeconds("workers")
+        <<"  "<<t.getSeconds("merge")<<"  "<<t.getTotalSeconds()<<"  "<<serial/t.getTotalSeconds()<<endl;
+    gmsh::model::remove();
+  }
+
+  gmsh::finalize();
+  return 0;
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <sys/stat.h>
+#include "meshPartitioner.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// n x 4n squares cut in two triangles each, a long strip turned by 30 degrees
+// so that the principal axis is not a coordinate axis
+void generate(int n, MeshData& mesh)
+{
+  vector<size_t> nodeTags, elementTags, connectivity;
+  vector<double> xyz;
+  const double c = cos(M_PI / 6), s = sin(M_PI / 6);
+  const int m = 4 * n;
+  for(int j = 0; j <= n; j++)
+  {
+    for(int i = 0; i <= m; i++)
+    {
+      nodeTags.push_back(nodeTags.size() + 1);
+      xyz.push_back(c * i - s * j);
+      xyz.push_back(s * i + c * j);
+      xyz.push_back(0);
+    }
+  }
+  for(int j = 0; j < n; j++)
+  {
+    for(int i = 0; i < m; i++)
+    {
+      size_t a = (size_t)j * (m + 1) + i + 1, b = a + 1, d = a + m + 2, e = a + m + 1;
+      size_t t[6] = {a, b, d, a, d, e};
+      connectivity.insert(connectivity.end(), t, t + 6);
+      elementTags.push_back(elementTags.size() + 1);
+      elementTags.push_back(elementTags.size() + 1);
+    }
+  }
+  mesh.setNodes(nodeTags, xyz);
+  mesh.addBlock(TRIANGLE, elementTags, connectivity);
+}
+
+// every received node is sent by its owner at the same position, and every owned element is in exactly one part
+bool check(const MeshPartitioner& partitioner, size_t numElements)
+{
+  vector<int> seen(numElements, 0);
+  for(int p = 0; p < partitioner.getNumParts(); p++)
+  {
+    const MeshPartition& mp = partitioner.getPartition(p);
+    for(size_t i = 0; i < mp._layerOffsets[1]; i++)
+      seen[mp._elements[i]]++;
+    for(size_t k = 0; k < mp._neighbours.size(); k++)
+    {
+      const MeshPartition& mq = partitioner.getPartition(mp._neighbours[k]);
+      size_t back = 0;
+      while(back < mq._neighbours.size() && mq._neighbours[back] != p)
+        back++;
+      if(back == mq._neighbours.size() || mp._receive[k].size() != mq._send[back].size())
+        return false;
+      for(size_t i = 0; i < mp._receive[k].size(); i++)
+      {
+        if(mp._nodes[mp._receive[k][i]] != mq._nodes[mq._send[back][i]] || mq._send[back][i] >= mq._numOwnedNodes)
+          return false;
+      }
+    }
+  }
+  for(size_t e = 0; e < numElements; e++)
+  {
+    if(seen[e] != 1)
+      return false;
+  }
+  return true;
+}
+
+
+// usage: partitionBenchmark [n] [maxParts] [numLayers] [numThreads] [write]
+int main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 500;
+  int maxParts = argc > 2 ? atoi(argv[2]) : 64;
+  int numLayers = argc > 3 ? atoi(argv[3]) : 1;
+  int numThreads = argc > 4 ? atoi(argv[4]) : 0;
+  bool write = argc > 5 && atoi(argv[5]) != 0;
+
+  MeshData mesh;
+  generate(n, mesh);
+  const ElementBlock& block = *mesh.findBlock(TRIANGLE);
+  if(write)
+    mkdir("parts", 0755);
+
+  const PartitionMethod methods[2] = {PARTITION_COORDINATE, PARTITION_INERTIAL};
+  const char* names[2] = {"rcb", "rib"};
+  cout<<block.size()<<" triangles, "<<numLayers<<" ghost layers"<<endl;
+  cout<<"method  parts  partition(s)  ghosts(s)  write(s)  edge cut  imbalance  ghost triangles  ghost nodes  exchange ok"<<endl;
+  for(int m = 0; m < 2; m++)
+  {
+    for(int parts = 2; parts <= maxParts; parts = parts == 2 ? 3 : parts == 3 ? 4 : 2 * parts)
+    {
+      MeshPartitioner partitioner;
+      auto t0 = chrono::steady_clock::now();
+      partitioner.partition(mesh, block, parts, methods[m], numThreads);
+      double partition = seconds(t0);
+      t0 = chrono::steady_clock::now();
+      partitioner.buildPartitions(mesh, block, numLayers, numThreads);
+      double ghosts = seconds(t0);
+      double written = 0;
+      if(write)
+      {
+        t0 = chrono::steady_clock::now();
+        partitioner.write(mesh, block, "parts/" + string(names[m]) + to_string(parts), numThreads);
+        written = seconds(t0);
+      }
+      PartitionQuality quality = partitioner.getQuality(block, numThreads);
+      cout<<names[m]<<"  "<<parts<<"  "<<partition<<"  "<<ghosts<<"  "<<written<<"  "<<quality._edgeCut<<"  "<<quality._imbalance
+          <<"  "<<quality._ghostElements<<"  "<<quality._ghostNodes<<"  "<<(check(partitioner, block.size()) ? "yes" : "no")<<endl;
+    }
+  }
+  return 0;
+}
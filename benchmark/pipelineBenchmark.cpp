@@ -0,0 +1,262 @@
+#include <gmsh.h>
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include "meshAdjacency.h"
+#include "meshData.h"
+#include "phaseTimer.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// the geometries of the demo programs, every mesh size is multiplied by scale
+
+// demo.cpp: two plane surfaces, the first one with a square hole
+void buildDemo(double scale)
+{
+  double lcc = 0.05*scale, lc = 0.2*scale;
+  gmsh::model::geo::addPoint(1.0/3, 1.0/3, 0, lcc, 100);
+  gmsh::model::geo::addPoint(2.0/3, 1.0/3, 0, lcc, 101);
+  gmsh::model::geo::addPoint(2.0/3, 2.0/3, 0, lcc, 102);
+  gmsh::model::geo::addPoint(1.0/3, 2.0/3, 0, lcc, 103);
+  gmsh::model::geo::addLine(100, 101, 100);
+  gmsh::model::geo::addLine(101, 102, 101);
+  gmsh::model::geo::addLine(102, 103, 102);
+  gmsh::model::geo::addLine(103, 100, 103);
+  gmsh::model::geo::addCurveLoop({100, 101, 102, 103}, 100);
+  gmsh::model::geo::addPoint(-1, 0, 0, lc, 1);
+  gmsh::model::geo::addPoint(1, 0, 0, lc, 2);
+  gmsh::model::geo::addPoint(1, 1, 0, lc, 3);
+  gmsh::model::geo::addPoint(-1, 1, 0, lc, 4);
+  gmsh::model::geo::addPoint(0, 0, 0, lc, 555);
+  gmsh::model::geo::addLine(1, 555, 1);
+  gmsh::model::geo::addLine(555, 2, 555);
+  gmsh::model::geo::addLine(2, 3, 2);
+  gmsh::model::geo::addLine(3, 4, 3);
+  gmsh::model::geo::addLine(4, 1, 4);
+  gmsh::model::geo::addCurveLoop({1, 555, 2, 3, 4}, 1);
+  gmsh::model::geo::addPlaneSurface({1, -100}, 1);
+  gmsh::model::geo::addPoint(1, 2, 0, lc, 5);
+  gmsh::model::geo::addPoint(-1, 2, 0, lc, 6);
+  gmsh::model::geo::addLine(3, 5, 5);
+  gmsh::model::geo::addLine(5, 6, 6);
+  gmsh::model::geo::addLine(6, 4, 7);
+  gmsh::model::geo::addCurveLoop({-3, 5, 6, 7}, 2);
+  gmsh::model::geo::addPlaneSurface({2}, 2);
+}
+
+// oneDExample.cpp: five polygons sharing their vertices and edges, meshed in 1D
+void buildOneD(double scale)
+{
+  double lc = 0.8*scale;
+  double px[] = {0, 8, 8, 6, 5, 3, 2, 0, 2, 0, 3, 5, 6, 8, 8, 0};
+  double py[] = {0, 0, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 3, 3};
+  int polygons[5][8] = {{1, 2, 3, 4, 5, 6, 7, 8}, {8, 7, 9, 10}, {6, 5, 12, 11}, {4, 3, 14, 13}, {10, 9, 11, 12, 13, 14, 15, 16}};
+  int sizes[5] = {8, 4, 4, 4, 8};
+  for(int i = 0; i < 16; i++)
+  {
+    gmsh::model::geo::addPoint(px[i], py[i], 0, lc, i+1);
+  }
+  map<pair<int, int>, int> lines;
+  vector<int> planeSurface;
+  for(int i = 0; i < 5; i++)
+  {
+    vector<int> curveloop;
+    for(int j = 0; j < sizes[i]; j++)
+    {
+      int l1 = polygons[i][j], l2 = polygons[i][(j+1)%sizes[i]];
+      if(lines.count(make_pair(l2, l1)))
+      {
+        curveloop.push_back(-lines[make_pair(l2, l1)]);
+      } else {
+        int line = gmsh::model::geo::addLine(l1, l2);
+        lines[make_pair(l1, l2)] = line;
+        curveloop.push_back(line);
+      }
+    }
+    planeSurface.push_back(gmsh::model::geo::addCurveLoop(curveloop));
+  }
+  gmsh::model::geo::addPlaneSurface(planeSurface);
+}
+
+// twoDExample.cpp: rectangle with two square holes
+void buildTwoD(double scale)
+{
+  buildTwoDGeometry(1*scale, 0.4*scale);
+}
+
+// threeDDemo.cpp: the cube [-4,4]^3
+void buildThreeD(double scale)
+{
+  buildCubeGeometry(1*scale);
+}
+
+
+struct Geometry
+{
+  const char* name;
+  void (*build)(double);
+  int dim;
+};
+
+struct RunResult
+{
+  size_t nodes, elements;
+  PhaseTimer timer;
+};
+
+
+// one full pipeline run in a fresh model
+void runPipeline(const Geometry& geometry, double scale, RunResult& result)
+{
+  PhaseTimer& timer = result.timer;
+  timer.clear();
+  timer.setTrackMemory(true);
+  gmsh::model::add(geometry.name);
+
+  timer.start("geometry");
+  geometry.build(scale);
+  timer.start("synchronize");
+  gmsh::model::geo::synchronize();
+  timer.start("generate");
+  gmsh::model::mesh::generate(geometry.dim);
+
+  timer.start("extract");
+  MeshData mesh;
+  mesh.loadFromGmsh();
+  result.nodes = mesh.getNumNodes();
+  result.elements = 0;
+  for(size_t i = 0; i < mesh.getNumBlocks(); i++)
+  {
+    result.elements += mesh.getBlock(i).size();
+  }
+
+  // edge table over the 2D block if there is one, queried on every curve
+  timer.start("adjacency");
+  vector<int> elementTypes;
+  vector<vector<size_t> > elementTags, nodeTags;
+  int adjacencyDim = geometry.dim < 2 ? 1 : 2;
+  gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags, adjacencyDim, -1);
+  EdgeAdjacency adjacency;
+  for(int i = 0; i < elementTypes.size(); i++)
+  {
+    if(!elementTags[i].empty())
+      adjacency.build(nodeTags[i], elementTypes[i]);
+  }
+  gmsh::vectorpair curves;
+  gmsh::model::getEntities(curves, 1);
+  vector<int> curveTags, elementsIds;
+  for(int i = 0; i < curves.size(); i++)
+  {
+    curveTags.push_back(curves[i].second);
+  }
+  adjacency.getElementsOnCurves(curveTags, elementsIds);
+
+  timer.start("write");
+  gmsh::write("pipelineBenchmark.msh");
+  timer.stop();
+
+  gmsh::model::remove();
+}
+
+
+void writeStats(ostream& out, vector<double> values)
+{
+  sort(values.begin(), values.end());
+  double sum = 0;
+  for(int i = 0; i < values.size(); i++)
+  {
+    sum += values[i];
+  }
+  out<<"{\"min\": "<<values.front()<<", \"median\": "<<values[values.size()/2]
+     <<", \"mean\": "<<sum/values.size()<<", \"max\": "<<values.back()<<"}";
+}
+
+
+// every run also reports the memory per phase in MB (see PhaseTimer::writeMemoryJson)
+// usage: pipelineBenchmark [-o out.json] [-r repetitions] [-w warmup] [-s scale1,scale2,...] [-g demo,oneD,twoD,threeD]
+int main(int argc, char **argv)
+{
+  string output, only;
+  int repetitions = 5, warmup = 1;
+  vector<double> scales;
+  for(int i = 1; i + 1 < argc; i += 2)
+  {
+    if(!strcmp(argv[i], "-o")) output = argv[i+1];
+    else if(!strcmp(argv[i], "-r")) repetitions = max(1, atoi(argv[i+1]));
+    else if(!strcmp(argv[i], "-w")) warmup = max(0, atoi(argv[i+1]));
+    else if(!strcmp(argv[i], "-g")) only = argv[i+1];
+    else if(!strcmp(argv[i], "-s"))
+    {
+      for(char* s = strtok(argv[i+1], ","); s; s = strtok(0, ","))
+        scales.push_back(atof(s));
+    }
+  }
+  if(scales.empty())
+  {
+    scales.push_back(1);
+    scales.push_back(0.5);
+    scales.push_back(0.25);
+    scales.push_back(0.125);
+  }
+
+  Geometry geometries[] = {{"demo", buildDemo, 2}, {"oneD", buildOneD, 1}, {"twoD", buildTwoD, 2}, {"threeD", buildThreeD, 3}};
+
+  gmsh::initialize();
+  ofstream file;
+  if(!output.empty())
+    file.open(output.c_str());
+  ostream& out = output.empty() ? cout : file;
+
+  out<<"{\"repetitions\": "<<repetitions<<", \"warmup\": "<<warmup<<", \"runs\": ["<<endl;
+  bool first = true;
+  for(int g = 0; g < 4; g++)
+  {
+    if(!only.empty() && only.find(geometries[g].name) == string::npos)
+      continue;
+    for(int s = 0; s < scales.size(); s++)
+    {
+      RunResult result;
+      for(int w = 0; w < warmup; w++)
+      {
+        runPipeline(geometries[g], scales[s], result);
+      }
+      map<string, vector<double> > samples;
+      vector<string> phases;
+      for(int r = 0; r < repetitions; r++)
+      {
+        runPipeline(geometries[g], scales[s], result);
+        phases = result.timer.getPhases();
+        for(int p = 0; p < phases.size(); p++)
+        {
+          samples[phases[p]].push_back(result.timer.getSeconds(phases[p]));
+        }
+        samples["total"].push_back(result.timer.getTotalSeconds());
+      }
+      phases.push_back("total");
+
+      out<<(first ? "" : ",\n")<<"  {\"geometry\": \""<<geometries[g].name<<"\", \"scale\": "<<scales[s]
+         <<", \"nodes\": "<<result.nodes<<", \"elements\": "<<result.elements<<", \"phases\": {";
+      for(int p = 0; p < phases.size(); p++)
+      {
+        out<<(p ? ", " : "")<<"\""<<phases[p]<<"\": ";
+        writeStats(out, samples[phases[p]]);
+      }
+      // memory per phase of the last repetition
+      out<<"}, \"memory\": ";
+      result.timer.writeMemoryJson(out);
+      out<<"}";
+      out.flush();
+      first = false;
+    }
+  }
+  out<<endl<<"]}"<<endl;
+
+  gmsh::finalize();
+  return 0;
+}
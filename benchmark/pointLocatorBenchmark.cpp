@@ -0,0 +1,107 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "meshData.h"
+#include "pointLocator.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// usage: pointLocatorBenchmark [lc] [points] [gmshPoints] [threads]
+// probes random points and a row by row scan of the rectangle (some fall in
+// the holes), with the gmsh API on the first gmshPoints random points only
+int main(int argc, char **argv)
+{
+  double lc = argc > 1 ? atof(argv[1]) : 0.02;
+  size_t n = argc > 2 ? atol(argv[2]) : 4000000;
+  size_t gmshPoints = argc > 3 ? atol(argv[3]) : 20000;
+  int numThreads = argc > 4 ? atoi(argv[4]) : 0;
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 0);
+  gmsh::model::add("locate");
+  buildTwoDGeometry(lc, lc);
+  gmsh::model::geo::synchronize();
+  gmsh::model::mesh::generate(2);
+  MeshData mesh;
+  mesh.loadFromGmsh(2);
+  const ElementBlock* triangles = mesh.findBlock(TRIANGLE);
+
+  auto t0 = chrono::steady_clock::now();
+  PointLocator locator;
+  locator.build(mesh, *triangles, numThreads);
+  auto t1 = chrono::steady_clock::now();
+  cout<<triangles->size()<<" triangles, build "<<seconds(t0, t1)<<"s"<<endl;
+
+  srand(1);
+  vector<double> random(3 * n), scan(3 * n);
+  size_t side = (size_t)sqrt((double)n);
+  for(size_t i = 0; i < n; i++)
+  {
+    random[3*i] = 5.0 * rand() / RAND_MAX;
+    random[3*i+1] = 4.0 * rand() / RAND_MAX;
+    random[3*i+2] = 0;
+    scan[3*i] = 5.0 * ((i % side) + 0.5) / side;
+    scan[3*i+1] = 4.0 * ((i / side) + 0.5) / (n / side + 1);
+    scan[3*i+2] = 0;
+  }
+
+  // the gmsh API, one call per point
+  gmshPoints = min(gmshPoints, n);
+  vector<size_t> gmshTags(gmshPoints, 0);
+  t0 = chrono::steady_clock::now();
+  for(size_t i = 0; i < gmshPoints; i++)
+  {
+    size_t tag;
+    int type;
+    vector<size_t> nodeTags;
+    double u, v, w;
+    try
+    {
+      gmsh::model::mesh::getElementByCoordinates(random[3*i], random[3*i+1], random[3*i+2], tag, type, nodeTags, u, v, w, 2);
+      gmshTags[i] = tag;
+    }
+    catch(...)
+    {
+      // no element at this point
+    }
+  }
+  t1 = chrono::steady_clock::now();
+  double gmshRate = gmshPoints / seconds(t0, t1);
+  cout<<"gmsh getElementByCoordinates: "<<gmshRate<<" queries/s"<<endl;
+
+  vector<int> elements;
+  vector<double> bary;
+  const char* names[4] = {"random, grid", "random, walk", "scan, grid", "scan, walk"};
+  for(int c = 0; c < 4; c++)
+  {
+    const vector<double>& points = c < 2 ? random : scan;
+    const bool walk = c % 2 == 1;
+    for(int threads = 1; threads <= 2; threads++)
+    {
+      t0 = chrono::steady_clock::now();
+      size_t found = locator.locate(points, elements, bary, walk, threads == 1 ? 1 : numThreads);
+      t1 = chrono::steady_clock::now();
+      double rate = n / seconds(t0, t1);
+      cout<<names[c]<<(threads == 1 ? ", 1 thread: " : ", all threads: ")<<rate<<" queries/s ("<<rate / gmshRate<<"x gmsh), "
+          <<found<<" / "<<n<<" found"<<endl;
+    }
+  }
+
+  // same element as gmsh; a point on an edge may go to either side, count it apart
+  locator.locate(random, elements, bary, false, numThreads);
+  size_t same = 0, onEdge = 0;
+  for(size_t i = 0; i < gmshPoints; i++)
+  {
+    size_t tag = elements[i] >= 0 ? triangles->getElementTags()[elements[i]] : 0;
+    if(tag == gmshTags[i])
+      same++;
+    else if(elements[i] >= 0 && min(bary[3*i], min(bary[3*i+1], bary[3*i+2])) < 1e-8)
+      onEdge++;
+  }
+  cout<<same<<" / "<<gmshPoints<<" in the same element as gmsh, "<<onEdge<<" others on an edge"<<endl;
+  gmsh::finalize();
+  return 0;
+}
@@ -0,0 +1,78 @@
+#include <gmsh.h>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include "polygonReader.h"
+#include "phaseTimer.h"
+using namespace std;
+
+
+// n x n unit cells, each one a polygon with a square hole; neighbours share their edges
+void writeSyntheticFile(const string& filename, int n)
+{
+  ofstream out(filename.c_str());
+  out<<"# "<<n*n<<" synthetic cells"<<endl;
+  for(int j = 0; j < n; j++)
+  {
+    for(int i = 0; i < n; i++)
+    {
+      out<<"cell_"<<i<<"_"<<j<<", POLYGON(("<<i<<" "<<j<<", "<<i+1<<" "<<j<<", "<<i+1<<" "<<j+1<<", "<<i<<" "<<j+1<<"), ("
+         <<i+0.25<<" "<<j+0.25<<", "<<i+0.75<<" "<<j+0.25<<", "<<i+0.75<<" "<<j+0.75<<", "<<i+0.25<<" "<<j+0.75<<"))\n";
+    }
+  }
+}
+
+
+// parse only, to separate the reader from the gmsh calls
+class CountingSink : public PolygonSink
+{
+public:
+  CountingSink() : _points(0) {}
+  void addBatch(const vector<PolygonRecord>& batch, const size_t size)
+  {
+    for(size_t i = 0; i < size; i++)
+      for(size_t r = 0; r < batch[i].getNumRings(); r++)
+        _points += batch[i].getRing(r).size()/3;
+  }
+  size_t _points;
+};
+
+
+// usage: polygonReaderBenchmark [n] [batchSize]
+int main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 200;
+  int batchSize = argc > 2 ? atoi(argv[2]) : 1024;
+  string filename = "polygonReaderBenchmark.txt";
+
+  PhaseTimer timer;
+  timer.start("write file");
+  writeSyntheticFile(filename, n);
+
+  timer.start("parse");
+  PolygonReader reader;
+  reader.open(filename);
+  CountingSink counter;
+  size_t numPolygons = reader.stream(counter, batchSize);
+
+  gmsh::initialize();
+  gmsh::model::add("polygons");
+  timer.start("read + gmsh calls");
+  PolygonReader reader2;
+  reader2.open(filename);
+  GmshPolygonSink sink(0.1);
+  reader2.stream(sink, batchSize);
+  timer.start("synchronize");
+  sink.finish();
+  timer.stop();
+  gmsh::finalize();
+
+  cout<<"polygons: "<<numPolygons<<", points: "<<sink.getNumPoints()<<", lines: "<<sink.getNumLines()<<endl;
+  cout<<"parse only:        "<<numPolygons/timer.getSeconds("parse")<<" polygons/s"<<endl;
+  cout<<"read + gmsh calls: "<<numPolygons/timer.getSeconds("read + gmsh calls")<<" polygons/s"<<endl;
+  cout<<"with synchronize:  "<<numPolygons/(timer.getSeconds("read + gmsh calls") + timer.getSeconds("synchronize"))<<" polygons/s"<<endl;
+  timer.writeJson(cout);
+  cout<<endl;
+  return 0;
+}
@@ -0,0 +1,45 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "meshData.h"
+#include "meshQuality.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// usage: qualityBenchmark [levels] [threads]
+// every level divides lc by 1.5, so the tetrahedron count grows about 3.4x
+int main(int argc, char **argv)
+{
+  int levels = argc > 1 ? atoi(argv[1]) : 5;
+  int numThreads = argc > 2 ? atoi(argv[2]) : 0;
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 0);
+  double lc = 1;
+  for(int level = 0; level < levels; level++, lc /= 1.5)
+  {
+    gmsh::model::add("cube");
+    buildCubeGeometry(lc);
+    gmsh::model::geo::synchronize();
+    auto t0 = chrono::steady_clock::now();
+    gmsh::model::mesh::generate(3);
+    auto t1 = chrono::steady_clock::now();
+    MeshData mesh;
+    mesh.loadFromGmsh();
+    const ElementBlock* tets = mesh.findBlock(TETRAHEDRON);
+    auto t2 = chrono::steady_clock::now();
+    MeshQuality quality;
+    quality.compute(mesh, *tets, numThreads);
+    size_t rejected = quality.check(QualityThresholds());
+    auto t3 = chrono::steady_clock::now();
+    cout<<"lc "<<lc<<": "<<tets->size()<<" tetrahedra, generate "<<seconds(t0, t1)<<"s, extract "<<seconds(t1, t2)
+        <<"s, quality "<<seconds(t2, t3)<<"s ("<<tets->size() / seconds(t2, t3)<<" elements/s, "
+        <<seconds(t0, t1) / seconds(t2, t3)<<"x faster than generate), min dihedral angle "<<quality.getMin(MIN_ANGLE)
+        <<", "<<rejected<<" rejected"<<endl;
+    gmsh::model::remove();
+  }
+  gmsh::finalize();
+  return 0;
+}
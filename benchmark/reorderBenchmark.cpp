@@ -0,0 +1,121 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "meshData.h"
+#include "meshReorder.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// n x n grid of triangles whose node and element tags are shuffled,
+// about what the numbering of a large unstructured gmsh mesh looks like to a cache
+void generate(size_t n, MeshData& mesh)
+{
+  size_t np = n + 1;
+  vector<size_t> position(np*np);
+  for(size_t i = 0; i < position.size(); i++)
+  {
+    position[i] = i;
+  }
+  srand(1);
+  random_shuffle(position.begin(), position.end());
+  vector<size_t> nodeTags(position.size());
+  vector<double> coord(3*position.size());
+  vector<size_t> tagOf(position.size());
+  for(size_t i = 0; i < position.size(); i++)
+  {
+    nodeTags[i] = i + 1;
+    tagOf[position[i]] = i + 1;
+    coord[3*i] = (double)(position[i] % np);
+    coord[3*i+1] = (double)(position[i] / np);
+    coord[3*i+2] = 0;
+  }
+  mesh.setNodes(nodeTags, coord);
+
+  vector<size_t> cells(n*n);
+  for(size_t i = 0; i < cells.size(); i++)
+  {
+    cells[i] = i;
+  }
+  random_shuffle(cells.begin(), cells.end());
+  vector<size_t> elementTags, triNodeTags;
+  for(size_t c = 0; c < cells.size(); c++)
+  {
+    size_t a = cells[c] / n * np + cells[c] % n, b = a + 1, d = a + np, e = d + 1;
+    size_t q[6] = {a, b, e, a, e, d};
+    for(int k = 0; k < 6; k++)
+    {
+      triNodeTags.push_back(tagOf[q[k]]);
+    }
+    elementTags.push_back(elementTags.size() + 1);
+    elementTags.push_back(elementTags.size() + 1);
+  }
+  mesh.addBlock(TRIANGLE, elementTags, triNodeTags);
+}
+
+
+// the two gathers a solver does: y = A x over the node graph and the element loop over node coordinates
+double gather(const MeshData& mesh, int reps)
+{
+  vector<size_t> offsets;
+  vector<unsigned int> adj;
+  buildNodeGraph(mesh, offsets, adj);
+  const CountedVector<double>& x = mesh.getXs();
+  vector<double> y(x.size());
+  const ElementBlock& triangles = mesh.getBlock(0);
+  const CountedVector<unsigned int>& ids = triangles.getConnectivity();
+  double sum = 0, best = 1e30;
+  for(int r = 0; r < reps; r++)
+  {
+    auto t0 = chrono::steady_clock::now();
+    for(size_t i = 0; i + 1 < offsets.size(); i++)
+    {
+      double s = 0;
+      for(size_t j = offsets[i]; j < offsets[i+1]; j++)
+      {
+        s += x[adj[j]];
+      }
+      y[i] = s;
+    }
+    for(size_t e = 0; e < triangles.size(); e++)
+    {
+      sum += x[ids[3*e]] + mesh.getY(ids[3*e+1]) + x[ids[3*e+2]];
+    }
+    best = min(best, seconds(t0, chrono::steady_clock::now()));
+    sum += y[r % y.size()];
+  }
+  cout<<"  ("<<sum<<")";
+  return best;
+}
+
+
+// usage: reorderBenchmark [n] [reps]
+int main(int argc, char **argv)
+{
+  size_t n = argc > 1 ? atol(argv[1]) : 1000;
+  int reps = argc > 2 ? atoi(argv[2]) : 5;
+  MeshData mesh;
+  generate(n, mesh);
+
+  size_t bandwidth;
+  unsigned long long profile;
+  measureBandwidth(mesh, bandwidth, profile);
+  cout<<"shuffled: bandwidth "<<bandwidth<<", profile "<<profile;
+  double before = gather(mesh, reps);
+  cout<<", gather "<<before<<"s"<<endl;
+
+  auto t0 = chrono::steady_clock::now();
+  MeshReorder reorderer;
+  reorderer.reorderNodes(mesh);
+  auto t1 = chrono::steady_clock::now();
+  reorderer.reorderElements(mesh);
+  auto t2 = chrono::steady_clock::now();
+  measureBandwidth(mesh, bandwidth, profile);
+  cout<<"reordered: bandwidth "<<bandwidth<<", profile "<<profile;
+  double after = gather(mesh, reps);
+  cout<<", gather "<<after<<"s"<<endl;
+  cout<<"RCM "<<seconds(t0, t1)<<"s, Hilbert "<<seconds(t1, t2)<<"s, gather speedup "<<before/after<<endl;
+  return 0;
+}
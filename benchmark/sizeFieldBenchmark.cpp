@@ -0,0 +1,139 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "sizeField.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// n x n square holes of side 0.4 in the rectangle [0, n] x [0, n]
+void buildGeometry(int n, double lc, vector<vector<double> >& holes)
+{
+  vector<int> loop, curves, planeSurface;
+  double bx[4] = {0, (double)n, (double)n, 0}, by[4] = {0, 0, (double)n, (double)n};
+  for(int i = 0; i < 4; i++)
+  {
+    loop.push_back(gmsh::model::geo::addPoint(bx[i], by[i], 0, lc));
+  }
+  for(int i = 0; i < 4; i++)
+  {
+    curves.push_back(gmsh::model::geo::addLine(loop[i], loop[(i+1)%4]));
+  }
+  planeSurface.push_back(gmsh::model::geo::addCurveLoop(curves));
+  holes.clear();
+  for(int i = 0; i < n; i++)
+  {
+    for(int j = 0; j < n; j++)
+    {
+      double hx[4] = {i + 0.3, i + 0.7, i + 0.7, i + 0.3}, hy[4] = {j + 0.3, j + 0.3, j + 0.7, j + 0.7};
+      vector<double> xy;
+      loop.clear();
+      curves.clear();
+      for(int k = 0; k < 4; k++)
+      {
+        loop.push_back(gmsh::model::geo::addPoint(hx[k], hy[k], 0, lc));
+        xy.push_back(hx[k]);
+        xy.push_back(hy[k]);
+      }
+      for(int k = 0; k < 4; k++)
+      {
+        curves.push_back(gmsh::model::geo::addLine(loop[k], loop[(k+1)%4]));
+      }
+      planeSurface.push_back(-gmsh::model::geo::addCurveLoop(curves));
+      holes.push_back(xy);
+    }
+  }
+  gmsh::model::geo::addPlaneSurface(planeSurface);
+  gmsh::model::geo::synchronize();
+}
+
+
+size_t countTriangles()
+{
+  vector<size_t> elementTags, nodeTags;
+  gmsh::model::mesh::getElementsByType(2, elementTags, nodeTags);
+  return elementTags.size();
+}
+
+
+// usage: sizeFieldBenchmark [n] [fine] [coarse]
+// meshes n x n holes once with the fine size everywhere (what a constant lc
+// needs to resolve the holes) and once graded from fine at the holes to coarse
+int main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 8;
+  double fine = argc > 2 ? atof(argv[2]) : 0.02, coarse = argc > 3 ? atof(argv[3]) : 0.2;
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 0);
+  vector<vector<double> > holes;
+
+  // distance queries: grid index against every segment
+  SegmentIndex index;
+  gmsh::model::add("index");
+  buildGeometry(n, fine, holes);
+  gmsh::model::remove();
+  for(size_t i = 0; i < holes.size(); i++)
+  {
+    index.addPolyline(holes[i], true);
+  }
+  index.build();
+  const int queries = 200000;
+  srand(1);
+  vector<double> px(queries), py(queries);
+  for(int i = 0; i < queries; i++)
+  {
+    px[i] = n * (double)rand() / RAND_MAX;
+    py[i] = n * (double)rand() / RAND_MAX;
+  }
+  double sum = 0, error = 0;
+  auto t0 = chrono::steady_clock::now();
+  for(int i = 0; i < queries; i++)
+  {
+    sum += index.distance(px[i], py[i]);
+  }
+  auto t1 = chrono::steady_clock::now();
+  for(int i = 0; i < queries / 100; i++)
+  {
+    error = max(error, fabs(index.distanceBruteForce(px[i], py[i]) - index.distance(px[i], py[i])));
+  }
+  auto t2 = chrono::steady_clock::now();
+  cout<<index.size()<<" segments: grid "<<seconds(t0, t1) / queries * 1e9<<" ns/query, brute force "
+      <<seconds(t1, t2) / (queries / 100) * 1e9<<" ns/query, largest difference "<<error<<" ("<<sum<<")"<<endl;
+
+  // constant fine size
+  gmsh::model::add("uniform");
+  buildGeometry(n, fine, holes);
+  t0 = chrono::steady_clock::now();
+  gmsh::model::mesh::generate(2);
+  t1 = chrono::steady_clock::now();
+  size_t uniform = countTriangles();
+  cout<<"uniform lc "<<fine<<": "<<uniform<<" triangles, generate "<<seconds(t0, t1)<<"s"<<endl;
+  gmsh::model::remove();
+
+  // graded from the holes
+  gmsh::model::add("graded");
+  buildGeometry(n, coarse, holes);
+  SizeField field(coarse);
+  int feature = field.addFeature(fine, coarse, 0.02, 0.25);
+  for(size_t i = 0; i < holes.size(); i++)
+  {
+    field.addPolyline(feature, holes[i], true);
+  }
+  field.build();
+  field.registerCallback();
+  gmsh::option::setNumber("Mesh.MeshSizeFromPoints", 0);
+  gmsh::option::setNumber("Mesh.MeshSizeExtendFromBoundary", 0);
+  t0 = chrono::steady_clock::now();
+  gmsh::model::mesh::generate(2);
+  t1 = chrono::steady_clock::now();
+  size_t graded = countTriangles();
+  cout<<"graded "<<fine<<" -> "<<coarse<<": "<<graded<<" triangles ("<<(double)uniform / graded<<"x fewer), generate "<<seconds(t0, t1)
+      <<"s, "<<field.getNumCalls()<<" size calls, "<<field.getMeanLatency()<<" ns mean, "<<field.getMaxLatency()<<" ns max"<<endl;
+  gmsh::model::mesh::removeSizeCallback();
+  gmsh::model::remove();
+  gmsh::finalize();
+  return 0;
+}
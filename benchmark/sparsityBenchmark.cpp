@@ -0,0 +1,118 @@
+#include <iostream>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <cstdlib>
+#include "edgeNumbering.h"
+#include "meshData.h"
+#include "sparsityPattern.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// n x n grid of the unit square cut in 2 n^2 triangles
+void generate(size_t n, MeshData& mesh)
+{
+  size_t np = n + 1;
+  vector<size_t> nodeTags(np*np);
+  vector<double> coord(3*np*np);
+  for(size_t i = 0; i < nodeTags.size(); i++)
+  {
+    nodeTags[i] = i + 1;
+    coord[3*i] = (double)(i % np) / n;
+    coord[3*i+1] = (double)(i / np) / n;
+    coord[3*i+2] = 0;
+  }
+  mesh.setNodes(nodeTags, coord);
+  vector<size_t> elementTags, triNodeTags;
+  for(size_t c = 0; c < n*n; c++)
+  {
+    size_t a = c / n * np + c % n, b = a + 1, d = a + np, e = d + 1;
+    size_t q[6] = {a, b, e, a, e, d};
+    for(int k = 0; k < 6; k++)
+    {
+      triNodeTags.push_back(q[k] + 1);
+    }
+    elementTags.push_back(elementTags.size() + 1);
+    elementTags.push_back(elementTags.size() + 1);
+  }
+  mesh.addBlock(TRIANGLE, elementTags, triNodeTags);
+}
+
+
+// what the demos did before: one std::set of columns per node, filled element by element
+void buildWithSets(const ElementBlock& block, size_t numNodes, vector<set<unsigned int> >& rows)
+{
+  rows.assign(numNodes, set<unsigned int>());
+  const int k = block.getNumNodes();
+  const CountedVector<unsigned int>& ids = block.getConnectivity();
+  for(size_t e = 0; e < block.size(); e++)
+  {
+    for(int i = 0; i < k; i++)
+    {
+      for(int j = 0; j < k; j++)
+      {
+        rows[ids[k*e+i]].insert(ids[k*e+j]);
+      }
+    }
+  }
+}
+
+
+bool same(const SparsityPattern& pattern, const vector<set<unsigned int> >& rows)
+{
+  const int bs = pattern.getBlockSize();
+  for(size_t r = 0; r < pattern.getNumRows(); r++)
+  {
+    const set<unsigned int>& row = rows[r / bs];
+    if(pattern.getRowSize(r) != row.size() * bs)
+      return false;
+    size_t p = pattern.getOffsets()[r];
+    for(set<unsigned int>::const_iterator it = row.begin(); it != row.end(); ++it)
+    {
+      for(int c = 0; c < bs; c++)
+      {
+        if(pattern.getColumns()[p++] != *it * bs + c)
+          return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+void run(const char* name, const ElementBlock& block, size_t numNodes, int blockSize, int numThreads)
+{
+  auto t0 = chrono::steady_clock::now();
+  vector<set<unsigned int> > rows;
+  buildWithSets(block, numNodes, rows);
+  auto t1 = chrono::steady_clock::now();
+  SparsityPattern pattern;
+  pattern.build(block, numNodes, blockSize, false, numThreads);
+  auto t2 = chrono::steady_clock::now();
+  double millions = numNodes / 1e6;
+  cout<<name<<" block "<<blockSize<<": "<<numNodes<<" nodes, "<<pattern.getNumNonZeros()<<" non zeros"
+      <<", set "<<seconds(t0, t1)<<"s, CSR "<<seconds(t1, t2)<<"s ("<<seconds(t1, t2) / millions<<" s per million nodes, "
+      <<pattern.getMemory() / 1048576.0 / millions<<" MB per million nodes), speedup "<<seconds(t0, t1) / seconds(t1, t2)
+      <<(same(pattern, rows) ? "" : ", MISMATCH")<<endl;
+}
+
+
+// usage: sparsityBenchmark [n] [threads]
+int main(int argc, char **argv)
+{
+  size_t n = argc > 1 ? atol(argv[1]) : 1000;
+  int numThreads = argc > 2 ? atoi(argv[2]) : 0;
+  MeshData mesh;
+  generate(n, mesh);
+  const size_t numVertices = mesh.getNumNodes();
+  run("P1", mesh.getBlock(0), numVertices, 1, numThreads);
+  run("P1", mesh.getBlock(0), numVertices, 2, numThreads);
+
+  EdgeNumbering edges;
+  edges.build(mesh.getBlock(0), numThreads);
+  const ElementBlock& triangles6 = addMidEdgeNodes(mesh, edges, numThreads);
+  run("P2", triangles6, mesh.getNumNodes(), 1, numThreads);
+  run("P2", triangles6, mesh.getNumNodes(), 2, numThreads);
+  return 0;
+}
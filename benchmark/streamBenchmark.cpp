@@ -0,0 +1,119 @@
+#include <gmsh.h>
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "meshBinary.h"
+#include "memoryUsage.h"
+#include "meshData.h"
+#include "meshStream.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// same nodes in the same order and the same elements per type, the block order may differ
+bool sameMesh(const string& a, const string& b)
+{
+  MappedMesh ma, mb;
+  if(!ma.open(a) || !mb.open(b) || ma.getNumNodes() != mb.getNumNodes() || ma.getNumBlocks() != mb.getNumBlocks())
+    return false;
+  const size_t n = ma.getNumNodes();
+  if(!equal(ma.getNodeTags(), ma.getNodeTags() + n, mb.getNodeTags()) || !equal(ma.getXs(), ma.getXs() + n, mb.getXs())
+     || !equal(ma.getYs(), ma.getYs() + n, mb.getYs()) || !equal(ma.getZs(), ma.getZs() + n, mb.getZs()))
+    return false;
+  for(size_t i = 0; i < ma.getNumBlocks(); i++)
+  {
+    size_t j = 0;
+    while(j < mb.getNumBlocks() && mb.getBlockType(j) != ma.getBlockType(i))
+      j++;
+    if(j == mb.getNumBlocks() || mb.getBlockSize(j) != ma.getBlockSize(i))
+      return false;
+    const size_t size = ma.getBlockSize(i);
+    if(!equal(ma.getElementTags(i), ma.getElementTags(i) + size, mb.getElementTags(j))
+       || !equal(ma.getConnectivity(i), ma.getConnectivity(i) + size * ma.getBlockNumNodes(i), mb.getConnectivity(j)))
+      return false;
+  }
+  return true;
+}
+
+
+// extract the mesh of this process with one path, print its time and peak memory over the generated model
+void run(bool stream, size_t budget)
+{
+  const size_t base = getResidentMemory();
+  auto t0 = chrono::steady_clock::now();
+  size_t numNodes = 0, largest = 0;
+  if(stream)
+  {
+    MeshStreamer streamer;
+    MeshFileSink sink("stream.bin", budget);
+    streamer.stream(sink);
+    numNodes = streamer.getNumNodes();
+    largest = streamer.getMaxEntityNodes();
+  } else {
+    MeshData mesh;
+    mesh.loadFromGmsh();
+    writeMeshBinary(mesh, "full.bin");
+    numNodes = mesh.getNumNodes();
+    largest = numNodes;
+  }
+  double elapsed = seconds(t0);
+  cout<<(stream ? "stream    " : "full copy ")<<"  "<<numNodes<<"  "<<largest<<"  "<<elapsed
+      <<"  "<<((double)getPeakResidentMemory() - base)/1048576.0<<endl;
+}
+
+
+// usage: streamBenchmark [lc] [boxes] [budgetMB]
+// a cube of boxes^3 conformal boxes (one volume each) meshed with size lc,
+// then extracted and written to a binary mesh file by MeshData (full copy)
+// and by MeshStreamer entity by entity, each in its own process
+int main(int argc, char **argv)
+{
+  double lc = argc > 1 ? atof(argv[1]) : 0.02;
+  int boxes = argc > 2 ? atoi(argv[2]) : 4;
+  size_t budget = (size_t)(argc > 3 ? atof(argv[3]) : 16) << 20;
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 0);
+  gmsh::model::add("boxes");
+  gmsh::vectorpair objects, tools, out;
+  vector<gmsh::vectorpair> outMap;
+  for(int k = 0; k < boxes; k++)
+  {
+    for(int j = 0; j < boxes; j++)
+    {
+      for(int i = 0; i < boxes; i++)
+      {
+        int tag = gmsh::model::occ::addBox((double)i / boxes, (double)j / boxes, (double)k / boxes, 1.0 / boxes, 1.0 / boxes, 1.0 / boxes);
+        (objects.empty() ? objects : tools).push_back(make_pair(3, tag));
+      }
+    }
+  }
+  gmsh::model::occ::fragment(objects, tools, out, outMap);
+  gmsh::model::occ::synchronize();
+  gmsh::option::setNumber("Mesh.MeshSizeMax", lc);
+  auto t0 = chrono::steady_clock::now();
+  gmsh::model::mesh::generate(3);
+  cout<<"generate "<<seconds(t0)<<"s"<<endl;
+
+  cout<<"path        nodes  largest entity  extract+write(s)  peak over model(MB)"<<endl;
+  for(int stream = 0; stream < 2; stream++)
+  {
+    cout.flush();
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+      run(stream == 1, budget);
+      cout.flush();
+      _exit(0);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+  }
+  cout<<"meshes "<<(sameMesh("full.bin", "stream.bin") ? "identical" : "differ")<<endl;
+  gmsh::finalize();
+  return 0;
+}
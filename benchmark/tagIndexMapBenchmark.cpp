@@ -0,0 +1,65 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "tagIndexMap.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// node tags with the given spacing and a connectivity list of 6 references per node,
+// about what a triangle mesh has
+void generate(size_t numNodes, size_t spacing, vector<size_t>& nodeTags, vector<size_t>& connectivity)
+{
+  nodeTags.resize(numNodes);
+  for(size_t i = 0; i < numNodes; i++)
+  {
+    nodeTags[i] = 1 + i*spacing + (spacing > 1 ? rand() % spacing : 0);
+  }
+  connectivity.resize(6*numNodes);
+  for(size_t i = 0; i < connectivity.size(); i++)
+  {
+    // mostly local references, like a mesh numbered by gmsh
+    size_t j = (i/6 + rand() % 64) % numNodes;
+    connectivity[i] = nodeTags[j];
+  }
+}
+
+
+// usage: tagIndexMapBenchmark [numNodes]
+int main(int argc, char **argv)
+{
+  size_t numNodes = argc > 1 ? atol(argv[1]) : 2000000;
+  size_t spacings[3] = {1, 3, 1000};
+
+  cout<<"tags        table   build(s)  map(s)  Mtags/s  tag-1 map(s)  memory(MB)"<<endl;
+  for(int s = 0; s < 3; s++)
+  {
+    vector<size_t> nodeTags, connectivity;
+    generate(numNodes, spacings[s], nodeTags, connectivity);
+
+    auto t0 = chrono::steady_clock::now();
+    TagIndexMap index;
+    index.build(nodeTags);
+    double build = seconds(t0);
+
+    t0 = chrono::steady_clock::now();
+    vector<unsigned int> ids;
+    index.map(connectivity, ids);
+    double map = seconds(t0);
+
+    // the old assumption, only correct for dense tags starting at 1
+    t0 = chrono::steady_clock::now();
+    vector<unsigned int> unsafe(connectivity.size());
+    for(size_t i = 0; i < connectivity.size(); i++)
+    {
+      unsafe[i] = connectivity[i] - 1;
+    }
+    double direct = seconds(t0);
+
+    cout<<(s == 0 ? "dense       " : s == 1 ? "gaps x3     " : "sparse x1000")<<"  "<<(index.isDense() ? "flat " : "hash ")
+        <<"  "<<build<<"  "<<map<<"  "<<connectivity.size()/map/1e6<<"  "<<direct<<"  "<<index.memory()/1048576.0
+        <<"  ("<<ids[connectivity.size()/2] + unsafe[0]<<")"<<endl;
+  }
+  return 0;
+}
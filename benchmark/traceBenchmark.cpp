@@ -0,0 +1,83 @@
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "parallelSort.h"
+#include "trace.h"
+#include "benchmarkUtils.h"
+using namespace std;
+
+
+// a little work per scope so the loop is not optimised away
+double work(size_t i, double a)
+{
+  return a * 0.999 + (double)(i & 7);
+}
+
+double untraced(size_t n)
+{
+  double a = 0;
+  for(size_t i = 0; i < n; i++)
+  {
+    a = work(i, a);
+  }
+  return a;
+}
+
+double traced(size_t n)
+{
+  double a = 0;
+  for(size_t i = 0; i < n; i++)
+  {
+    TRACE_SCOPE("work");
+    a = work(i, a);
+  }
+  return a;
+}
+
+
+// usage: traceBenchmark [numScopes] [numThreads] [trace.json]
+int main(int argc, char **argv)
+{
+  size_t n = argc > 1 ? atol(argv[1]) : 10000000;
+  int numThreads = getNumThreads(argc > 2 ? atoi(argv[2]) : 0);
+  string filename = argc > 3 ? argv[3] : "";
+  volatile double sink = 0;
+
+  auto t0 = chrono::steady_clock::now();
+  sink = sink + untraced(n);
+  double base = seconds(t0);
+
+  t0 = chrono::steady_clock::now();
+  sink = sink + traced(n);
+  double disabled = seconds(t0);
+
+  getTracer().enable();
+  getTracer().setThreadName("main");
+  t0 = chrono::steady_clock::now();
+  sink = sink + traced(n);
+  double enabled = seconds(t0);
+
+  cout<<"scopes: "<<n<<", events kept per thread: "<<(1 << 16)<<endl;
+  cout<<"no scope          "<<base<<" s"<<endl;
+  cout<<"disabled scope    "<<disabled<<" s, "<<(disabled - base) * 1e9 / n<<" ns per scope"<<endl;
+  cout<<"enabled scope     "<<enabled<<" s, "<<(enabled - base) * 1e9 / n<<" ns per scope"<<endl;
+
+  // every thread records into its own ring, the cost should not grow with the thread count
+  getTracer().clear();
+  t0 = chrono::steady_clock::now();
+  parallelFor(n, numThreads, [&](int, size_t b, size_t e) {
+    sink = sink + traced(e - b);
+  }, 1);
+  double parallel = seconds(t0);
+  cout<<"enabled, "<<numThreads<<" threads "<<parallel<<" s, "<<parallel * numThreads * 1e9 / n<<" ns per scope and thread"<<endl;
+  cout<<"events: "<<getTracer().getNumEvents()<<", dropped: "<<getTracer().getNumDropped()<<endl;
+
+  if(!filename.empty())
+  {
+    t0 = chrono::steady_clock::now();
+    getTracer().writeChromeTrace(filename);
+    cout<<"write "<<filename<<" "<<seconds(t0)<<" s"<<endl;
+  }
+  return 0;
+}
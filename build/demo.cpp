@@ -3,33 +3,11 @@
 #include <vector> 
 #include <fstream>
 #include <iomanip>
+#include "meshData.h"
+#include "meshBinary.h"
 using namespace std;
 
 
-void writeNodes(vector<double>& nodes, string s)
-{
-	string filename = s + ".txt";
-	ofstream outfileb(filename.c_str(), ios::out);
-	for(int i = 0; i < nodes.size(); i++)
-	{
-		outfileb<<(nodes[i])<<endl;
-	}
-	outfileb.close();
-}
-
-
-void writeElements(vector<std::vector<std::size_t> >& elements, string s)
-{
-	string filename = s + ".txt";
-	ofstream outfileb(filename.c_str(), ios::out);
-	for(int i = 0; i < elements[1].size(); i++)
-	{
-		outfileb<<(elements[1][i])<<endl;
-	}
-	outfileb.close();
-}
-
-
 int main(int argc, char **argv)
 {
 	// Before using any functions in the C++ API, Gmsh must be initialized.
@@ -137,13 +115,13 @@ int main(int argc, char **argv)
 		cout<<nodes[i]<<endl;
 	}
 #endif
-	writeNodes(nodes, "nodes");
+	MeshData mesh;
+	mesh.setNodes(nodeTags, nodes);
 
 	//Elements
 	vector<int> elementTypes;
 	vector<std::vector<std::size_t> > elementTags, nodeTags2;
 	gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags2, -2, -1);
-	cout<<"The number of elements: "<<nodeTags2[1].size()/3<<endl;
 #if 0
 	cout<<endl;
 	for(int j = 0; j < nodeTags2[1].size(); j++)
@@ -152,7 +130,17 @@ int main(int argc, char **argv)
 		
 	}
 #endif
-	writeElements(nodeTags2, "elements");
+	for(int i = 0; i < elementTypes.size(); i++)
+	{
+		mesh.addBlock(elementTypes[i], elementTags[i], nodeTags2[i]);
+	}
+	// blocks are found by element type, not by their position in nodeTags2
+	cout<<"The number of elements: "<<mesh.getNumElements(2)<<endl;
+	// one binary file with page-aligned arrays, see readBinaryMesh.cpp to load it back
+	if(!writeMeshBinary(mesh, "mesh.bin"))
+	{
+		cout<<"Can not write mesh.bin"<<endl;
+	}
 
 	// ... and save it to disk
 	gmsh::write("demo.msh");
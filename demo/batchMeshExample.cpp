@@ -0,0 +1,39 @@
+#include <gmsh.h>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "batchMesher.h"
+using namespace std;
+
+
+// usage: exe [manifest] [lc] [numWorkers] [outputDirectory]
+// every polygon of the manifest (polygons.txt format) is its own case, meshed
+// on one of numWorkers long-lived worker processes and written to
+// outputDirectory/<name>.bin
+int main(int argc, char **argv)
+{
+  string filename = argc > 1 ? argv[1] : "polygons.txt";
+  double lc = argc > 2 ? atof(argv[2]) : 0.2;
+  int numWorkers = argc > 3 ? atoi(argv[3]) : 4;
+  string outputDirectory = argc > 4 ? argv[4] : "batch";
+
+  // once for the whole batch, the workers inherit it
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 0);
+
+  BatchMesher mesher(numWorkers, lc);
+  vector<PolygonRecord> cases;
+  if(!mesher.readManifest(filename, cases) || !mesher.run(cases, outputDirectory))
+  {
+    cout<<mesher.getError()<<endl;
+    gmsh::finalize();
+    return 1;
+  }
+  for(size_t i = 0; i < cases.size(); i++)
+  {
+    cout<<cases[i].getName()<<": "<<mesher.getNumElements(i)<<" triangles"<<endl;
+  }
+  mesher.printReport(cout);
+  gmsh::finalize();
+  return mesher.getNumFailed() > 0 ? 1 : 0;
+}
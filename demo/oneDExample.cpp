@@ -6,6 +6,14 @@
 #include <string>
 #include <map>
 #include <set>
+#include <algorithm>
+#include "boundaryLoops.h"
+#include "meshCache.h"
+#include "meshData.h"
+#include "phaseTimer.h"
+#include "regionInterfaces.h"
+#include "trace.h"
+#include "vertexWelder.h"
 
 using namespace std;
 
@@ -20,23 +28,11 @@ public:
     void setX(const double x) {_x = x;}
     void setY(const double y) {_y = y;}
     void setZ(const double z) {_z = z;}
-    bool operator < (const Point& p) const;
     
 protected:
     double _x, _y, _z;
 };
 
-bool Point::operator < (const Point& p) const
-{
-    double px = p.getX();
-    double py = p.getY();
-    if(px == _x) {
-        return py < _y;
-    } else {
-        return px < _x;
-    }
-}
-
 
 class Polygon
 {
@@ -65,22 +61,11 @@ public:
     const int getSecondId() const {return _secondId;}
     void setFirstId(const int firstId) {_firstId = firstId;}
     void setSecondId(const int secondId) {_secondId= secondId;}
-    bool operator < (const Topology& topo) const;
     
 private:
     int _firstId, _secondId;
 };
 
-bool Topology::operator < (const Topology& topo) const
-{
-    int tof = topo.getFirstId();
-    int tos = topo.getSecondId();
-    if(tof == _firstId) {
-        return tos < _secondId;
-    } else {
-        return tof < _firstId;
-    }
-}
 
 class Segment
 {
@@ -198,12 +183,33 @@ void generatePolygons(vector<Polygon>& region)
 
 int main(int argc, char **argv)
 {
-	clock_t start, finish;
-	start = clock();
-
-	gmsh::initialize();
-    gmsh::option::setNumber("General.Terminal", 1);
-    gmsh::model::add("demo");
+    // "./oneDExample -c" keeps the mesh and the extracted arrays in meshCache/,
+    // keyed on the polygons, lc and the mesh options: a rerun with the same input skips generate;
+    // "-t" writes trace.json (chrome://tracing or ui.perfetto.dev) with every gmsh call and our stages;
+    // "-i" meshes every polygon as its own surface and writes the interfaces between them to interfaces.txt
+    bool useCache = false, useTrace = false, useInterfaces = false;
+    for(int i = 1; i < argc; i++)
+    {
+        useCache = useCache || string(argv[i]) == "-c";
+        useTrace = useTrace || string(argv[i]) == "-t";
+        useInterfaces = useInterfaces || string(argv[i]) == "-i";
+    }
+    // the interfaces are taken from the gmsh mesh, which a cache hit does not have
+    if(useInterfaces)
+        useCache = false;
+    if(useTrace)
+    {
+        getTracer().enable();
+        getTracer().setThreadName("main");
+    }
+    // wall clock time per phase, clock() only counted CPU time, and the memory at every phase boundary
+    PhaseTimer timer;
+    timer.setTrackMemory(true);
+    timer.start("initialize");
+    TRACE_CALL(gmsh::initialize());
+    TRACE_CALL(gmsh::option::setNumber("General.Terminal", 1));
+    TRACE_CALL(gmsh::model::add("demo"));
+    timer.start("geometry");
     
     double lc = 0.8;
     vector<Polygon> region;
@@ -217,172 +223,226 @@ int main(int argc, char **argv)
     int ct_point = 1;
     int ct_line = 1;
     
-    // record the points where the previous polygon was inserted
-    map<Point, int> recPoints;
+    // record the points where the previous polygon was inserted,
+    // vertices closer than weldEps are the same point (z included)
+    double weldEps = 1e-9;
+    VertexWelder recPoints(weldEps);
     // record the line where the previous polygon wsa inserted
-    map<Topology, int> recLines;
+    EdgeTable recLines;
     vector<vector<int> > domElelIds(region.size());
     for(int i = 0; i < region.size(); i++)
     {
+        TRACE_SCOPE_ARG("polygon", i);
         loop.clear();
         Polygon poly = region[i];
         const vector<Point>& vertex = poly.getVertex();
         for(int j = 0; j < vertex.size(); j++)
         {
             Point p = vertex[j];
-            auto iter = recPoints.find(p);
-            if(iter == recPoints.end())
+            x = p.getX();
+            y = p.getY();
+            z = p.getZ();
+            bool isNew;
+            // welder ids are given in insertion order, so a point's tag is its id + 1
+            int id = recPoints.insert(x, y, z, &isNew);
+            if(isNew)
             {
-                x = p.getX();
-                y = p.getY();
-                z = p.getZ();
-                gmsh::model::geo::addPoint(x, y, z, lc, ct_point);
-                recPoints[p] = ct_point;
-                loop.push_back(ct_point);
+                TRACE_CALL(gmsh::model::geo::addPoint(x, y, z, lc, ct_point));
                 ct_point++;
-            } else {
-                loop.push_back(iter->second);
             }
+            loop.push_back(id + 1);
         }
         curveloop.clear();
         for(int j = 0; j < loop.size(); j++)
         {
             int l1 = loop[j];
             int l2 = j == loop.size()-1 ? loop[0] : loop[j+1];
-            Topology topo(l1, l2);
-            Topology topo2(l2, l1);
-            auto iterl = recLines.find(topo);
-            auto iterl2 = recLines.find(topo2);
-            bool flag = (iterl == recLines.end()) && (iterl2 == recLines.end());
-            if(flag)
+            int line = recLines.find(l1, l2);
+            if(line == 0)
             {
-                gmsh::model::geo::addLine(l1, l2, ct_line);
-                recLines[topo] = ct_line;
-                recLines[topo2] = -ct_line;
+                TRACE_CALL(gmsh::model::geo::addLine(l1, l2, ct_line));
+                recLines.insert(l1, l2, ct_line);
                 curveloop.push_back(ct_line);
                 ct_line++;
             } else {
-                if(iterl != recLines.end())
-                    curveloop.push_back(iterl->second);
-                else
-                    curveloop.push_back(iterl2->second);
+                curveloop.push_back(line);
             }
         }
-        planeSurface.push_back(gmsh::model::geo::addCurveLoop(curveloop));
-        tag = gmsh::model::addPhysicalGroup(dim, curveloop);
+        planeSurface.push_back(TRACE_CALL(gmsh::model::geo::addCurveLoop(curveloop)));
+        tag = TRACE_CALL(gmsh::model::addPhysicalGroup(dim, curveloop));
         string name = "Polygon_" + to_string(i);
-        gmsh::model::setPhysicalName(dim, tag, name);
+        TRACE_CALL(gmsh::model::setPhysicalName(dim, tag, name));
         domElelIds[i] = curveloop;
     }
     
-    gmsh::model::geo::addPlaneSurface(planeSurface);
+    vector<int> surfaces;
+    if(useInterfaces)
+    {
+        // one plane surface per polygon, so that every polygon is a region of the 2D mesh
+        for(int i = 0; i < planeSurface.size(); i++)
+        {
+            surfaces.push_back(TRACE_CALL(gmsh::model::geo::addPlaneSurface(vector<int>(1, planeSurface[i]))));
+        }
+    } else {
+        TRACE_CALL(gmsh::model::geo::addPlaneSurface(planeSurface));
+    }
     
     dim = 1;
-    gmsh::model::addPhysicalGroup(dim, planeSurface);
-    
-    gmsh::model::geo::synchronize();
+    TRACE_CALL(gmsh::model::addPhysicalGroup(dim, planeSurface));
     
-    gmsh::model::mesh::generate(1);
-
-#if 1
-    clock_t info_s, info_e;
-    info_s = clock();
-    // get Mesh information
+    timer.start("synchronize");
+    TRACE_CALL(gmsh::model::geo::synchronize());
     
-    // get Nodes
-    dim = -1;
-    tag = -1;
-    bool includeBoundary = false;
-    vector<double> coord, parametricCoord;
-    vector<size_t> nodeTags;
-    gmsh::model::mesh::getNodes(nodeTags, coord, parametricCoord, dim, tag, includeBoundary, true);
-    cout<<"The number of nodes: "<<coord.size()/3<<endl;
-    vector<Point> nodes;
-    nodes.reserve(1000);
-    Point p;
-    for(int i = 0; i < coord.size(); i+=3)
+    MeshCacheKey cacheKey;
+    cacheKey.add(string("oneDExample"));
+    // the boundary ids are stored in loop order
+    cacheKey.add(string("orderedLoops"));
+    cacheKey.add((long long)dim);
+    for(int i = 0; i < region.size(); i++)
     {
-        x = coord[i];
-        y = coord[i+1];
-        z = coord[i+2];
-        p = Point(x, y, z);
-        nodes.push_back(p);
+        const vector<Point>& vertex = region[i].getVertex();
+        cacheKey.add((long long)vertex.size());
+        for(int j = 0; j < vertex.size(); j++)
+        {
+            cacheKey.addPoint(vertex[j].getX(), vertex[j].getY(), vertex[j].getZ(), lc);
+        }
     }
-    
-    // get Elemetnts
-    dim = 1;
-    tag = -1;
-    vector<int> elementTypes;
-    vector<vector<size_t> > elemetTags, nodeTagss;
-    gmsh::model::mesh::getElements(elementTypes, elemetTags, nodeTagss, dim, tag);
-    cout<<"The number of elemnets: "<<nodeTagss[0].size()/2<<endl;
-    Topology topo;
-    Element ele;
-    Point p1, p2;
-    unsigned int id1, id2;
-    for(int i = 0; i < nodeTagss[0].size(); i+=2)
+    cacheKey.addGmshMeshOptions();
+    string key = cacheKey.getKey();
+    MeshCache cache;
+    MeshCacheArrays cached;
+    MeshData mesh;
+    vector<unsigned int> boundaryNodesIds;
+    vector<int> boundaryElementsIds;
+    bool hit = false;
+    if(useCache)
     {
-        id1 = nodeTagss[0][i] - 1;
-        id2 = nodeTagss[0][i+1] - 1;
-        p1 = nodes[id1];
-        p2 = nodes[id2];
-        ele = Element(p1, p2, topo);
+        timer.start("cache");
+        hit = cache.load(key, mesh, cached);
     }
-    
-    // get polygon nodes id and it's coordinate information
-    // coord is coordinate information (x1, y1, z1, .......)
-    dim = 1;
-    vector<size_t> bouNodesIds;
-    // boundaryTag = tag = gmsh::model::addPhysicalGroup(dim, curveloop)
-    // then we can get one polygon points id on edges
-    int boundaryTag = 1;
-    gmsh::model::mesh::getNodesForPhysicalGroup(dim, boundaryTag, bouNodesIds, coord);
-    vector<unsigned int> boundaryNodesIds(bouNodesIds.size());
-    // just because index from star 0
-    for(int i = 0; i < bouNodesIds.size(); i++)
+
+    if(hit)
     {
-        boundaryNodesIds[i] = bouNodesIds[i]-1;
-        //cout<<boundaryNodesIds[i]<<endl;
-    }
+        cached.get("boundaryNodesIds", boundaryNodesIds);
+        cached.get("boundaryElementsIds", boundaryElementsIds);
+        cout<<"The number of nodes: "<<mesh.getNumNodes()<<endl;
+    } else {
+        timer.start("generate");
+        TRACE_CALL(gmsh::model::mesh::generate(useInterfaces ? 2 : 1));
+
+        timer.start("extract");
+        // get Mesh information
     
-    // get polygon arround elemnt id
-    // bcurveLoop is line's tag(id) of one polygon
-    // then we can get elemnts id of one polygon
-    vector<int> bcurveLoop = domElelIds[0];
-    vector<int> boundaryElementsIds;
-    dim = 1;
-    int dim2 = 1;
-    bool strict = true;
-    double xx, yy, zz;
-    vector<size_t> elemetTag;
-    for(int i = 0; i < bcurveLoop.size(); i++)
-    {
-        tag = abs(bcurveLoop[i]);
-        gmsh::model::mesh::getElements(elementTypes, elemetTags, nodeTagss, dim, tag);
-        for(int k = 0; k < nodeTagss[0].size(); k+=2)
+        // get Nodes
+        dim = -1;
+        tag = -1;
+        bool includeBoundary = false;
+        vector<double> coord, parametricCoord;
+        vector<size_t> nodeTags;
+        TRACE_CALL(gmsh::model::mesh::getNodes(nodeTags, coord, parametricCoord, dim, tag, includeBoundary, true));
+        cout<<"The number of nodes: "<<coord.size()/3<<endl;
+        // contiguous x / y / z arrays sized from the gmsh node count
+        mesh.setNodes(nodeTags, coord);
+    
+        // get Elemetnts
+        dim = 1;
+        tag = -1;
+        vector<int> elementTypes;
+        vector<vector<size_t> > elemetTags, nodeTagss;
+        TRACE_CALL(gmsh::model::mesh::getElements(elementTypes, elemetTags, nodeTagss, dim, tag));
+        int line = findElementType(elementTypes, LINE);
+        if(line < 0)
+        {
+            cout<<"No line elements in the mesh"<<endl;
+            TRACE_CALL(gmsh::finalize());
+            return 1;
+        }
+        mesh.addBlock(LINE, elemetTags[line], nodeTagss[line]);
+    
+        // the boundary of the first polygon as one ordered counterclockwise loop: its nodes and
+        // its line elements in walking order, where getNodesForPhysicalGroup has no order
+        // boundaryTag = tag = gmsh::model::addPhysicalGroup(dim, curveloop)
+        timer.start("adjacency");
+        int boundaryTag = 1;
+        BoundaryLoops loops;
+        loops.buildForPhysicalGroup(mesh, boundaryTag, LOOP_COUNTERCLOCKWISE);
+        loops.getNodes(boundaryNodesIds);
+        // line element tag -> position in the LINE block
+        TagIndexMap elementIndex;
+        elementIndex.build(elemetTags[line]);
+        for(size_t c = 0; c < loops.size(); c++)
+        {
+            for(size_t i = 0; i < loops.getNumSegments(c); i++)
+            {
+                boundaryElementsIds.push_back((int)elementIndex.find(loops.getSegmentTag(c, i)));
+            }
+        }
+
+        if(useInterfaces)
         {
-            id1 = nodeTagss[0][k]-1;
-            id2 = nodeTagss[0][k+1]-1;
-            xx = (nodes[id1].getX() + nodes[id2].getX())/2.0;
-            yy = (nodes[id1].getY() + nodes[id2].getY())/2.0;
-            zz = (nodes[id1].getZ() + nodes[id2].getZ())/2.0;
-            gmsh::model::mesh::getElementsByCoordinates(xx, yy, zz, elemetTag, dim2, strict);
-            for(int kk= 0; kk < elemetTag.size(); kk++)
+            // nodes, segments and the triangles on both sides of every pair of polygons that share
+            // an edge, from one pass over the triangle edges
+            timer.start("interfaces");
+            RegionInterfaces interfaces;
+            interfaces.buildForSurfaces(mesh, surfaces);
+            for(size_t i = 0; i < interfaces.size(); i++)
             {
-                boundaryElementsIds.push_back(elemetTag[kk]-1);
+                cout<<"Interface "<<region[interfaces.getRegionA(i)].getName()<<" - "<<region[interfaces.getRegionB(i)].getName()<<": "
+                    <<interfaces.getNodes(i).size()<<" nodes, "<<interfaces.getNumSegments(i)<<" segments, "<<interfaces.getNumChains(i)<<" chains"<<endl;
             }
+            ofstream out("interfaces.txt");
+            interfaces.write(out, mesh);
         }
-        if(bcurveLoop[i] < 0)
+
+        if(useCache)
         {
-            reverse(boundaryElementsIds.begin(), boundaryElementsIds.end());
+            timer.start("cache");
+            cached.put("boundaryNodesIds", boundaryNodesIds);
+            cached.put("boundaryElementsIds", boundaryElementsIds);
+            cache.store(key, mesh, cached);
         }
     }
-    info_e = clock();
-#endif
-    gmsh::write("demo.msh");
-    gmsh::finalize();
-    finish = clock();
-    cout<<"The run time of get information: "<<(double)(info_e - info_s)/CLOCKS_PER_SEC<<"s"<<endl;
-    cout<<"The run time is: "<<(double)(finish - start)/CLOCKS_PER_SEC<<"s"<<endl;
+
+    const ElementBlock& block = *mesh.findBlock(LINE);
+    // fixed stride of 2 node ids, known at compile time
+    TypedBlockView<LINE> segments = block.view<LINE>();
+    cout<<"The number of elemnets: "<<segments.size()<<endl;
+    Topology topo;
+    Element ele;
+    Point p1, p2;
+    unsigned int id1, id2;
+    for(size_t i = 0; i < segments.size(); i++)
+    {
+        id1 = segments.node(i, 0);
+        id2 = segments.node(i, 1);
+        p1 = Point(mesh.getX(id1), mesh.getY(id1), mesh.getZ(id1));
+        p2 = Point(mesh.getX(id2), mesh.getY(id2), mesh.getZ(id2));
+        ele = Element(p1, p2, topo);
+    }
+
+    timer.start("write");
+    // a hit has no gmsh mesh, the stored file is what gmsh::write gave
+    if(hit)
+        cache.copyGmshMesh(key, "demo.msh");
+    else
+        TRACE_CALL(gmsh::write("demo.msh"));
+    timer.start("finalize");
+    TRACE_CALL(gmsh::finalize());
+    timer.stop();
+    cout<<"The run time of get information: "<<timer.getSeconds("extract") + timer.getSeconds("adjacency")<<"s"<<endl;
+    cout<<"The run time is: "<<timer.getTotalSeconds()<<"s"<<endl;
+    timer.writeJson(cout);
+    cout<<endl;
+    cout<<"The mesh arrays hold "<<mesh.getMemory() / 1024.0<<" KB"<<endl;
+    timer.printReport(cout);
+    timer.writeMemoryJson(cout);
+    cout<<endl;
+    if(useCache)
+        cache.printStats(cout);
+    if(useTrace)
+    {
+        getTracer().writeChromeTrace("trace.json");
+        cout<<"trace.json: "<<getTracer().getNumEvents()<<" events, "<<getTracer().getNumDropped()<<" dropped"<<endl;
+    }
     return 0;
 }
@@ -0,0 +1,50 @@
+#include <gmsh.h>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "polygonReader.h"
+#include "parallelMesher.h"
+#include "meshBinary.h"
+using namespace std;
+
+
+// usage: exe [polygons.txt] [lc] [numWorkers]
+// every polygon is meshed on its own worker process, the shared edges are
+// meshed once first so the merged mesh is conformal
+int main(int argc, char **argv)
+{
+  string filename = argc > 1 ? argv[1] : "polygons.txt";
+  double lc = argc > 2 ? atof(argv[2]) : 0.2;
+  int numWorkers = argc > 3 ? atoi(argv[3]) : 4;
+
+  gmsh::initialize();
+  gmsh::model::add("polygons");
+
+  PolygonReader reader;
+  GmshPolygonSink sink(lc);
+  if(!reader.open(filename) || (reader.stream(sink), !reader.getError().empty()))
+  {
+    cout<<reader.getError()<<endl;
+    gmsh::finalize();
+    return 1;
+  }
+  sink.finish();
+
+  MeshData mesh;
+  ParallelMesher mesher(numWorkers);
+  if(!mesher.generate(sink.getSurfaceTags(), mesh))
+  {
+    cout<<mesher.getError()<<endl;
+    gmsh::finalize();
+    return 1;
+  }
+  cout<<"The number of regions: "<<sink.getNumPolygons()<<", workers: "<<mesher.getNumWorkers()<<endl;
+  cout<<"The number of nodes: "<<mesh.getNumNodes()<<endl;
+  cout<<"The number of elements: "<<mesh.findBlock(2)->size()<<endl;
+  mesher.getTimer().writeJson(cout);
+  cout<<endl;
+
+  writeMeshBinary(mesh, "mesh.bin");
+  gmsh::finalize();
+  return 0;
+}
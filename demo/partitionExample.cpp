@@ -0,0 +1,90 @@
+#include <gmsh.h>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <sys/stat.h>
+#include "meshPartitioner.h"
+#include "phaseTimer.h"
+using namespace std;
+
+
+// usage: exe [numParts] [rcb|rib|gmsh] [numLayers] [lc]
+// mesh a plate with a square hole, cut its triangles into numParts parts with ghost
+// layers and write parts/part_<p>.bin and parts/part_<p>.txt for every part
+int main(int argc, char **argv)
+{
+  int numParts = argc > 1 ? atoi(argv[1]) : 4;
+  string methodName = argc > 2 ? argv[2] : "rcb";
+  int numLayers = argc > 3 ? atoi(argv[3]) : 1;
+  double lc = argc > 4 ? atof(argv[4]) : 0.02;
+  PartitionMethod method = methodName == "rib" ? PARTITION_INERTIAL : methodName == "gmsh" ? PARTITION_GMSH : PARTITION_COORDINATE;
+
+  PhaseTimer timer;
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 0);
+  gmsh::model::add("plate");
+  timer.start("geometry");
+  gmsh::model::geo::addPoint(0, 0, 0, lc, 1);
+  gmsh::model::geo::addPoint(2, 0, 0, lc, 2);
+  gmsh::model::geo::addPoint(2, 1, 0, lc, 3);
+  gmsh::model::geo::addPoint(0, 1, 0, lc, 4);
+  gmsh::model::geo::addPoint(0.4, 0.3, 0, lc, 5);
+  gmsh::model::geo::addPoint(0.8, 0.3, 0, lc, 6);
+  gmsh::model::geo::addPoint(0.8, 0.7, 0, lc, 7);
+  gmsh::model::geo::addPoint(0.4, 0.7, 0, lc, 8);
+  for(int i = 0; i < 4; i++)
+  {
+    gmsh::model::geo::addLine(1 + i, 1 + (i + 1) % 4, 1 + i);
+    gmsh::model::geo::addLine(5 + i, 5 + (i + 1) % 4, 5 + i);
+  }
+  gmsh::model::geo::addCurveLoop({1, 2, 3, 4}, 1);
+  gmsh::model::geo::addCurveLoop({5, 6, 7, 8}, 2);
+  gmsh::model::geo::addPlaneSurface({1, -2}, 1);
+  gmsh::model::geo::synchronize();
+  timer.start("generate");
+  gmsh::option::setNumber("Mesh.MeshSizeMax", lc);
+  gmsh::model::mesh::generate(2);
+  timer.start("extract");
+  MeshData mesh;
+  mesh.loadFromGmsh(2);
+  const ElementBlock* block = mesh.findBlock(TRIANGLE);
+  if(!block)
+  {
+    cout<<"no triangles"<<endl;
+    gmsh::finalize();
+    return 1;
+  }
+
+  MeshPartitioner partitioner;
+  timer.start("partition");
+  partitioner.partition(mesh, *block, numParts, method);
+  timer.start("ghosts");
+  partitioner.buildPartitions(mesh, *block, numLayers);
+  timer.start("write");
+  mkdir("parts", 0755);
+  bool written = partitioner.write(mesh, *block, "parts/part");
+  timer.stop();
+  gmsh::finalize();
+
+  PartitionQuality quality = partitioner.getQuality(*block);
+  cout<<"The number of triangles: "<<block->size()<<", parts: "<<partitioner.getNumParts()<<" ("<<methodName<<"), ghost layers: "<<numLayers<<endl;
+  cout<<"edge cut: "<<quality._edgeCut<<", imbalance: "<<quality._imbalance<<" ("<<quality._minElements<<" .. "<<quality._maxElements<<" triangles)"
+      <<", ghost triangles: "<<quality._ghostElements<<", ghost nodes: "<<quality._ghostNodes<<endl;
+  for(int p = 0; p < partitioner.getNumParts(); p++)
+  {
+    const MeshPartition& part = partitioner.getPartition(p);
+    cout<<"part "<<p<<": "<<part._layerOffsets[1]<<" triangles + "<<part._elements.size() - part._layerOffsets[1]<<" ghosts, "
+        <<part._numOwnedNodes<<" owned nodes + "<<part._nodes.size() - part._numOwnedNodes<<" received, neighbours";
+    for(size_t k = 0; k < part._neighbours.size(); k++)
+      cout<<" "<<part._neighbours[k];
+    cout<<endl;
+  }
+  for(size_t i = 0; i < timer.getPhases().size(); i++)
+    cout<<timer.getPhases()[i]<<": "<<timer.getSeconds(timer.getPhases()[i])<<" s"<<endl;
+  if(!written)
+  {
+    cout<<"could not write parts/"<<endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,56 @@
+#include <gmsh.h>
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "polygonReader.h"
+#include "phaseTimer.h"
+using namespace std;
+
+
+// usage: exe [polygons.txt] [lc] [batchSize]
+int main(int argc, char **argv)
+{
+  string filename = argc > 1 ? argv[1] : "polygons.txt";
+  double lc = argc > 2 ? atof(argv[2]) : 0.4;
+  int batchSize = argc > 3 ? atoi(argv[3]) : 1024;
+
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 1);
+  gmsh::model::add("polygons");
+
+  // the file is read line by line and pushed to gmsh in batches,
+  // synchronize is called once at the end
+  PhaseTimer timer;
+  timer.start("read");
+  PolygonReader reader;
+  GmshPolygonSink sink(lc);
+  if(!reader.open(filename))
+  {
+    cout<<reader.getError()<<endl;
+    gmsh::finalize();
+    return 1;
+  }
+  reader.stream(sink, batchSize);
+  if(!reader.getError().empty())
+  {
+    cout<<reader.getError()<<endl;
+    gmsh::finalize();
+    return 1;
+  }
+  timer.start("synchronize");
+  sink.finish();
+  timer.start("generate");
+  gmsh::model::mesh::generate(2);
+  timer.stop();
+
+  cout<<"The number of polygons: "<<sink.getNumPolygons()<<endl;
+  cout<<"The number of points: "<<sink.getNumPoints()<<", lines: "<<sink.getNumLines()<<endl;
+  cout<<"The read time is: "<<timer.getSeconds("read")<<"s ("
+      <<sink.getNumPolygons()/timer.getSeconds("read")<<" polygons/s)"<<endl;
+  timer.writeJson(cout);
+  cout<<endl;
+
+  gmsh::write("demo.msh");
+  gmsh::finalize();
+  return 0;
+}
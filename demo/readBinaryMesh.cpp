@@ -0,0 +1,55 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "meshBinary.h"
+using namespace std;
+
+
+// load a mesh written by demo.cpp without parsing: the file is mapped and
+// the arrays are used in place
+int main(int argc, char **argv)
+{
+	string filename = argc > 1 ? argv[1] : "mesh.bin";
+
+	auto start = chrono::steady_clock::now();
+	MappedMesh mesh;
+	if(!mesh.open(filename))
+	{
+		cout<<"Can not read "<<filename<<endl;
+		return 1;
+	}
+	double openTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	cout<<"The number of nodes: "<<mesh.getNumNodes()<<endl;
+	for(size_t i = 0; i < mesh.getNumBlocks(); i++)
+	{
+		cout<<"Element type "<<mesh.getBlockType(i)<<": "<<mesh.getBlockSize(i)<<" elements"<<endl;
+	}
+
+	// open() only checked the header and the array ranges: check every node id before
+	// using it as an index, this is where the connectivity pages are actually read
+	if(!mesh.validateConnectivity())
+	{
+		cout<<filename<<" has a node id out of range"<<endl;
+		return 1;
+	}
+
+	// touch every triangle, this reads the coordinate pages
+	const double* x = mesh.getXs();
+	const double* y = mesh.getYs();
+	double area = 0;
+	for(size_t b = 0; b < mesh.getNumBlocks(); b++)
+	{
+		if(mesh.getBlockType(b) != TRIANGLE)
+			continue;
+		for(size_t i = 0; i < mesh.getBlockSize(b); i++)
+		{
+			ElementView tri = mesh.getElement(b, i);
+			area += 0.5*((x[tri[1]] - x[tri[0]])*(y[tri[2]] - y[tri[0]]) - (x[tri[2]] - x[tri[0]])*(y[tri[1]] - y[tri[0]]));
+		}
+	}
+	double totalTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	cout<<"Total triangle area: "<<area<<endl;
+	cout<<"The open time is: "<<openTime<<"s, with every node id checked and all triangles read: "<<totalTime<<"s"<<endl;
+	return 0;
+}
@@ -0,0 +1,38 @@
+#include <gmsh.h>
+#include <iostream>
+#include <cstdlib>
+#include "meshStream.h"
+using namespace std;
+
+
+// usage: exe [lc] [budgetMB]
+// mesh a unit cube and write mesh.bin entity by entity within budgetMB of
+// buffers, without a full copy of the mesh; readBinaryMesh.cpp reads it back
+int main(int argc, char **argv)
+{
+  double lc = argc > 1 ? atof(argv[1]) : 0.05;
+  size_t budget = (size_t)(argc > 2 ? atof(argv[2]) : 16) << 20;
+
+  gmsh::initialize();
+  gmsh::option::setNumber("General.Terminal", 1);
+  gmsh::model::add("cube");
+  gmsh::model::occ::addBox(0, 0, 0, 1, 1, 1);
+  gmsh::model::occ::synchronize();
+  gmsh::option::setNumber("Mesh.MeshSizeMax", lc);
+  gmsh::model::mesh::generate(3);
+
+  MeshStreamer streamer;
+  MeshFileSink sink("mesh.bin", budget);
+  streamer.stream(sink);
+  if(!sink.getError().empty())
+  {
+    cout<<sink.getError()<<endl;
+    gmsh::finalize();
+    return 1;
+  }
+  cout<<"The number of nodes: "<<streamer.getNumNodes()<<endl;
+  cout<<"The number of elements: "<<streamer.getNumElements()<<endl;
+  cout<<"The number of entities: "<<streamer.getNumEntities()<<", largest: "<<streamer.getMaxEntityNodes()<<" nodes"<<endl;
+  gmsh::finalize();
+  return 0;
+}
@@ -3,33 +3,15 @@
 #include <vector> 
 #include <fstream>
 #include <iomanip>
+#include <string>
+#include "elementTypes.h"
+#include "faceAdjacency.h"
+#include "meshData.h"
+#include "meshQuality.h"
+#include "meshReorder.h"
 using namespace std;
 
 
-void writeNodes(vector<double>& nodes, string s)
-{
-	string filename = s + ".txt";
-	ofstream outfileb(filename.c_str(), ios::out);
-	for(int i = 0; i < nodes.size(); i++)
-	{
-		outfileb<<(nodes[i])<<endl;
-	}
-	outfileb.close();
-}
-
-
-void writeElements(vector<std::vector<std::size_t> >& elements, string s)
-{
-	string filename = s + ".txt";
-	ofstream outfileb(filename.c_str(), ios::out);
-	for(int i = 0; i < elements[1].size(); i++)
-	{
-		outfileb<<(elements[1][i])<<endl;
-	}
-	outfileb.close();
-}
-
-
 int main(int argc, char **argv)
 {
 	// Before using any functions in the C++ API, Gmsh must be initialized.
@@ -127,7 +109,15 @@ int main(int argc, char **argv)
   	// phsyical volumes) followed by a vector of entity tags. The last (optional)
   	// argument is the tag of the new group to create.
 
+    gmsh::model::addPhysicalGroup(3, {1}, 1);
 	  gmsh::model::setPhysicalName(3, 1, "My volume");
+    // the bottom, the top and the four sides of the cube
+    gmsh::model::addPhysicalGroup(2, {1}, 1);
+    gmsh::model::setPhysicalName(2, 1, "Bottom");
+    gmsh::model::addPhysicalGroup(2, {2}, 2);
+    gmsh::model::setPhysicalName(2, 2, "Top");
+    gmsh::model::addPhysicalGroup(2, {3, 4, 5, 6}, 3);
+    gmsh::model::setPhysicalName(2, 3, "Sides");
 
     // Before it can be meshed, the internal CAD representation must be
     // synchronized with the Gmsh model, which will create the relevant Gmsh data
@@ -144,38 +134,88 @@ int main(int argc, char **argv)
 
     
     //gmsh::model::mesh::recombine();
-#if 0
     // get mesh information
     // Nodes
-    vector<double> nodes,y;
+    vector<double> nodes, y;
     vector<std::size_t> nodeTags;
-    gmsh::model::mesh::getNodes(nodeTags, nodes, y, -2, -1, false, true);
+    gmsh::model::mesh::getNodes(nodeTags, nodes, y, -1, -1, false, false);
     cout<<"The number of nodes: "<<nodes.size()/3<<endl;
-  #if 0
-    cout<<endl;
-    for(int i = 0; i < nodes.size(); i++)
-    {
-      cout<<nodes[i]<<endl;
-    }
-  #endif
-    writeNodes(nodes, "gmshNodes");
+    MeshData mesh;
+    mesh.setNodes(nodeTags, nodes);
 
     //Elements
+    // one call for every block, the tetrahedra are picked by type
     vector<int> elementTypes;
     vector<std::vector<std::size_t> > elementTags, nodeTags2;
-    gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags2, -2, -1);
-    cout<<"The number of elements: "<<nodeTags2[1].size()/3<<endl;
-  #if 0
-    cout<<endl;
-    for(int j = 0; j < nodeTags2[1].size(); j++)
+    gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags2, -1, -1);
+    int tet = findElementType(elementTypes, TETRAHEDRON);
+    if(tet < 0)
     {
-      cout<<nodeTags2[1][j]<<endl;
+      cout<<"No tetrahedra in the mesh"<<endl;
+      gmsh::finalize();
+      return 1;
+    }
+    const ElementBlock& tets = mesh.addBlock(TETRAHEDRON, elementTags[tet], nodeTags2[tet]);
+    cout<<"The number of elements: "<<tets.size()<<endl;
+
+    // "./threeDDemo -r" renumbers the nodes (RCM) and the tetrahedra (Hilbert curve)
+    // before the face table is built, so every id below is in the new numbering
+    if(argc > 1 && string(argv[1]) == "-r")
+    {
+      size_t bandwidth;
+      unsigned long long profile;
+      measureBandwidth(mesh, bandwidth, profile);
+      cout<<"Bandwidth / profile before: "<<bandwidth<<" / "<<profile<<endl;
+      MeshReorder reorderer;
+      reorderer.reorderNodes(mesh);
+      reorderer.reorderElements(mesh);
+      measureBandwidth(mesh, bandwidth, profile);
+      cout<<"Bandwidth / profile after: "<<bandwidth<<" / "<<profile<<endl;
+    }
+
+    // face -> tetrahedron table, the neighbours and the boundary come from it
+    FaceAdjacency faces;
+    faces.build(tets);
+    cout<<"The number of faces: "<<faces.getNumFaces()<<endl;
+    cout<<"The number of boundary faces: "<<faces.getBoundaryFaces().size()<<endl;
+    if(faces.getNumDegenerate() > 0)
+      cout<<"Skipped "<<faces.getNumDegenerate()<<" tetrahedra with a repeated vertex"<<endl;
+    // tetrahedron across every face, -1 on the boundary
+    vector<int> neighbours(4 * tets.size());
+    for(size_t i = 0; i < tets.size(); i++)
+    {
+      for(int j = 0; j < 4; j++)
+      {
+        neighbours[4*i+j] = faces.getNeighbour(i, j);
+      }
+    }
 
+    // boundary faces of every physical surface and the tetrahedra next to them
+    gmsh::vectorpair physicalSurfaces;
+    gmsh::model::getPhysicalGroups(physicalSurfaces, 2);
+    vector<vector<int> > boundaryFaces(physicalSurfaces.size()), boundaryElementsIds(physicalSurfaces.size());
+    for(int i = 0; i < physicalSurfaces.size(); i++)
+    {
+      faces.getFacesOnPhysicalGroup(physicalSurfaces[i].second, mesh.getNodeIndex(), boundaryFaces[i]);
+      faces.getElementsOnFaces(boundaryFaces[i], boundaryElementsIds[i]);
+      string name;
+      gmsh::model::getPhysicalName(2, physicalSurfaces[i].second, name);
+      cout<<name<<": "<<boundaryFaces[i].size()<<" faces, "<<boundaryElementsIds[i].size()<<" elements"<<endl;
     }
-  #endif
-    writeElements(nodeTags2, "gmshElements");
 
-#endif
+    // quality check before the mesh goes to disk: no inverted tetrahedron and no dihedral angle below 5 degrees
+    MeshQuality quality;
+    quality.compute(mesh, tets);
+    printQualityReport(cout, quality, tets);
+    QualityThresholds thresholds;
+    thresholds.minAngle = 5;
+    size_t rejected = quality.check(thresholds);
+    if(rejected > 0)
+    {
+      cout<<rejected<<" elements fail the quality check, demo.msh is not written"<<endl;
+      gmsh::finalize();
+      return 1;
+    }
 
     // ... and save it to disk
     gmsh::write("demo.msh");
@@ -4,6 +4,17 @@
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <cstdlib>
+#include "boundaryLoops.h"
+#include "edgeNumbering.h"
+#include "meshAdjacency.h"
+#include "meshCache.h"
+#include "meshQuality.h"
+#include "meshData.h"
+#include "meshReorder.h"
+#include "sizeField.h"
+#include "sparsityPattern.h"
+#include "stiffnessAssembly.h"
 using namespace std;
 
 
@@ -25,29 +36,6 @@ class Point
 
 
 
-class Triangle
-{
-  /**
-   * Triangle vertex index
-   * _id[0] ~ _id[2] : three vertices index of triangle
-   * _id[3] is the midpoint between _id[0] and _id[1]
-   * _id[4] is the midpoint between _id[1] and _id[2]
-   * _id[5] is the midpoint between _id[2] and _id[0]
-   */
-  public:
-    Triangle() {}
-    ~Triangle() {}
-    const vector<unsigned int>& getIds() const {return _ids;}
-    void clear() {_ids.clear();}
-    void append(unsigned int id) {_ids.push_back(id);}
-    void resize(const unsigned int size) {_ids.resize(size);}
-
-  private:
-    vector<unsigned int> _ids;
-};
-
-
-
 void generateBoudaryAndHoles(vector<Point>& boundary, vector<vector<Point> >& holes)
 {
   double left, right, bot, top;
@@ -139,8 +127,6 @@ int main(int argc, char **argv)
   boundaryTag = gmsh::model::addPhysicalGroup(dim, curveLoop);
   gmsh::model::setPhysicalName(dim, boundaryTag, "Boundary");
 
-  vector<int> bcurveLoop = curveLoop;
-
   vector<vector<int> > recCurveLoop;
   vector<int> holesTags;
   for(int i = 0; i < holes.size(); i++)
@@ -175,170 +161,267 @@ int main(int argc, char **argv)
 
   gmsh::model::geo::synchronize();
 
-  gmsh::model::mesh::generate(2);
-
-
-  // get mesh information
-  // Nodes
-  dim = -1;
-  tag = -1;
-  bool includeBoundary = false;
-  vector<double> coord, parametricCoord;
-  vector<size_t> nodeTags;
-  gmsh::model::mesh::getNodes(nodeTags, coord, parametricCoord, dim, tag, includeBoundary, true);
-  cout<<"The number of nodes: "<<coord.size()/3<<endl;
-  vector<Point> nodes;
-  nodes.reserve(1000);
-  Point p;
-  for(int i = 0; i < coord.size(); i+=3)
+  // "./twoDExample 2" adds the mid-edge nodes of quadratic triangles,
+  // id[3..5] of a TRIANGLE6 element are the midpoints of edges (0,1), (1,2), (2,0)
+  // "./twoDExample -r" renumbers nodes and elements for cache locality
+  // "./twoDExample -c" keeps the mesh and the boundary ids in meshCache/, keyed on
+  // the boundary, the holes, their lc and the mesh options: a rerun with the same input skips generate
+  // "./twoDExample -s" grades the size from holeLc at the holes to boundartLc one unit away,
+  // instead of the constant lc of the points
+  int order = 1;
+  bool reorder = false, useCache = false, useSizeField = false;
+  for(int i = 1; i < argc; i++)
   {
-    x = coord[i];
-    y = coord[i+1];
-    z = coord[i+2];
-    p = Point(x, y, z);
-    nodes.push_back(p);
+    if(string(argv[i]) == "-r")
+      reorder = true;
+    else if(string(argv[i]) == "-c")
+      useCache = true;
+    else if(string(argv[i]) == "-s")
+      useSizeField = true;
+    else if(string(argv[i]) == "1" || string(argv[i]) == "2")
+      order = atoi(argv[i]);
+    else
+    {
+      cout<<"usage: twoDExample [1|2] [-r] [-c] [-s]"<<endl;
+      gmsh::finalize();
+      return 1;
+    }
   }
-
-
-
-  //Elements
-  dim = -1;
-  tag = -1;
-  vector<int> elementTypes;
-  vector<vector<size_t> > elementTags, nodeTagss;
-  gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTagss, dim, tag);
-  cout<<"The number of elements: "<<nodeTagss[1].size()/3<<endl;
-  // boundaryNodesId include holes boundary nodes id
-  // vector<size_t> boundaryNodesId = elementTags[0];
-  vector<Triangle> triangles;
-  triangles.reserve(1000);
-  unsigned int id1, id2, id3;
-  for(int i = 0; i < nodeTagss[1].size(); i += 3)
+  SizeField sizeField(boundartLc);
+  double holeDistMin = 0.1, holeDistMax = 1;
+  if(useSizeField)
   {
-    Triangle tri;
-    id1 = nodeTagss[1][i]-1;
-    id2 = nodeTagss[1][i+1]-1;
-    id3 = nodeTagss[1][i+2]-1;
-    tri.append(id1);
-    tri.append(id2);
-    tri.append(id3);
-    triangles.push_back(tri);
+    int feature = sizeField.addFeature(holeLc, boundartLc, holeDistMin, holeDistMax);
+    for(int i = 0; i < holes.size(); i++)
+    {
+      vector<double> xy;
+      for(int j = 0; j < holes[i].size(); j++)
+      {
+        xy.push_back(holes[i][j].getX());
+        xy.push_back(holes[i][j].getY());
+      }
+      sizeField.addPolyline(feature, xy, true);
+    }
+    sizeField.build();
+    sizeField.registerCallback();
+    gmsh::option::setNumber("Mesh.MeshSizeFromPoints", 0);
+    gmsh::option::setNumber("Mesh.MeshSizeExtendFromBoundary", 0);
   }
-  
-
-
-  // get boundary nodes id and it's coordinate information
-  // coord is coordinate information (x1, y1, z1, .....)
-  dim = 1;
-  vector<size_t> bouNodesIds;
-  gmsh::model::mesh::getNodesForPhysicalGroup(dim, boundaryTag, bouNodesIds, coord);
-  vector<unsigned int> boundaryNodesIds(bouNodesIds.size());
-  // just because index from start 0
-  for(int i = 0; i < bouNodesIds.size(); i++)
+  MeshCacheKey cacheKey;
+  cacheKey.add(string("twoDExample"));
+  // the boundary ids are stored in loop order
+  cacheKey.add(string("orderedLoops"));
+  if(useSizeField)
   {
-    boundaryNodesIds[i] = bouNodesIds[i]-1;
+    cacheKey.add(string("sizeField"));
+    cacheKey.add(holeDistMin);
+    cacheKey.add(holeDistMax);
   }
-
-
-  // get holes nodes id and it's coordinate information
-  vector<vector<size_t> > hosNodesIds(holesTags.size());
-  vector<vector<unsigned int> > holesNodesIds(holesTags.size());
-  for(int i = 0; i < holesTags.size(); i++)
+  cacheKey.add((long long)boundary.size());
+  for(int i = 0; i < boundary.size(); i++)
   {
-    gmsh::model::mesh::getNodesForPhysicalGroup(dim, holesTags[i], hosNodesIds[i], coord);
+    cacheKey.addPoint(boundary[i].getX(), boundary[i].getY(), boundary[i].getZ(), boundartLc);
   }
-  for(int i = 0; i < hosNodesIds.size(); i++)
+  for(int i = 0; i < holes.size(); i++)
   {
-    holesNodesIds[i].resize(hosNodesIds[i].size());
-    for(int j = 0; j < hosNodesIds[i].size(); j++)
+    cacheKey.add((long long)holes[i].size());
+    for(int j = 0; j < holes[i].size(); j++)
     {
-      holesNodesIds[i][j] = hosNodesIds[i][j]-1;
+      cacheKey.addPoint(holes[i][j].getX(), holes[i][j].getY(), holes[i][j].getZ(), holeLc);
     }
   }
+  cacheKey.addGmshMeshOptions();
+  string key = cacheKey.getKey();
+  MeshCache cache;
+  MeshCacheArrays cached;
+  MeshData mesh;
+  vector<unsigned int> boundaryNodesIds;
+  vector<vector<unsigned int> > holesNodesIds(holesTags.size());
+  vector<vector<int> > holesElementsIds(recCurveLoop.size());
+  vector<int> boundaryElementsIds;
+  bool hit = useCache && cache.load(key, mesh, cached);
 
-#if 0
-  for(int i = 0; i < holesNodesIds.size(); i++)
+  if(hit)
   {
-    for(int j = 0; j < holesNodesIds[i].size(); j++)
+    cached.get("boundaryNodesIds", boundaryNodesIds);
+    cached.get("boundaryElementsIds", boundaryElementsIds);
+    for(int i = 0; i < holesNodesIds.size(); i++)
     {
-      cout<<holesNodesIds[i][j]<<" ";
+      cached.get("holesNodesIds" + to_string(i), holesNodesIds[i]);
+      cached.get("holesElementsIds" + to_string(i), holesElementsIds[i]);
+    }
+    cout<<"The number of nodes: "<<mesh.getNumNodes()<<endl;
+  } else {
+    gmsh::model::mesh::generate(2);
+    if(useSizeField)
+      cout<<"Size field: "<<sizeField.getNumCalls()<<" calls, "<<sizeField.getMeanLatency()<<" ns mean, "<<sizeField.getMaxLatency()<<" ns max"<<endl;
+
+
+    // get mesh information
+    // Nodes
+    dim = -1;
+    tag = -1;
+    bool includeBoundary = false;
+    vector<double> coord, parametricCoord;
+    vector<size_t> nodeTags;
+    gmsh::model::mesh::getNodes(nodeTags, coord, parametricCoord, dim, tag, includeBoundary, true);
+    cout<<"The number of nodes: "<<coord.size()/3<<endl;
+    // contiguous x / y / z arrays sized from the gmsh node count
+    mesh.setNodes(nodeTags, coord);
+
+
+
+    //Elements
+    dim = -1;
+    tag = -1;
+    vector<int> elementTypes;
+    vector<vector<size_t> > elementTags, nodeTagss;
+    gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTagss, dim, tag);
+    // boundaryNodesId include holes boundary nodes id
+    // vector<size_t> boundaryNodesId = elementTags[0];
+    // blocks are picked by element type, not by their position in nodeTagss
+    int tri = findElementType(elementTypes, TRIANGLE);
+    if(tri < 0)
+    {
+      cout<<"No triangles in the mesh"<<endl;
+      gmsh::finalize();
+      return 1;
+    }
+    // triangles are stored with a fixed stride of 3 node ids, see TypedBlockView
+    mesh.addBlock(TRIANGLE, elementTags[tri], nodeTagss[tri]);
+    // edge -> triangle table, built once and used by the boundary queries below
+    EdgeAdjacency adjacency;
+    adjacency.build(nodeTagss[tri], TRIANGLE);
+
+
+    // boundary and holes as ordered loops with the domain on their left: the outer
+    // boundary counterclockwise, every hole clockwise; nodes in walking order and the
+    // triangle next to every boundary segment in the same order, one hash lookup each
+    BoundaryLoops loops;
+    loops.buildForPhysicalGroup(mesh, boundaryTag, LOOP_COUNTERCLOCKWISE);
+    loops.getNodes(boundaryNodesIds);
+    loops.getAdjacentElements(mesh, adjacency, boundaryElementsIds);
+    for(int i = 0; i < holesTags.size(); i++)
+    {
+      loops.buildForPhysicalGroup(mesh, holesTags[i], LOOP_CLOCKWISE);
+      loops.getNodes(holesNodesIds[i]);
+      loops.getAdjacentElements(mesh, adjacency, holesElementsIds[i]);
+    }
+#if 0
+    for(int i = 0; i < holesNodesIds.size(); i++)
+    {
+      for(int j = 0; j < holesNodesIds[i].size(); j++)
+      {
+        cout<<holesNodesIds[i][j]<<" ";
+      }
+      cout<<endl;
     }
-    cout<<endl;
-  }
 #endif
 
-
-
-  // get holes arround triangle id
-  vector<vector<int> > holesElementsIds(recCurveLoop.size());
-  dim = 1;
-  int dim2 = 2;
-  vector<size_t> elementTag;
-  bool strict = true;
-  double xx, yy, zz;
-  vector<int> holeElementsIds;
-  for(int i = 0; i < recCurveLoop.size(); i++)
-  {
-    holeElementsIds.clear();
-    for(int j = 0; j < recCurveLoop[i].size(); j++)
+    // the first order mesh and the ids above are stored, the optional stages below run on every run
+    if(useCache)
     {
-      //elementTypes.clear();
-      //elementTags.clear();
-      //nodeTagss.clear();
-      tag = recCurveLoop[i][j];
-      gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTagss, dim, tag);
-      for(int k = 0; k < nodeTagss[0].size(); k += 2)
+      cached.put("boundaryNodesIds", boundaryNodesIds);
+      cached.put("boundaryElementsIds", boundaryElementsIds);
+      for(int i = 0; i < holesNodesIds.size(); i++)
       {
-        id1 = nodeTagss[0][k]-1;
-        id2 = nodeTagss[0][k+1]-1;
-        xx = (nodes[id1].getX() + nodes[id2].getX())/2.0;
-        yy = (nodes[id1].getY() + nodes[id2].getY())/2.0;
-        zz = (nodes[id1].getZ() + nodes[id2].getZ())/2.0;
-        gmsh::model::mesh::getElementsByCoordinates(xx, yy, zz, elementTag, dim2, strict);
-        for(int kk = 0; kk < elementTag.size(); kk++)
-        {
-          holeElementsIds.push_back(elementTag[kk]-1);
-        }
+        cached.put("holesNodesIds" + to_string(i), holesNodesIds[i]);
+        cached.put("holesElementsIds" + to_string(i), holesElementsIds[i]);
       }
+      cache.store(key, mesh, cached);
     }
-    holesElementsIds.push_back(holeElementsIds);
   }
-#if 0
-  for(int i = 0; i < holesElementsIds.size(); i++)
+
+  const ElementBlock& triangles = *mesh.findBlock(TRIANGLE);
+  cout<<"The number of elements: "<<triangles.size()<<endl;
+  if(order == 2)
   {
-    for(int j = 0; j < holesElementsIds[i].size(); j++)
-    {
-      cout<<holesElementsIds[i][j]<<" ";
-    }
-    cout<<endl;
+    EdgeNumbering edges;
+    edges.build(triangles);
+    const ElementBlock& triangles6 = addMidEdgeNodes(mesh, edges);
+    cout<<"The number of edges: "<<edges.getNumEdges()<<endl;
+    cout<<"The number of quadratic elements: "<<triangles6.size()<<endl;
   }
-#endif
 
-  // get boundary arround triangle id
-  vector<int> boundaryElementsIds;
-  dim = 1;
-  dim2 = 2;
-  strict = true;
-  for(int i = 0; i < bcurveLoop.size(); i++)
+  // optional renumbering: RCM for the nodes, Hilbert curve for the elements.
+  // The ids found above are mapped through the ranks, the tags move with the nodes and elements.
+  if(reorder)
   {
-    tag = bcurveLoop [i];
-    gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTagss, dim, tag);
-    for(int k = 0; k < nodeTagss[0].size(); k += 2)
+    size_t bandwidth;
+    unsigned long long profile;
+    measureBandwidth(mesh, bandwidth, profile);
+    cout<<"Bandwidth / profile before: "<<bandwidth<<" / "<<profile<<endl;
+    MeshReorder reorderer;
+    reorderer.reorderNodes(mesh);
+    reorderer.reorderElements(mesh);
+    measureBandwidth(mesh, bandwidth, profile);
+    cout<<"Bandwidth / profile after: "<<bandwidth<<" / "<<profile<<endl;
+
+    const vector<unsigned int>& nodeRank = reorderer.getNodeRank();
+    for(int i = 0; i < boundaryNodesIds.size(); i++)
     {
-      id1 = nodeTagss[0][k]-1;
-      id2 = nodeTagss[0][k+1]-1;
-      xx = (nodes[id1].getX() + nodes[id2].getX())/2.0;
-      yy = (nodes[id1].getY() + nodes[id2].getY())/2.0;
-      zz = (nodes[id1].getZ() + nodes[id2].getZ())/2.0;
-      gmsh::model::mesh::getElementsByCoordinates(xx, yy, zz, elementTag, dim2, strict);
-      for(int kk = 0; kk < elementTag.size(); kk++)
+      boundaryNodesIds[i] = nodeRank[boundaryNodesIds[i]];
+    }
+    for(int i = 0; i < holesNodesIds.size(); i++)
+    {
+      for(int j = 0; j < holesNodesIds[i].size(); j++)
       {
-        boundaryElementsIds.push_back(elementTag[kk]-1);
+        holesNodesIds[i][j] = nodeRank[holesNodesIds[i][j]];
       }
     }
+    // triangles is block 0, it was added first
+    const vector<unsigned int>& elementRank = reorderer.getElementRank(0);
+    for(int i = 0; i < boundaryElementsIds.size(); i++)
+    {
+      boundaryElementsIds[i] = elementRank[boundaryElementsIds[i]];
+    }
+    for(int i = 0; i < holesElementsIds.size(); i++)
+    {
+      for(int j = 0; j < holesElementsIds[i].size(); j++)
+      {
+        holesElementsIds[i][j] = elementRank[holesElementsIds[i][j]];
+      }
+    }
+  }
+
+  // node -> node CSR pattern of the FEM matrix, on the final numbering;
+  // a second order mesh uses the P2 stencil of its TRIANGLE6 block
+  const ElementBlock* elements = mesh.findBlock(order == 2 ? TRIANGLE6 : TRIANGLE);
+  SparsityPattern pattern;
+  pattern.build(*elements, mesh.getNumNodes());
+  cout<<"The number of matrix non zeros: "<<pattern.getNumNonZeros()<<endl;
+
+  // P1 Laplace stiffness matrix on that pattern, coloured chunks of triangles are assembled in parallel
+  if(order == 1)
+  {
+    ElementColouring colouring;
+    colouring.build(*elements, mesh.getNumNodes());
+    vector<double> stiffness;
+    assembleStiffness(mesh, *elements, colouring, pattern, stiffness);
+    cout<<"The number of assembly colours: "<<colouring.getNumColours()<<endl;
+  }
+
+  // quality check before the mesh goes to disk: no inverted triangle and no angle below 10 degrees
+  MeshQuality quality;
+  quality.compute(mesh, triangles);
+  printQualityReport(cout, quality, triangles);
+  QualityThresholds thresholds;
+  thresholds.minAngle = 10;
+  size_t rejected = quality.check(thresholds);
+  if(rejected > 0)
+  {
+    cout<<rejected<<" elements fail the quality check, demo.msh is not written"<<endl;
+    gmsh::finalize();
+    return 1;
   }
 
-  gmsh::write("demo.msh");
+  // a hit has no gmsh mesh, the stored file is what gmsh::write gave
+  if(hit)
+    cache.copyGmshMesh(key, "demo.msh");
+  else
+    gmsh::write("demo.msh");
+  if(useCache)
+    cache.printStats(cout);
     
   gmsh::finalize();
   return 0;
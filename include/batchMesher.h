@@ -0,0 +1,403 @@
+#ifndef BATCH_MESHER_H
+#define BATCH_MESHER_H
+
+#include <gmsh.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <ostream>
+#include <new>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "meshBinary.h"
+#include "meshData.h"
+#include "polygonReader.h"
+#include "trace.h"
+
+
+// phases of one case, in pipeline order
+enum BatchPhase {BATCH_BUILD = 0, BATCH_GENERATE, BATCH_EXTRACT, BATCH_WRITE, BATCH_LATENCY};
+const int NUM_BATCH_PHASES = 5;
+
+inline const char* getBatchPhaseName(const int phase)
+{
+    static const char* names[NUM_BATCH_PHASES] = {"build", "generate", "extract", "write", "latency"};
+    return phase >= 0 && phase < NUM_BATCH_PHASES ? names[phase] : "";
+}
+
+
+/**
+ * Meshes many small independent cases (a manifest in the polygon file format
+ * of polygonReader.h, one polygon with its holes per case) on long-lived
+ * worker processes.
+ *
+ * The workers are forked once from the initialised gmsh of the caller, so
+ * gmsh::initialize is paid once per run and not once per case; a worker takes
+ * the next case from a counter in shared memory, builds it in a fresh model
+ * (model::add), meshes it in 2D, extracts a MeshData and removes the model.
+ * Inside a worker the output is written by a second thread, so writing case i
+ * overlaps building and meshing case i + 1 (gmsh itself stays on one thread).
+ * Every case is written as <outputDirectory>/<name>.bin (meshBinary.h), names
+ * should be unique; an empty outputDirectory writes nothing.
+ *
+ * Per case the build, generate, extract and write times and the latency from
+ * the start of build to the end of write are sent back to the caller, which
+ * reports cases/second and percentiles of every phase.
+ */
+class BatchMesher
+{
+public:
+    BatchMesher(const int numWorkers = 1, const double lc = 0.1) : _numWorkers(numWorkers > 0 ? numWorkers : 1), _lc(lc),
+        _results(), _seconds(0), _error() {}
+    ~BatchMesher() {}
+
+    // every polygon of the manifest file, false on a syntax error (see getError)
+    bool readManifest(const std::string& filename, std::vector<PolygonRecord>& cases);
+    // mesh every case, false if a worker could not be started or died
+    bool run(const std::vector<PolygonRecord>& cases, const std::string& outputDirectory = "");
+
+    int getNumWorkers() const {return _numWorkers;}
+    std::size_t getNumCases() const {return _results.size();}
+    // cases gmsh or the output failed on
+    std::size_t getNumFailed() const;
+    // wall time of the last run, forks included
+    double getSeconds() const {return _seconds;}
+    double getCasesPerSecond() const {return _seconds > 0 ? _results.size() / _seconds : 0;}
+    // p in [0, 100], nearest rank over the cases that succeeded
+    double getPercentile(const int phase, const double p) const;
+    std::size_t getNumElements(const std::size_t i) const {return _results[i]._numElements;}
+    const std::string& getError() const {return _error;}
+    // cases/second and p50 / p90 / p99 / max of every phase in milliseconds
+    void printReport(std::ostream& out) const;
+
+private:
+    // what a worker sends back for one case
+    struct CaseResult
+    {
+        uint64_t _case, _numNodes, _numElements;
+        uint32_t _ok, _padding;
+        double _seconds[NUM_BATCH_PHASES];
+    };
+
+    void runWorker(const std::vector<PolygonRecord>& cases, const std::string& outputDirectory, std::atomic<std::size_t>* next, const int fd) const;
+
+    int _numWorkers;
+    double _lc;
+    std::vector<CaseResult> _results;
+    double _seconds;
+    std::string _error;
+};
+
+
+inline bool BatchMesher::readManifest(const std::string& filename, std::vector<PolygonRecord>& cases)
+{
+    cases.clear();
+    PolygonReader reader;
+    if(!reader.open(filename))
+    {
+        _error = reader.getError();
+        return false;
+    }
+    PolygonRecord polygon;
+    while(reader.next(polygon))
+    {
+        cases.push_back(polygon);
+    }
+    _error = reader.getError();
+    return _error.empty();
+}
+
+inline void BatchMesher::runWorker(const std::vector<PolygonRecord>& cases, const std::string& outputDirectory, std::atomic<std::size_t>* next, const int fd) const
+{
+    typedef std::chrono::steady_clock Clock;
+    gmsh::option::setNumber("General.Terminal", 0);
+    std::vector<CaseResult> results;
+
+    // meshed cases waiting for the writer thread, at most a few so memory stays bounded
+    struct Job
+    {
+        std::size_t _result, _case;
+        bool _ok;
+        MeshData* _mesh;
+        Clock::time_point _start;
+    };
+    const std::size_t maxQueued = 4;
+    std::deque<Job> queue;
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool done = false;
+    std::thread writer([&]() {
+        while(true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() {return done || !queue.empty();});
+                if(queue.empty())
+                    return;
+                job = queue.front();
+                queue.pop_front();
+            }
+            changed.notify_all();
+            const Clock::time_point t0 = Clock::now();
+            bool ok = true;
+            if(job._ok && !outputDirectory.empty())
+                ok = writeMeshBinary(*job._mesh, outputDirectory + "/" + cases[job._case].getName() + ".bin");
+            delete job._mesh;
+            const Clock::time_point t1 = Clock::now();
+            std::lock_guard<std::mutex> lock(mutex);
+            CaseResult& result = results[job._result];
+            result._ok = result._ok && ok;
+            result._seconds[BATCH_WRITE] = std::chrono::duration<double>(t1 - t0).count();
+            result._seconds[BATCH_LATENCY] = std::chrono::duration<double>(t1 - job._start).count();
+        }
+    });
+
+    std::vector<PolygonRecord> one(1);
+    for(std::size_t i = (*next)++; i < cases.size(); i = (*next)++)
+    {
+        CaseResult result;
+        std::memset(&result, 0, sizeof(result));
+        result._case = i;
+        result._ok = 1;
+        Job job;
+        job._start = Clock::now();
+        job._mesh = new MeshData();
+        Clock::time_point t0 = job._start, t1 = t0, t2 = t0, t3 = t0;
+        gmsh::model::add("case");
+        try
+        {
+            one[0] = cases[i];
+            GmshPolygonSink sink(_lc);
+            sink.addBatch(one, 1);
+            sink.finish();
+            t1 = Clock::now();
+            gmsh::model::mesh::generate(2);
+            t2 = Clock::now();
+            job._mesh->loadFromGmsh(2);
+            t3 = Clock::now();
+            // an element node that was not extracted would be written as 0xFFFFFFFF
+            if(job._mesh->getNumUnknownNodes() > 0)
+            {
+                result._ok = 0;
+                job._mesh->clear();
+            }
+        }
+        catch(...)
+        {
+            result._ok = 0;
+            job._mesh->clear();
+        }
+        gmsh::model::remove();
+        result._numNodes = job._mesh->getNumNodes();
+        result._numElements = job._mesh->getNumElements(2);
+        result._seconds[BATCH_BUILD] = std::chrono::duration<double>(t1 - t0).count();
+        result._seconds[BATCH_GENERATE] = std::chrono::duration<double>(t2 - t1).count();
+        result._seconds[BATCH_EXTRACT] = std::chrono::duration<double>(t3 - t2).count();
+        job._case = i;
+        job._ok = result._ok != 0;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() {return queue.size() < maxQueued;});
+        job._result = results.size();
+        results.push_back(result);
+        queue.push_back(job);
+        lock.unlock();
+        changed.notify_all();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    changed.notify_all();
+    writer.join();
+
+    std::size_t written = 0, size = results.size() * sizeof(CaseResult);
+    const char* p = results.empty() ? 0 : (const char*)&results[0];
+    while(written < size)
+    {
+        ssize_t n = write(fd, p + written, size - written);
+        if(n <= 0)
+            _exit(1);
+        written += n;
+    }
+}
+
+inline bool BatchMesher::run(const std::vector<PolygonRecord>& cases, const std::string& outputDirectory)
+{
+    _error.clear();
+    _results.clear();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    if(!outputDirectory.empty())
+        mkdir(outputDirectory.c_str(), 0755);
+
+    // the next case to take, shared by every worker
+    void* shared = mmap(0, sizeof(std::atomic<std::size_t>), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(shared == MAP_FAILED)
+    {
+        _error = "mmap failed";
+        return false;
+    }
+    std::atomic<std::size_t>* next = new(shared) std::atomic<std::size_t>(0);
+
+    const int numWorkers = (int)std::min<std::size_t>(_numWorkers, std::max<std::size_t>(cases.size(), 1));
+    std::vector<pid_t> pids(numWorkers, -1);
+    std::vector<int> fds(numWorkers, -1);
+    for(int w = 0; w < numWorkers; w++)
+    {
+        int fd[2];
+        if(pipe(fd) != 0)
+        {
+            _error = "pipe failed";
+            break;
+        }
+        pid_t pid = fork();
+        if(pid == 0)
+        {
+            close(fd[0]);
+            runWorker(cases, outputDirectory, next, fd[1]);
+            close(fd[1]);
+            _exit(0);
+        }
+        close(fd[1]);
+        if(pid < 0)
+        {
+            close(fd[0]);
+            _error = "fork failed";
+            break;
+        }
+        pids[w] = pid;
+        fds[w] = fd[0];
+    }
+
+    // drain every pipe as data arrives, a full pipe would stall its worker
+    std::vector<std::vector<char> > buffers(numWorkers);
+    std::vector<char> chunk(1 << 16);
+    int numOpen = 0;
+    for(int w = 0; w < numWorkers; w++)
+        numOpen += fds[w] >= 0;
+    while(numOpen > 0)
+    {
+        std::vector<struct pollfd> polls;
+        std::vector<int> owners;
+        for(int w = 0; w < numWorkers; w++)
+        {
+            if(fds[w] < 0)
+                continue;
+            struct pollfd pfd = {fds[w], POLLIN, 0};
+            polls.push_back(pfd);
+            owners.push_back(w);
+        }
+        // the time the parent waits on its workers
+        if(TRACE_CALL(poll(&polls[0], polls.size(), -1)) < 0)
+            continue;
+        for(std::size_t i = 0; i < polls.size(); i++)
+        {
+            if(!(polls[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            int w = owners[i];
+            ssize_t n = read(fds[w], &chunk[0], chunk.size());
+            if(n > 0)
+            {
+                buffers[w].insert(buffers[w].end(), chunk.begin(), chunk.begin() + n);
+            } else {
+                close(fds[w]);
+                fds[w] = -1;
+                numOpen--;
+            }
+        }
+    }
+    for(int w = 0; w < numWorkers; w++)
+    {
+        int status = 0;
+        if(pids[w] > 0 && (waitpid(pids[w], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) && _error.empty())
+            _error = "worker " + std::to_string(w) + " failed";
+    }
+    munmap(shared, sizeof(std::atomic<std::size_t>));
+
+    // results in case order
+    _results.resize(cases.size());
+    std::vector<bool> seen(cases.size(), false);
+    for(int w = 0; w < numWorkers; w++)
+    {
+        const std::size_t n = buffers[w].size() / sizeof(CaseResult);
+        for(std::size_t i = 0; i < n; i++)
+        {
+            CaseResult result;
+            std::memcpy(&result, &buffers[w][i * sizeof(CaseResult)], sizeof(CaseResult));
+            if(result._case < cases.size())
+            {
+                _results[result._case] = result;
+                seen[result._case] = true;
+            }
+        }
+    }
+    for(std::size_t i = 0; i < cases.size(); i++)
+    {
+        if(!seen[i])
+        {
+            std::memset(&_results[i], 0, sizeof(CaseResult));
+            _results[i]._case = i;
+            if(_error.empty())
+                _error = "no result for case " + cases[i].getName();
+        }
+    }
+    _seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return _error.empty();
+}
+
+inline std::size_t BatchMesher::getNumFailed() const
+{
+    std::size_t failed = 0;
+    for(std::size_t i = 0; i < _results.size(); i++)
+    {
+        failed += _results[i]._ok == 0;
+    }
+    return failed;
+}
+
+inline double BatchMesher::getPercentile(const int phase, const double p) const
+{
+    std::vector<double> values;
+    for(std::size_t i = 0; i < _results.size(); i++)
+    {
+        if(_results[i]._ok)
+            values.push_back(_results[i]._seconds[phase]);
+    }
+    if(values.empty())
+        return 0;
+    std::size_t rank = (std::size_t)std::ceil(p / 100 * values.size());
+    rank = std::min(values.size(), std::max<std::size_t>(rank, 1)) - 1;
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+inline void BatchMesher::printReport(std::ostream& out) const
+{
+    out<<_results.size()<<" cases ("<<getNumFailed()<<" failed) on "<<_numWorkers<<" workers in "<<_seconds<<"s: "
+       <<getCasesPerSecond()<<" cases/s"<<std::endl;
+    out<<"phase      p50 ms   p90 ms   p99 ms   max ms"<<std::endl;
+    for(int phase = 0; phase < NUM_BATCH_PHASES; phase++)
+    {
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-8s %8.3f %8.3f %8.3f %8.3f", getBatchPhaseName(phase), 1e3 * getPercentile(phase, 50),
+            1e3 * getPercentile(phase, 90), 1e3 * getPercentile(phase, 99), 1e3 * getPercentile(phase, 100));
+        out<<line<<std::endl;
+    }
+}
+
+#endif
@@ -0,0 +1,311 @@
+#ifndef BOUNDARY_LOOPS_H
+#define BOUNDARY_LOOPS_H
+
+#include <gmsh.h>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include "elementTypes.h"
+#include "meshAdjacency.h"
+#include "meshData.h"
+#include "tagIndexMap.h"
+#include "trace.h"
+
+
+// direction given to the chains by BoundaryLoops
+enum LoopOrientation
+{
+    // the direction most of the line elements of the chain already have, gmsh gives them the direction of their curve
+    LOOP_MESH,
+    // closed loops counterclockwise in the xy plane (an outer boundary with the domain on its left), open chains as LOOP_MESH
+    LOOP_COUNTERCLOCKWISE,
+    // closed loops clockwise in the xy plane (a hole with the domain on its left), open chains as LOOP_MESH
+    LOOP_CLOCKWISE
+};
+
+
+/**
+ * Ordered chains of boundary segments.
+ *
+ * The segments (line elements) are joined through the nodes they share: a
+ * node with two segments continues the chain, any other node (the end of an
+ * open curve, or a junction of three curves or more) ends it. Chains are
+ * walked from every chain end first, what is left is closed loops, so every
+ * segment is visited once: O(n) in the number of segments, whatever the order
+ * in which gmsh returns them.
+ *
+ * Chain c has getNumSegments(c) segments; segment i goes from node i to node
+ * i + 1, and the last one of a closed loop back to node 0, so an open chain
+ * has one node more than segments and a closed loop as many. isReversed()
+ * tells when a segment is walked against the direction of its line element.
+ * Node ids are 0-based MeshData indices, segment ids positions in the input.
+ */
+class BoundaryLoops
+{
+public:
+    BoundaryLoops() : _nodeOffsets(1, 0), _segmentOffsets(1, 0), _nodes(), _segments(), _reversed(), _closed(), _areas(), _segmentTags(), _local() {}
+    ~BoundaryLoops() {}
+
+    // segments are two node ids each, segmentTags their gmsh element tags (may be empty)
+    void build(const MeshData& mesh, const std::vector<unsigned int>& segments, const std::vector<std::size_t>& segmentTags, const LoopOrientation orientation = LOOP_MESH);
+    // the line elements of the mesh of every curve (the sign of a tag is ignored)
+    void buildForCurves(const MeshData& mesh, const std::vector<int>& curveTags, const LoopOrientation orientation = LOOP_MESH);
+    // the line elements of every curve of a physical group of dimension 1
+    void buildForPhysicalGroup(const MeshData& mesh, const int physicalTag, const LoopOrientation orientation = LOOP_MESH);
+    void clear();
+
+    // number of chains
+    std::size_t size() const {return _closed.size();}
+    bool isClosed(const std::size_t c) const {return _closed[c] != 0;}
+    // signed area of a closed loop in the xy plane, positive counterclockwise, 0 for an open chain
+    double getArea(const std::size_t c) const {return _areas[c];}
+
+    std::size_t getNumNodes(const std::size_t c) const {return _nodeOffsets[c+1] - _nodeOffsets[c];}
+    unsigned int getNode(const std::size_t c, const std::size_t i) const {return _nodes[_nodeOffsets[c] + i];}
+    std::size_t getNumSegments(const std::size_t c) const {return _segmentOffsets[c+1] - _segmentOffsets[c];}
+    unsigned int getSegment(const std::size_t c, const std::size_t i) const {return _segments[_segmentOffsets[c] + i];}
+    bool isReversed(const std::size_t c, const std::size_t i) const {return _reversed[_segmentOffsets[c] + i] != 0;}
+    // element tag of segment i of chain c, 0 when no tags were given
+    std::size_t getSegmentTag(const std::size_t c, const std::size_t i) const {return _segmentTags.empty() ? 0 : _segmentTags[getSegment(c, i)];}
+
+    // append the nodes of every chain in order
+    void getNodes(std::vector<unsigned int>& nodes) const {nodes.insert(nodes.end(), _nodes.begin(), _nodes.end());}
+    // append the elements next to every segment in chain order, adjacency is built on node tags
+    void getAdjacentElements(const MeshData& mesh, const EdgeAdjacency& adjacency, std::vector<int>& elementsIds) const;
+
+private:
+    // one chain from end e of segment s, see build()
+    void walk(const std::vector<unsigned int>& segments, const std::vector<unsigned int>& ends, const std::vector<std::size_t>& offsets, std::vector<char>& visited, unsigned int s, unsigned int e);
+    void orient(const std::size_t c, const MeshData& mesh, const LoopOrientation orientation);
+
+    // chain c: nodes [_nodeOffsets[c], _nodeOffsets[c+1]), segments [_segmentOffsets[c], _segmentOffsets[c+1])
+    std::vector<std::size_t> _nodeOffsets, _segmentOffsets;
+    std::vector<unsigned int> _nodes, _segments;
+    std::vector<char> _reversed, _closed;
+    std::vector<double> _areas;
+    std::vector<std::size_t> _segmentTags;
+    // node id -> local node, kept at -1 between builds so a build only touches its own nodes
+    std::vector<int> _local;
+};
+
+
+inline void BoundaryLoops::clear()
+{
+    _nodeOffsets.assign(1, 0);
+    _segmentOffsets.assign(1, 0);
+    _nodes.clear();
+    _segments.clear();
+    _reversed.clear();
+    _closed.clear();
+    _areas.clear();
+    _segmentTags.clear();
+}
+
+inline void BoundaryLoops::build(const MeshData& mesh, const std::vector<unsigned int>& segments, const std::vector<std::size_t>& segmentTags, const LoopOrientation orientation)
+{
+    TRACE_SCOPE("BoundaryLoops::build");
+    clear();
+    _segmentTags = segmentTags;
+    const std::size_t numSegments = segments.size() / 2;
+    if(_local.size() < mesh.getNumNodes())
+        _local.resize(mesh.getNumNodes(), -1);
+
+    // local numbering of the nodes of the segments, then node -> segment ends (CSR),
+    // an end is 2 * segment + 0 for its first node, + 1 for its second
+    std::vector<unsigned int> touched;
+    for(std::size_t k = 0; k < 2 * numSegments; k++)
+    {
+        if(_local[segments[k]] < 0)
+        {
+            _local[segments[k]] = (int)touched.size();
+            touched.push_back(segments[k]);
+        }
+    }
+    std::vector<std::size_t> offsets(touched.size() + 1, 0);
+    for(std::size_t k = 0; k < 2 * numSegments; k++)
+    {
+        offsets[_local[segments[k]] + 1]++;
+    }
+    for(std::size_t v = 0; v < touched.size(); v++)
+    {
+        offsets[v+1] += offsets[v];
+    }
+    std::vector<unsigned int> ends(2 * numSegments);
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for(std::size_t k = 0; k < 2 * numSegments; k++)
+    {
+        ends[cursor[_local[segments[k]]]++] = (unsigned int)k;
+    }
+
+    std::vector<char> visited(numSegments, 0);
+    // open chains start at the nodes that do not have two segments
+    for(std::size_t v = 0; v < touched.size(); v++)
+    {
+        if(offsets[v+1] - offsets[v] == 2)
+            continue;
+        for(std::size_t k = offsets[v]; k < offsets[v+1]; k++)
+        {
+            if(!visited[ends[k] / 2])
+                walk(segments, ends, offsets, visited, ends[k] / 2, ends[k] % 2);
+        }
+    }
+    // the rest is closed loops, each started on its first segment in input order and in its direction
+    for(std::size_t s = 0; s < numSegments; s++)
+    {
+        if(!visited[s])
+            walk(segments, ends, offsets, visited, (unsigned int)s, 0);
+    }
+
+    for(std::size_t v = 0; v < touched.size(); v++)
+    {
+        _local[touched[v]] = -1;
+    }
+    _areas.assign(size(), 0);
+    for(std::size_t c = 0; c < size(); c++)
+    {
+        orient(c, mesh, orientation);
+    }
+}
+
+// walk from end e of segment s until a node without two segments, or back to s
+inline void BoundaryLoops::walk(const std::vector<unsigned int>& segments, const std::vector<unsigned int>& ends, const std::vector<std::size_t>& offsets, std::vector<char>& visited, unsigned int s, unsigned int e)
+{
+    const unsigned int first = s;
+    _nodes.push_back(segments[2*s+e]);
+    bool closed = false;
+    while(true)
+    {
+        visited[s] = 1;
+        _segments.push_back(s);
+        _reversed.push_back((char)e);
+        const unsigned int node = segments[2*s+1-e];
+        const int v = _local[node];
+        if(offsets[v+1] - offsets[v] != 2)
+        {
+            _nodes.push_back(node);
+            break;
+        }
+        const unsigned int next = ends[offsets[v]] / 2 == s ? ends[offsets[v] + 1] : ends[offsets[v]];
+        if(visited[next / 2])
+        {
+            // a loop does not repeat its first node
+            closed = next / 2 == first;
+            if(!closed)
+                _nodes.push_back(node);
+            break;
+        }
+        _nodes.push_back(node);
+        s = next / 2;
+        e = next % 2;
+    }
+    _closed.push_back(closed ? 1 : 0);
+    _nodeOffsets.push_back(_nodes.size());
+    _segmentOffsets.push_back(_segments.size());
+}
+
+inline void BoundaryLoops::orient(const std::size_t c, const MeshData& mesh, const LoopOrientation orientation)
+{
+    const std::size_t n0 = _nodeOffsets[c], n1 = _nodeOffsets[c+1];
+    const std::size_t s0 = _segmentOffsets[c], s1 = _segmentOffsets[c+1];
+    double area = 0;
+    if(_closed[c])
+    {
+        for(std::size_t i = n0; i < n1; i++)
+        {
+            const unsigned int a = _nodes[i], b = _nodes[i + 1 < n1 ? i + 1 : n0];
+            area += mesh.getX(a) * mesh.getY(b) - mesh.getX(b) * mesh.getY(a);
+        }
+        area /= 2;
+    }
+    bool flip;
+    if(_closed[c] && orientation != LOOP_MESH)
+    {
+        flip = orientation == LOOP_COUNTERCLOCKWISE ? area < 0 : area > 0;
+    }
+    else
+    {
+        std::size_t numReversed = 0;
+        for(std::size_t i = s0; i < s1; i++)
+        {
+            numReversed += _reversed[i];
+        }
+        flip = 2 * numReversed > s1 - s0;
+    }
+    if(flip)
+    {
+        std::reverse(_nodes.begin() + n0, _nodes.begin() + n1);
+        std::reverse(_segments.begin() + s0, _segments.begin() + s1);
+        std::reverse(_reversed.begin() + s0, _reversed.begin() + s1);
+        for(std::size_t i = s0; i < s1; i++)
+        {
+            _reversed[i] = !_reversed[i];
+        }
+        // reversed nodes n(k-1) .. n0 are joined by s(k-2) .. s0 and s(k-1) closes the loop
+        if(_closed[c] && s1 - s0 > 1)
+        {
+            std::rotate(_segments.begin() + s0, _segments.begin() + s0 + 1, _segments.begin() + s1);
+            std::rotate(_reversed.begin() + s0, _reversed.begin() + s0 + 1, _reversed.begin() + s1);
+            area = -area;
+        }
+    }
+    _areas[c] = area;
+}
+
+inline void BoundaryLoops::buildForCurves(const MeshData& mesh, const std::vector<int>& curveTags, const LoopOrientation orientation)
+{
+    std::vector<unsigned int> segments;
+    std::vector<std::size_t> segmentTags;
+    std::vector<int> elementTypes;
+    std::vector<std::vector<std::size_t> > elementTags, nodeTags;
+    const TagIndexMap& nodeIndex = mesh.getNodeIndex();
+    for(std::size_t i = 0; i < curveTags.size(); i++)
+    {
+        TRACE_CALL(gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags, 1, std::abs(curveTags[i])));
+        for(std::size_t t = 0; t < elementTypes.size(); t++)
+        {
+            // high order lines give their two vertices first
+            const int numNodes = getElementNumNodes(elementTypes[t]);
+            if(getElementDim(elementTypes[t]) != 1 || numNodes < 2)
+                continue;
+            for(std::size_t j = 0; j < elementTags[t].size(); j++)
+            {
+                const unsigned int a = nodeIndex.find(nodeTags[t][j * numNodes]), b = nodeIndex.find(nodeTags[t][j * numNodes + 1]);
+                if(a == TagIndexMap::npos || b == TagIndexMap::npos)
+                    continue;
+                segments.push_back(a);
+                segments.push_back(b);
+                segmentTags.push_back(elementTags[t][j]);
+            }
+        }
+    }
+    build(mesh, segments, segmentTags, orientation);
+}
+
+inline void BoundaryLoops::buildForPhysicalGroup(const MeshData& mesh, const int physicalTag, const LoopOrientation orientation)
+{
+    std::vector<int> curveTags;
+    gmsh::model::getEntitiesForPhysicalGroup(1, physicalTag, curveTags);
+    buildForCurves(mesh, curveTags, orientation);
+}
+
+inline void BoundaryLoops::getAdjacentElements(const MeshData& mesh, const EdgeAdjacency& adjacency, std::vector<int>& elementsIds) const
+{
+    const CountedVector<std::size_t>& nodeTags = mesh.getNodeTags();
+    int ids[2];
+    for(std::size_t c = 0; c < size(); c++)
+    {
+        const std::size_t n = getNumNodes(c);
+        for(std::size_t i = 0; i < getNumSegments(c); i++)
+        {
+            const unsigned int a = getNode(c, i), b = getNode(c, i + 1 < n ? i + 1 : 0);
+            const int count = adjacency.getElements(nodeTags[a], nodeTags[b], ids);
+            for(int k = 0; k < count; k++)
+            {
+                elementsIds.push_back(ids[k]);
+            }
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,174 @@
+#ifndef EDGE_NUMBERING_H
+#define EDGE_NUMBERING_H
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include "elementTypes.h"
+#include "memoryUsage.h"
+#include "meshData.h"
+#include "parallelSort.h"
+#include "trace.h"
+
+
+/**
+ * Global edge numbering of a triangle block. Every (triangle, local edge)
+ * pair is packed with its sorted node ids into one 64 bit key, the keys are
+ * sorted in parallel and equal neighbours become one edge. Edge ids follow
+ * the order of the sorted (first node, second node) keys.
+ * Local edges follow gmsh: 0 = (0,1), 1 = (1,2), 2 = (2,0).
+ */
+class EdgeNumbering
+{
+public:
+    EdgeNumbering() : _edgeNodes(), _elementEdges() {}
+    ~EdgeNumbering() {}
+
+    // triangles must be a TRIANGLE or TRIANGLE6 block, only the vertices are used;
+    // any other block gives no edges
+    void build(const ElementBlock& triangles, const int numThreads = 0);
+    // the same with the stride known at compile time
+    template<int Type> void build(const TypedBlockView<Type>& triangles, const int numThreads = 0);
+    void clear() {_edgeNodes.clear(); _elementEdges.clear();}
+
+    std::size_t getNumEdges() const {return _edgeNodes.size() / 2;}
+    std::size_t getNumElements() const {return _elementEdges.size() / 3;}
+    // node ids of edge i, first < second
+    unsigned int getFirst(const std::size_t i) const {return _edgeNodes[2*i];}
+    unsigned int getSecond(const std::size_t i) const {return _edgeNodes[2*i+1];}
+    // edge id of local edge j of triangle i
+    unsigned int getEdge(const std::size_t i, const int j) const {return _elementEdges[3*i+j];}
+    const CountedVector<unsigned int>& getEdgeNodes() const {return _edgeNodes;}
+    const CountedVector<unsigned int>& getElementEdges() const {return _elementEdges;}
+
+private:
+    CountedVector<unsigned int> _edgeNodes;
+    CountedVector<unsigned int> _elementEdges;
+};
+
+inline void EdgeNumbering::build(const ElementBlock& triangles, const int numThreads)
+{
+    switch(triangles.getType())
+    {
+        case TRIANGLE: build(triangles.view<TRIANGLE>(), numThreads); break;
+        case TRIANGLE6: build(triangles.view<TRIANGLE6>(), numThreads); break;
+        default: clear();
+    }
+}
+
+template<int Type> inline void EdgeNumbering::build(const TypedBlockView<Type>& triangles, const int numThreads)
+{
+    static_assert(ElementTraits<Type>::dim == 2 && ElementTraits<Type>::numVertices == 3, "EdgeNumbering needs triangles");
+    TRACE_SCOPE("EdgeNumbering::build");
+    const std::size_t n = triangles.size(), m = 3 * n;
+    // (sorted node pair, triangle * 3 + local edge)
+    std::vector<std::pair<unsigned long long, unsigned int> > keys(m);
+    parallelFor(n, numThreads, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t i = b; i < e; i++)
+        {
+            const unsigned int* v = triangles.nodes(i);
+            for(int j = 0; j < 3; j++)
+            {
+                unsigned long long a = v[j], c = v[j == 2 ? 0 : j+1];
+                if(a > c)
+                    std::swap(a, c);
+                keys[3*i+j] = std::make_pair((a << 32) | c, (unsigned int)(3*i+j));
+            }
+        }
+    });
+    parallelSort(keys, numThreads);
+
+    // every thread counts the first occurrences in its range, a prefix sum
+    // of the counts gives the id of the first edge of every range
+    const int t = (int)std::min<std::size_t>(getNumThreads(numThreads), std::max<std::size_t>(m / 4096, 1));
+    std::vector<std::size_t> first(t + 1, 0);
+    parallelFor((std::size_t)t, t, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t r = b; r < e; r++)
+        {
+            std::size_t count = 0;
+            for(std::size_t i = m * r / t; i < m * (r + 1) / t; i++)
+            {
+                if(i == 0 || keys[i].first != keys[i-1].first)
+                    count++;
+            }
+            first[r+1] = count;
+        }
+    }, 1);
+    for(int r = 0; r < t; r++)
+    {
+        first[r+1] += first[r];
+    }
+
+    _edgeNodes.resize(2 * first[t]);
+    _elementEdges.resize(m);
+    parallelFor((std::size_t)t, t, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t r = b; r < e; r++)
+        {
+            std::size_t edge = first[r];
+            for(std::size_t i = m * r / t; i < m * (r + 1) / t; i++)
+            {
+                if(i == 0 || keys[i].first != keys[i-1].first)
+                {
+                    _edgeNodes[2*edge] = (unsigned int)(keys[i].first >> 32);
+                    _edgeNodes[2*edge+1] = (unsigned int)(keys[i].first & 0xffffffffULL);
+                    edge++;
+                }
+                _elementEdges[keys[i].second] = (unsigned int)(edge - 1);
+            }
+        }
+    }, 1);
+}
+
+/**
+ * Second order triangles: one node per edge at its midpoint, appended after
+ * the existing nodes with tags following the largest node tag, and a
+ * TRIANGLE6 block with the same element tags as the TRIANGLE block.
+ * The node layout is the one of gmsh::model::mesh::setOrder(2): the three
+ * vertices, then the midpoints of edges (0,1), (1,2), (2,0). On straight
+ * (plane) geometry the coordinates are the ones setOrder(2) gives, curved
+ * boundaries are not projected back on the geometry.
+ */
+inline const ElementBlock& addMidEdgeNodes(MeshData& mesh, const EdgeNumbering& edges, const int numThreads = 0)
+{
+    const ElementBlock& triangles = *mesh.findBlock(TRIANGLE);
+    const std::size_t first = mesh.getNumNodes(), numEdges = edges.getNumEdges();
+    std::size_t maxTag = 0;
+    for(std::size_t i = 0; i < first; i++)
+    {
+        if(mesh.getNodeTags()[i] > maxTag)
+            maxTag = mesh.getNodeTags()[i];
+    }
+
+    std::vector<std::size_t> nodeTags(numEdges);
+    std::vector<double> coord(3 * numEdges);
+    parallelFor(numEdges, numThreads, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t i = b; i < e; i++)
+        {
+            unsigned int a = edges.getFirst(i), c = edges.getSecond(i);
+            nodeTags[i] = maxTag + 1 + i;
+            coord[3*i] = 0.5 * (mesh.getX(a) + mesh.getX(c));
+            coord[3*i+1] = 0.5 * (mesh.getY(a) + mesh.getY(c));
+            coord[3*i+2] = 0.5 * (mesh.getZ(a) + mesh.getZ(c));
+        }
+    });
+
+    const std::size_t n = triangles.size();
+    const CountedVector<unsigned int>& ids = triangles.getConnectivity();
+    std::vector<unsigned int> nodeIds(6 * n);
+    parallelFor(n, numThreads, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t i = b; i < e; i++)
+        {
+            for(int j = 0; j < 3; j++)
+            {
+                nodeIds[6*i+j] = ids[3*i+j];
+                nodeIds[6*i+3+j] = (unsigned int)(first + edges.getEdge(i, j));
+            }
+        }
+    });
+
+    std::vector<std::size_t> elementTags(triangles.getElementTags().begin(), triangles.getElementTags().end());
+    mesh.appendNodes(nodeTags, coord);
+    return mesh.addBlockByIndex(TRIANGLE6, elementTags, nodeIds);
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef ELEMENT_TYPES_H
+#define ELEMENT_TYPES_H
+
+#include <vector>
+#include <cstddef>
+
+
+// gmsh element type numbers of the blocks returned by getElements()
+enum ElementType
+{
+    LINE = 1,
+    TRIANGLE = 2,
+    QUADRANGLE = 3,
+    TETRAHEDRON = 4,
+    HEXAHEDRON = 5,
+    PRISM = 6,
+    PYRAMID = 7,
+    LINE3 = 8,
+    TRIANGLE6 = 9,
+    TETRAHEDRON10 = 11,
+    POINT = 15
+};
+
+
+/**
+ * Compile-time properties of one gmsh element type. numNodes is the stride of
+ * the connectivity array, numVertices the corner nodes that come first.
+ */
+template<int Type> struct ElementTraits;
+
+#define ELEMENT_TRAITS(TYPE, NUMNODES, NUMVERTICES, DIM) \
+template<> struct ElementTraits<TYPE> \
+{ \
+    static constexpr int type = TYPE; \
+    static constexpr int numNodes = NUMNODES; \
+    static constexpr int numVertices = NUMVERTICES; \
+    static constexpr int dim = DIM; \
+};
+
+ELEMENT_TRAITS(POINT, 1, 1, 0)
+ELEMENT_TRAITS(LINE, 2, 2, 1)
+ELEMENT_TRAITS(LINE3, 3, 2, 1)
+ELEMENT_TRAITS(TRIANGLE, 3, 3, 2)
+ELEMENT_TRAITS(TRIANGLE6, 6, 3, 2)
+ELEMENT_TRAITS(QUADRANGLE, 4, 4, 2)
+ELEMENT_TRAITS(TETRAHEDRON, 4, 4, 3)
+ELEMENT_TRAITS(TETRAHEDRON10, 10, 4, 3)
+ELEMENT_TRAITS(HEXAHEDRON, 8, 8, 3)
+ELEMENT_TRAITS(PRISM, 6, 6, 3)
+ELEMENT_TRAITS(PYRAMID, 5, 5, 3)
+
+#undef ELEMENT_TRAITS
+
+
+// number of nodes of a gmsh element type, 0 if the type is not one of the above
+inline int getElementNumNodes(const int type)
+{
+    switch(type)
+    {
+        case POINT: return 1;
+        case LINE: return 2;
+        case LINE3: return 3;
+        case TRIANGLE: return 3;
+        case TRIANGLE6: return 6;
+        case QUADRANGLE: return 4;
+        case TETRAHEDRON: return 4;
+        case TETRAHEDRON10: return 10;
+        case HEXAHEDRON: return 8;
+        case PRISM: return 6;
+        case PYRAMID: return 5;
+        default: return 0;
+    }
+}
+
+// number of corner nodes of a gmsh element type, they come first in the connectivity
+inline int getElementNumVertices(const int type)
+{
+    switch(type)
+    {
+        case POINT: return 1;
+        case LINE: case LINE3: return 2;
+        case TRIANGLE: case TRIANGLE6: return 3;
+        case QUADRANGLE: return 4;
+        case TETRAHEDRON: case TETRAHEDRON10: return 4;
+        case HEXAHEDRON: return 8;
+        case PRISM: return 6;
+        case PYRAMID: return 5;
+        default: return 0;
+    }
+}
+
+inline int getElementDim(const int type)
+{
+    switch(type)
+    {
+        case POINT: return 0;
+        case LINE: case LINE3: return 1;
+        case TRIANGLE: case TRIANGLE6: case QUADRANGLE: return 2;
+        case TETRAHEDRON: case TETRAHEDRON10: case HEXAHEDRON: case PRISM: case PYRAMID: return 3;
+        default: return -1;
+    }
+}
+
+// position of a type in the elementTypes of getElements(), -1 if the mesh has none
+inline int findElementType(const std::vector<int>& elementTypes, const int type)
+{
+    for(std::size_t i = 0; i < elementTypes.size(); i++)
+    {
+        if(elementTypes[i] == type)
+            return (int)i;
+    }
+    return -1;
+}
+
+
+/**
+ * Block of one element type with its stride known at compile time, so loops
+ * over it index with a constant stride and can be unrolled and vectorized.
+ */
+template<int Type> class TypedBlockView
+{
+public:
+    typedef ElementTraits<Type> Traits;
+    static constexpr int numNodes = Traits::numNodes;
+
+    TypedBlockView(const unsigned int* connectivity, const std::size_t* elementTags, const std::size_t size) : _connectivity(connectivity), _elementTags(elementTags), _size(size) {}
+    ~TypedBlockView() {}
+
+    std::size_t size() const {return _size;}
+    // the numNodes node ids of element i
+    const unsigned int* nodes(const std::size_t i) const {return _connectivity + i * numNodes;}
+    unsigned int node(const std::size_t i, const int j) const {return _connectivity[i * numNodes + j];}
+    std::size_t getTag(const std::size_t i) const {return _elementTags[i];}
+
+private:
+    const unsigned int* _connectivity;
+    const std::size_t* _elementTags;
+    std::size_t _size;
+};
+
+
+/**
+ * Call visitor(TypedBlockView<Type>) once for a block, the element type is
+ * switched on once per block instead of once per element. The visitor needs a
+ * template operator(); returns false for an element type without traits.
+ */
+template<class Block, class Visitor> bool visitBlock(const Block& block, Visitor& visitor)
+{
+    switch(block.getType())
+    {
+        case POINT: visitor(block.template view<POINT>()); return true;
+        case LINE: visitor(block.template view<LINE>()); return true;
+        case LINE3: visitor(block.template view<LINE3>()); return true;
+        case TRIANGLE: visitor(block.template view<TRIANGLE>()); return true;
+        case TRIANGLE6: visitor(block.template view<TRIANGLE6>()); return true;
+        case QUADRANGLE: visitor(block.template view<QUADRANGLE>()); return true;
+        case TETRAHEDRON: visitor(block.template view<TETRAHEDRON>()); return true;
+        case TETRAHEDRON10: visitor(block.template view<TETRAHEDRON10>()); return true;
+        case HEXAHEDRON: visitor(block.template view<HEXAHEDRON>()); return true;
+        case PRISM: visitor(block.template view<PRISM>()); return true;
+        case PYRAMID: visitor(block.template view<PYRAMID>()); return true;
+        default: return false;
+    }
+}
+
+#endif
@@ -0,0 +1,338 @@
+#ifndef FACE_ADJACENCY_H
+#define FACE_ADJACENCY_H
+
+#include <gmsh.h>
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include "elementTypes.h"
+#include "memoryUsage.h"
+#include "meshData.h"
+#include "parallelSort.h"
+#include "tagIndexMap.h"
+#include "trace.h"
+
+
+/**
+ * Triangular face of a tetrahedron without its smallest node id, which is the
+ * bucket it is stored in, and the position (tetrahedron * 4 + local face) it
+ * was taken from.
+ */
+struct FaceEntry
+{
+    unsigned int _b, _c;
+    unsigned int _slot;
+    bool sameFace(const FaceEntry& f) const {return _b == f._b && _c == f._c;}
+    bool operator < (const FaceEntry& f) const
+    {
+        if(_b != f._b)
+            return _b < f._b;
+        if(_c != f._c)
+            return _c < f._c;
+        return _slot < f._slot;
+    }
+};
+
+
+/**
+ * Face -> tetrahedron table of one tetrahedron block.
+ *
+ * The four faces of every tetrahedron are put in the bucket of their smallest
+ * node id (a counting sort), the small buckets are sorted in parallel and
+ * equal neighbours in a bucket are one face.
+ * Local face j is the face opposite vertex j.
+ * Element ids are 0-based positions in the block, face ids follow the sorted
+ * order of the face node ids, so a face is found back with a binary search.
+ * Boundary faces are the faces with a single tetrahedron.
+ * A tetrahedron with a repeated vertex is skipped: it has no faces, getFace()
+ * and getNeighbour() are -1 for it, and getNumDegenerate() counts them.
+ */
+class FaceAdjacency
+{
+public:
+    FaceAdjacency() : _faceNodes(), _faceElements(), _elementFaces(), _boundaryFaces(), _numDegenerate(0) {}
+    ~FaceAdjacency() {}
+
+    // tets must be a TETRAHEDRON or TETRAHEDRON10 block, only the vertices are used;
+    // any other block gives no faces
+    void build(const ElementBlock& tets, const int numThreads = 0);
+    // the same with the stride known at compile time
+    template<int Type> void build(const TypedBlockView<Type>& tets, const int numThreads = 0);
+    void clear();
+
+    std::size_t getNumFaces() const {return _faceElements.size() / 2;}
+    std::size_t getNumElements() const {return _elementFaces.size() / 4;}
+    // tetrahedra with a repeated vertex, skipped by build()
+    std::size_t getNumDegenerate() const {return _numDegenerate;}
+    // face of local face j of tetrahedron i, -1 for a degenerate tetrahedron
+    int getFace(const std::size_t i, const int j) const {return _elementFaces[4*i+j];}
+    // tetrahedron across local face j of tetrahedron i, -1 on the boundary
+    int getNeighbour(const std::size_t i, const int j) const;
+    // number of tetrahedra on face f, their ids are written to ids[0..1]
+    int getElements(const int f, int ids[2]) const;
+    unsigned int getFaceNode(const int f, const int k) const {return _faceNodes[3*f+k];}
+    // face with the node ids a, b, c in any order, -1 if there is none
+    int findFace(const unsigned int a, const unsigned int b, const unsigned int c) const;
+
+    const CountedVector<int>& getBoundaryFaces() const {return _boundaryFaces;}
+
+    // append the faces of a triangle block given by node ids (3 per triangle)
+    void getFacesOnTriangles(const std::vector<unsigned int>& triNodeIds, std::vector<int>& faces) const;
+    // append the faces of the mesh of every surface, node tags are mapped through nodeIndex
+    void getFacesOnSurfaces(const std::vector<int>& surfaceTags, const TagIndexMap& nodeIndex, std::vector<int>& faces) const;
+    // append the faces of every surface of a physical group of dimension 2
+    void getFacesOnPhysicalGroup(const int physicalTag, const TagIndexMap& nodeIndex, std::vector<int>& faces) const;
+    // append the tetrahedra next to every face
+    void getElementsOnFaces(const std::vector<int>& faces, std::vector<int>& elementsIds) const;
+
+private:
+    // 3 node ids per face
+    CountedVector<unsigned int> _faceNodes;
+    // 2 tetrahedra per face, -1 for the missing one of a boundary face
+    CountedVector<int> _faceElements;
+    // 4 faces per tetrahedron
+    CountedVector<int> _elementFaces;
+    CountedVector<int> _boundaryFaces;
+    std::size_t _numDegenerate;
+};
+
+
+inline void FaceAdjacency::clear()
+{
+    _faceNodes.clear();
+    _faceElements.clear();
+    _elementFaces.clear();
+    _boundaryFaces.clear();
+    _numDegenerate = 0;
+}
+
+inline void FaceAdjacency::build(const ElementBlock& tets, const int numThreads)
+{
+    switch(tets.getType())
+    {
+        case TETRAHEDRON: build(tets.view<TETRAHEDRON>(), numThreads); break;
+        case TETRAHEDRON10: build(tets.view<TETRAHEDRON10>(), numThreads); break;
+        default: clear();
+    }
+}
+
+template<int Type> inline void FaceAdjacency::build(const TypedBlockView<Type>& tets, const int numThreads)
+{
+    static_assert(ElementTraits<Type>::dim == 3 && ElementTraits<Type>::numVertices == 4, "FaceAdjacency needs tetrahedra");
+    TRACE_SCOPE("FaceAdjacency::build");
+    clear();
+    const std::size_t n = tets.size(), m = 4 * n;
+    unsigned int numNodes = 0;
+    for(std::size_t i = 0; i < n; i++)
+    {
+        for(int k = 0; k < 4; k++)
+            numNodes = std::max(numNodes, tets.node(i, k) + 1);
+    }
+
+    // a repeated vertex would break the bucket counts below (the face opposite the
+    // smallest vertex could start at it again), such tetrahedra get no faces
+    std::vector<char> degenerate(n, 0);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        const unsigned int* ele = tets.nodes(i);
+        degenerate[i] = ele[0] == ele[1] || ele[0] == ele[2] || ele[0] == ele[3] || ele[1] == ele[2] || ele[1] == ele[3] || ele[2] == ele[3];
+        _numDegenerate += degenerate[i];
+    }
+
+    // bucket a holds the faces whose smallest node is a, offsets are a prefix sum of the counts
+    std::vector<std::size_t> offsets(numNodes + 1, 0);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        if(degenerate[i])
+            continue;
+        const unsigned int* ele = tets.nodes(i);
+        const unsigned int lo01 = std::min(ele[0], ele[1]), lo23 = std::min(ele[2], ele[3]);
+        // the face opposite the smallest vertex starts at the second smallest one
+        const unsigned int lo = std::min(lo01, lo23);
+        unsigned int second = ele[0] == lo ? ele[1] : ele[0];
+        for(int k = 0; k < 4; k++)
+        {
+            if(ele[k] != lo && ele[k] < second)
+                second = ele[k];
+        }
+        offsets[lo+1] += 3;
+        offsets[second+1]++;
+    }
+    for(unsigned int a = 0; a < numNodes; a++)
+    {
+        offsets[a+1] += offsets[a];
+    }
+    std::vector<FaceEntry> entries(offsets[numNodes]);
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    unsigned int v[3];
+    for(std::size_t i = 0; i < n; i++)
+    {
+        if(degenerate[i])
+            continue;
+        const unsigned int* ele = tets.nodes(i);
+        for(int j = 0; j < 4; j++)
+        {
+            for(int k = 0, l = 0; k < 4; k++)
+            {
+                if(k != j)
+                    v[l++] = ele[k];
+            }
+            if(v[0] > v[1]) std::swap(v[0], v[1]);
+            if(v[1] > v[2]) std::swap(v[1], v[2]);
+            if(v[0] > v[1]) std::swap(v[0], v[1]);
+            FaceEntry& f = entries[cursor[v[0]]++];
+            f._b = v[1];
+            f._c = v[2];
+            f._slot = (unsigned int)(4*i+j);
+        }
+    }
+    std::vector<std::size_t>().swap(cursor);
+
+    // every thread sorts the buckets of its node range and counts their faces,
+    // a prefix sum of the counts gives the id of the first face of every range
+    const int t = (int)std::min<std::size_t>(getNumThreads(numThreads), std::max<std::size_t>(numNodes / 4096, 1));
+    std::vector<std::size_t> first(t + 1, 0);
+    parallelFor((std::size_t)t, t, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t r = b; r < e; r++)
+        {
+            std::size_t count = 0;
+            for(std::size_t a = numNodes * r / t; a < numNodes * (r + 1) / t; a++)
+            {
+                std::sort(entries.begin() + offsets[a], entries.begin() + offsets[a+1]);
+                for(std::size_t i = offsets[a]; i < offsets[a+1]; i++)
+                {
+                    if(i == offsets[a] || !entries[i].sameFace(entries[i-1]))
+                        count++;
+                }
+            }
+            first[r+1] = count;
+        }
+    }, 1);
+    for(int r = 0; r < t; r++)
+    {
+        first[r+1] += first[r];
+    }
+
+    const std::size_t numFaces = first[t];
+    _faceNodes.resize(3 * numFaces);
+    _faceElements.assign(2 * numFaces, -1);
+    _elementFaces.assign(m, -1);
+    parallelFor((std::size_t)t, t, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t r = b; r < e; r++)
+        {
+            std::size_t face = first[r];
+            for(std::size_t a = numNodes * r / t; a < numNodes * (r + 1) / t; a++)
+            {
+                for(std::size_t i = offsets[a]; i < offsets[a+1]; i++)
+                {
+                    const FaceEntry& f = entries[i];
+                    const int tet = (int)(f._slot / 4);
+                    if(i == offsets[a] || !f.sameFace(entries[i-1]))
+                    {
+                        _faceNodes[3*face] = (unsigned int)a;
+                        _faceNodes[3*face+1] = f._b;
+                        _faceNodes[3*face+2] = f._c;
+                        _faceElements[2*face] = tet;
+                        face++;
+                    } else {
+                        // a third tetrahedron on a face only happens in a broken mesh, it is dropped
+                        _faceElements[2*(face-1)+1] = tet;
+                    }
+                    _elementFaces[f._slot] = (int)(face - 1);
+                }
+            }
+        }
+    }, 1);
+    // the entries are not needed any more, release them before the boundary list grows
+    std::vector<FaceEntry>().swap(entries);
+
+    for(std::size_t f = 0; f < numFaces; f++)
+    {
+        if(_faceElements[2*f+1] < 0)
+            _boundaryFaces.push_back((int)f);
+    }
+}
+
+inline int FaceAdjacency::getNeighbour(const std::size_t i, const int j) const
+{
+    const int f = _elementFaces[4*i+j];
+    if(f < 0)
+        return -1;
+    return _faceElements[2*f] == (int)i ? _faceElements[2*f+1] : _faceElements[2*f];
+}
+
+inline int FaceAdjacency::getElements(const int f, int ids[2]) const
+{
+    ids[0] = _faceElements[2*f];
+    ids[1] = _faceElements[2*f+1];
+    return ids[1] < 0 ? 1 : 2;
+}
+
+inline int FaceAdjacency::findFace(unsigned int a, unsigned int b, unsigned int c) const
+{
+    if(a > b) std::swap(a, b);
+    if(b > c) std::swap(b, c);
+    if(a > b) std::swap(a, b);
+    std::size_t lo = 0, hi = getNumFaces();
+    while(lo < hi)
+    {
+        const std::size_t mid = (lo + hi) / 2;
+        const unsigned int* v = &_faceNodes[3*mid];
+        if(v[0] < a || (v[0] == a && (v[1] < b || (v[1] == b && v[2] < c))))
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if(lo < getNumFaces() && _faceNodes[3*lo] == a && _faceNodes[3*lo+1] == b && _faceNodes[3*lo+2] == c)
+        return (int)lo;
+    return -1;
+}
+
+inline void FaceAdjacency::getFacesOnTriangles(const std::vector<unsigned int>& triNodeIds, std::vector<int>& faces) const
+{
+    for(std::size_t k = 0; k + 2 < triNodeIds.size(); k += 3)
+    {
+        const int f = findFace(triNodeIds[k], triNodeIds[k+1], triNodeIds[k+2]);
+        if(f >= 0)
+            faces.push_back(f);
+    }
+}
+
+inline void FaceAdjacency::getFacesOnSurfaces(const std::vector<int>& surfaceTags, const TagIndexMap& nodeIndex, std::vector<int>& faces) const
+{
+    std::vector<int> elementTypes;
+    std::vector<std::vector<std::size_t> > elementTags, nodeTags;
+    std::vector<unsigned int> triNodeIds;
+    for(std::size_t i = 0; i < surfaceTags.size(); i++)
+    {
+        gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags, 2, std::abs(surfaceTags[i]));
+        const int tri = findElementType(elementTypes, TRIANGLE);
+        if(tri < 0)
+            continue;
+        nodeIndex.map(nodeTags[tri], triNodeIds);
+        getFacesOnTriangles(triNodeIds, faces);
+    }
+}
+
+inline void FaceAdjacency::getFacesOnPhysicalGroup(const int physicalTag, const TagIndexMap& nodeIndex, std::vector<int>& faces) const
+{
+    std::vector<int> surfaceTags;
+    gmsh::model::getEntitiesForPhysicalGroup(2, physicalTag, surfaceTags);
+    getFacesOnSurfaces(surfaceTags, nodeIndex, faces);
+}
+
+inline void FaceAdjacency::getElementsOnFaces(const std::vector<int>& faces, std::vector<int>& elementsIds) const
+{
+    int ids[2];
+    for(std::size_t i = 0; i < faces.size(); i++)
+    {
+        const int count = getElements(faces[i], ids);
+        for(int k = 0; k < count; k++)
+        {
+            elementsIds.push_back(ids[k]);
+        }
+    }
+}
+
+#endif
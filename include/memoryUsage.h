@@ -0,0 +1,156 @@
+#ifndef MEMORY_USAGE_H
+#define MEMORY_USAGE_H
+
+#include <vector>
+#include <atomic>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstddef>
+#include <unistd.h>
+#include <malloc.h>
+#include <sys/resource.h>
+
+
+/**
+ * Bytes held by the containers that use CountingAllocator, summed over the
+ * whole process. peak is the largest live value since the last resetPeak().
+ */
+class HeapCounters
+{
+public:
+    HeapCounters() : _live(0), _peak(0), _allocations(0) {}
+    ~HeapCounters() {}
+
+    void allocate(const std::size_t bytes)
+    {
+        const long long live = _live += (long long)bytes;
+        long long peak = _peak;
+        while(live > peak && !_peak.compare_exchange_weak(peak, live)) {}
+        _allocations++;
+    }
+    void deallocate(const std::size_t bytes) {_live -= (long long)bytes;}
+    void resetPeak() {_peak = (long long)_live;}
+
+    std::size_t getLive() const {return (std::size_t)_live;}
+    std::size_t getPeak() const {return (std::size_t)_peak;}
+    unsigned long long getAllocations() const {return _allocations;}
+
+private:
+    std::atomic<long long> _live, _peak;
+    std::atomic<unsigned long long> _allocations;
+};
+
+inline HeapCounters& getHeapCounters()
+{
+    static HeapCounters counters;
+    return counters;
+}
+
+
+/**
+ * std::allocator that reports every allocation to getHeapCounters(), for the
+ * containers of our own classes, e.g.
+ *   std::unordered_map<Key, Value, Hash, std::equal_to<Key>, CountingAllocator<std::pair<const Key, Value> > >
+ * The vectors filled by the gmsh API (getNodes, getElements, ...) must keep std::allocator.
+ */
+template<class T> class CountingAllocator
+{
+public:
+    typedef T value_type;
+
+    CountingAllocator() {}
+    template<class U> CountingAllocator(const CountingAllocator<U>&) {}
+
+    T* allocate(const std::size_t n)
+    {
+        T* p = static_cast<T*>(::operator new(n * sizeof(T)));
+        getHeapCounters().allocate(n * sizeof(T));
+        return p;
+    }
+    void deallocate(T* p, const std::size_t n)
+    {
+        getHeapCounters().deallocate(n * sizeof(T));
+        ::operator delete(p);
+    }
+};
+
+template<class T, class U> bool operator == (const CountingAllocator<T>&, const CountingAllocator<U>&) {return true;}
+template<class T, class U> bool operator != (const CountingAllocator<T>&, const CountingAllocator<U>&) {return false;}
+
+// the arrays of MeshData, TagIndexMap and the engines built on them
+template<class T> using CountedVector = std::vector<T, CountingAllocator<T> >;
+
+
+// value in bytes of a "Name:   1234 kB" line of /proc/self/status, 0 if there is none
+inline std::size_t readProcStatus(const char* name)
+{
+    std::FILE* f = std::fopen("/proc/self/status", "r");
+    if(!f)
+        return 0;
+    char line[256];
+    const std::size_t length = std::strlen(name);
+    std::size_t kb = 0;
+    while(std::fgets(line, sizeof(line), f))
+    {
+        if(std::strncmp(line, name, length) == 0 && line[length] == ':')
+        {
+            kb = (std::size_t)std::strtoull(line + length + 1, 0, 10);
+            break;
+        }
+    }
+    std::fclose(f);
+    return kb * 1024;
+}
+
+// resident set size of the process in bytes
+inline std::size_t getResidentMemory()
+{
+    long pages = 0, rss = 0;
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if(f)
+    {
+        if(std::fscanf(f, "%ld %ld", &pages, &rss) != 2)
+            rss = 0;
+        std::fclose(f);
+    }
+    return (std::size_t)rss * (std::size_t)sysconf(_SC_PAGESIZE);
+}
+
+// largest resident set size in bytes since the start or the last resetPeakResidentMemory()
+inline std::size_t getPeakResidentMemory()
+{
+    const std::size_t hwm = readProcStatus("VmHWM");
+    if(hwm > 0)
+        return hwm;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (std::size_t)usage.ru_maxrss * 1024;
+}
+
+// restart the peak at the current resident size (Linux 4.0+), false if the kernel does not allow it
+inline bool resetPeakResidentMemory()
+{
+    std::FILE* f = std::fopen("/proc/self/clear_refs", "w");
+    if(!f)
+        return false;
+    const bool ok = std::fputs("5", f) >= 0;
+    return std::fclose(f) == 0 && ok;
+}
+
+// bytes in use by malloc, gmsh included
+inline std::size_t getMallocMemory()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#elif defined(__GLIBC__)
+    struct mallinfo info = mallinfo();
+    return (std::size_t)(unsigned int)info.uordblks + (std::size_t)(unsigned int)info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef MESH_ADJACENCY_H
+#define MESH_ADJACENCY_H
+
+#include <gmsh.h>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cstddef>
+#include <cstdlib>
+#include "elementTypes.h"
+#include "meshHash.h"
+#include "memoryUsage.h"
+#include "trace.h"
+
+
+/**
+ * Edge -> element table built once from one element block of getElements().
+ *
+ * It answers "which elements touch this boundary segment" with one hash lookup
+ * instead of a getElementsByCoordinates() spatial search on the segment midpoint.
+ * The returned ids are 0-based positions in the element block, so they stay
+ * valid when gmsh element tags are sparse; elementTags[id] gives the tag back.
+ */
+class EdgeAdjacency
+{
+public:
+    EdgeAdjacency() : _edges() {}
+    ~EdgeAdjacency() {}
+
+    // nodeTags is one block of getElements() of the gmsh element type elementType.
+    // Only the corner vertices are used: a line has one edge, a triangle or quad a closed cycle.
+    // Returns false, with an empty table, for a type that is not a known 1D or 2D element.
+    bool build(const std::vector<std::size_t>& nodeTags, const int elementType);
+
+    // number of elements sharing the edge (a, b), their ids are written to ids[0..1]
+    int getElements(const std::size_t a, const std::size_t b, int ids[2]) const;
+
+    // append the elements next to every segment of a line block (two node tags per segment)
+    void getElementsOnSegments(const std::vector<std::size_t>& segNodeTags, std::vector<int>& elementsIds) const;
+
+    // append the elements next to the mesh of every curve, in the order of curveTags
+    void getElementsOnCurves(const std::vector<int>& curveTags, std::vector<int>& elementsIds) const;
+
+    // append the elements next to every curve of a physical group of dimension 1
+    void getElementsOnPhysicalGroup(const int physicalTag, std::vector<int>& elementsIds) const;
+
+    std::size_t size() const {return _edges.size();}
+    void clear() {_edges.clear();}
+
+private:
+    struct EdgeElements
+    {
+        int _ids[2];
+        int _count;
+    };
+    void insert(const std::size_t a, const std::size_t b, const int id);
+
+    // counted, a node based hash is where the memory of the adjacency goes
+    std::unordered_map<EdgeKey, EdgeElements, EdgeKeyHash, std::equal_to<EdgeKey>, CountingAllocator<std::pair<const EdgeKey, EdgeElements> > > _edges;
+};
+
+
+inline void EdgeAdjacency::insert(const std::size_t a, const std::size_t b, const int id)
+{
+    EdgeElements& ee = _edges[EdgeKey(a, b)];
+    if(ee._count < 2)
+    {
+        ee._ids[ee._count] = id;
+    }
+    ee._count++;
+}
+
+inline bool EdgeAdjacency::build(const std::vector<std::size_t>& nodeTags, const int elementType)
+{
+    TRACE_SCOPE("EdgeAdjacency::build");
+    _edges.clear();
+    // first order and high order blocks share their corner vertices
+    const int numNodes = getElementNumNodes(elementType), nv = getElementNumVertices(elementType), dim = getElementDim(elementType);
+    if(numNodes <= 0 || (dim != 1 && dim != 2))
+        return false;
+    const std::size_t numElements = nodeTags.size() / numNodes;
+    // a closed 2D mesh has about 1.5 edges per triangle
+    _edges.reserve(nv == 2 ? numElements : numElements * nv / 2 + 16);
+    for(std::size_t i = 0; i < numElements; i++)
+    {
+        const std::size_t* ele = &nodeTags[i * numNodes];
+        const int id = (int)i;
+        if(nv == 2)
+        {
+            insert(ele[0], ele[1], id);
+            continue;
+        }
+        for(int j = 0; j < nv; j++)
+        {
+            insert(ele[j], ele[j == nv-1 ? 0 : j+1], id);
+        }
+    }
+    return true;
+}
+
+inline int EdgeAdjacency::getElements(const std::size_t a, const std::size_t b, int ids[2]) const
+{
+    auto iter = _edges.find(EdgeKey(a, b));
+    if(iter == _edges.end())
+        return 0;
+    const int count = iter->second._count < 2 ? iter->second._count : 2;
+    for(int i = 0; i < count; i++)
+    {
+        ids[i] = iter->second._ids[i];
+    }
+    return count;
+}
+
+inline void EdgeAdjacency::getElementsOnSegments(const std::vector<std::size_t>& segNodeTags, std::vector<int>& elementsIds) const
+{
+    int ids[2];
+    for(std::size_t k = 0; k + 1 < segNodeTags.size(); k += 2)
+    {
+        const int count = getElements(segNodeTags[k], segNodeTags[k+1], ids);
+        for(int kk = 0; kk < count; kk++)
+        {
+            elementsIds.push_back(ids[kk]);
+        }
+    }
+}
+
+inline void EdgeAdjacency::getElementsOnCurves(const std::vector<int>& curveTags, std::vector<int>& elementsIds) const
+{
+    std::vector<int> elementTypes;
+    std::vector<std::vector<std::size_t> > elementTags, nodeTags;
+    for(std::size_t i = 0; i < curveTags.size(); i++)
+    {
+        gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags, 1, std::abs(curveTags[i]));
+        for(std::size_t j = 0; j < nodeTags.size(); j++)
+        {
+            getElementsOnSegments(nodeTags[j], elementsIds);
+        }
+    }
+}
+
+inline void EdgeAdjacency::getElementsOnPhysicalGroup(const int physicalTag, std::vector<int>& elementsIds) const
+{
+    std::vector<int> curveTags;
+    gmsh::model::getEntitiesForPhysicalGroup(1, physicalTag, curveTags);
+    getElementsOnCurves(curveTags, elementsIds);
+}
+
+#endif
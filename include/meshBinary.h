@@ -0,0 +1,348 @@
+#ifndef MESH_BINARY_H
+#define MESH_BINARY_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "meshData.h"
+
+
+/**
+ * Binary mesh file, version 1
+ *
+ * offset 0 : MeshFileHeader
+ *            MeshFileBlock[numBlocks]
+ * then every array starts on a MESH_FILE_ALIGN boundary, so a reader can mmap
+ * the file and use the arrays in place:
+ *            nodeTags  uint64[numNodes]
+ *            x, y, z   double[numNodes] each
+ *            per block elementTags uint64[numElements], connectivity uint32[numElements * numNodes]
+ * Connectivity holds 0-based node ids, the same as MeshData.
+ * Everything is stored in the byte order of the machine that wrote the file.
+ */
+#define MESH_FILE_MAGIC "LGMSHBIN"
+#define MESH_FILE_VERSION 1
+#define MESH_FILE_ALIGN 4096
+
+struct MeshFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t align;
+    uint64_t numNodes;
+    uint64_t numBlocks;
+    uint64_t nodeTagsOffset;
+    uint64_t xOffset, yOffset, zOffset;
+    uint64_t fileSize;
+};
+
+struct MeshFileBlock
+{
+    int32_t type;
+    int32_t numNodes;
+    uint64_t numElements;
+    uint64_t elementTagsOffset;
+    uint64_t connectivityOffset;
+};
+
+
+inline uint64_t alignMeshFileOffset(const uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGN - 1) / MESH_FILE_ALIGN * MESH_FILE_ALIGN;
+}
+
+// header and block table of a file with numNodes nodes: the type, numNodes and numElements
+// of every block are given, every array offset is filled in
+inline void layoutMeshFile(const uint64_t numNodes, MeshFileHeader& header, std::vector<MeshFileBlock>& blocks)
+{
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MESH_FILE_MAGIC, 8);
+    header.version = MESH_FILE_VERSION;
+    header.align = MESH_FILE_ALIGN;
+    header.numNodes = numNodes;
+    header.numBlocks = blocks.size();
+
+    uint64_t offset = sizeof(MeshFileHeader) + header.numBlocks * sizeof(MeshFileBlock);
+    header.nodeTagsOffset = offset = alignMeshFileOffset(offset);
+    header.xOffset = offset = alignMeshFileOffset(offset + header.numNodes * sizeof(uint64_t));
+    header.yOffset = offset = alignMeshFileOffset(offset + header.numNodes * sizeof(double));
+    header.zOffset = offset = alignMeshFileOffset(offset + header.numNodes * sizeof(double));
+    offset += header.numNodes * sizeof(double);
+
+    for(std::size_t i = 0; i < blocks.size(); i++)
+    {
+        MeshFileBlock& fb = blocks[i];
+        fb.elementTagsOffset = offset = alignMeshFileOffset(offset);
+        fb.connectivityOffset = offset = alignMeshFileOffset(offset + fb.numElements * sizeof(uint64_t));
+        offset += fb.numElements * fb.numNodes * sizeof(uint32_t);
+    }
+    header.fileSize = offset;
+}
+
+// the layout of a whole mesh
+inline void layoutMeshFile(const MeshData& mesh, MeshFileHeader& header, std::vector<MeshFileBlock>& blocks)
+{
+    blocks.resize(mesh.getNumBlocks());
+    for(std::size_t i = 0; i < blocks.size(); i++)
+    {
+        const ElementBlock& block = mesh.getBlock(i);
+        MeshFileBlock& fb = blocks[i];
+        std::memset(&fb, 0, sizeof(fb));
+        fb.type = block.getType();
+        fb.numNodes = block.getNumNodes();
+        fb.numElements = block.size();
+    }
+    layoutMeshFile(mesh.getNumNodes(), header, blocks);
+}
+
+
+class MeshFileWriter
+{
+public:
+    MeshFileWriter() : _out(), _offset(0) {}
+    ~MeshFileWriter() {}
+    bool open(const std::string& filename)
+    {
+        _out.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        _offset = 0;
+        return _out.good();
+    }
+    bool close()
+    {
+        _out.close();
+        return !_out.fail();
+    }
+    // zero padding up to offset, then the bytes
+    void write(const uint64_t offset, const void* data, const uint64_t size)
+    {
+        static const char zeros[MESH_FILE_ALIGN] = {0};
+        while(_offset < offset)
+        {
+            uint64_t n = offset - _offset < MESH_FILE_ALIGN ? offset - _offset : MESH_FILE_ALIGN;
+            _out.write(zeros, n);
+            _offset += n;
+        }
+        if(size > 0)
+            _out.write((const char*)data, size);
+        _offset += size;
+    }
+    uint64_t tell() const {return _offset;}
+
+private:
+    std::ofstream _out;
+    uint64_t _offset;
+};
+
+
+// write mesh as one binary file, returns false if the file could not be written
+inline bool writeMeshBinary(const MeshData& mesh, const std::string& filename)
+{
+    MeshFileHeader header;
+    std::vector<MeshFileBlock> blocks;
+    layoutMeshFile(mesh, header, blocks);
+
+    MeshFileWriter out;
+    if(!out.open(filename))
+        return false;
+    out.write(0, &header, sizeof(header));
+    if(!blocks.empty())
+        out.write(out.tell(), &blocks[0], blocks.size() * sizeof(MeshFileBlock));
+
+    // node tags are size_t in memory and uint64 on disk
+    const CountedVector<std::size_t>& tags = mesh.getNodeTags();
+    if(sizeof(std::size_t) == sizeof(uint64_t) || tags.empty())
+    {
+        out.write(header.nodeTagsOffset, tags.empty() ? 0 : &tags[0], tags.size() * sizeof(uint64_t));
+    } else {
+        std::vector<uint64_t> tags64(tags.begin(), tags.end());
+        out.write(header.nodeTagsOffset, &tags64[0], tags64.size() * sizeof(uint64_t));
+    }
+    out.write(header.xOffset, header.numNodes ? &mesh.getXs()[0] : 0, header.numNodes * sizeof(double));
+    out.write(header.yOffset, header.numNodes ? &mesh.getYs()[0] : 0, header.numNodes * sizeof(double));
+    out.write(header.zOffset, header.numNodes ? &mesh.getZs()[0] : 0, header.numNodes * sizeof(double));
+
+    for(std::size_t i = 0; i < blocks.size(); i++)
+    {
+        const ElementBlock& block = mesh.getBlock(i);
+        const CountedVector<std::size_t>& elementTags = block.getElementTags();
+        const CountedVector<unsigned int>& connectivity = block.getConnectivity();
+        if(sizeof(std::size_t) == sizeof(uint64_t) || elementTags.empty())
+        {
+            out.write(blocks[i].elementTagsOffset, elementTags.empty() ? 0 : &elementTags[0], elementTags.size() * sizeof(uint64_t));
+        } else {
+            std::vector<uint64_t> tags64(elementTags.begin(), elementTags.end());
+            out.write(blocks[i].elementTagsOffset, &tags64[0], tags64.size() * sizeof(uint64_t));
+        }
+        out.write(blocks[i].connectivityOffset, connectivity.empty() ? 0 : &connectivity[0], connectivity.size() * sizeof(uint32_t));
+    }
+    out.write(header.fileSize, 0, 0);
+    return out.close();
+}
+
+
+/**
+ * Read-only mmap of a binary mesh file.
+ * Opening checks the header and that every array lies inside the file, in O(1) per
+ * block, so it only faults in the first page; the arrays are then used in place,
+ * never copied. The node ids are checked by validateConnectivity(), which reads
+ * every connectivity page.
+ */
+class MappedMesh
+{
+public:
+    MappedMesh() : _data(0), _size(0), _header(0), _blocks(0) {}
+    ~MappedMesh() {close();}
+
+    // returns false if the file is missing, truncated, corrupt or not a version 1 mesh file
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const {return _data != 0;}
+    // true if every node id of every block is below getNumNodes()
+    bool validateConnectivity() const;
+
+    std::size_t getNumNodes() const {return _header->numNodes;}
+    const uint64_t* getNodeTags() const {return (const uint64_t*)at(_header->nodeTagsOffset);}
+    const double* getXs() const {return (const double*)at(_header->xOffset);}
+    const double* getYs() const {return (const double*)at(_header->yOffset);}
+    const double* getZs() const {return (const double*)at(_header->zOffset);}
+
+    std::size_t getNumBlocks() const {return _header->numBlocks;}
+    int getBlockType(const std::size_t i) const {return _blocks[i].type;}
+    int getBlockNumNodes(const std::size_t i) const {return _blocks[i].numNodes;}
+    std::size_t getBlockSize(const std::size_t i) const {return _blocks[i].numElements;}
+    const uint64_t* getElementTags(const std::size_t i) const {return (const uint64_t*)at(_blocks[i].elementTagsOffset);}
+    const uint32_t* getConnectivity(const std::size_t i) const {return (const uint32_t*)at(_blocks[i].connectivityOffset);}
+    ElementView getElement(const std::size_t block, const std::size_t i) const
+    {
+        return ElementView(getConnectivity(block) + i * _blocks[block].numNodes, _blocks[block].numNodes, getElementTags(block)[i]);
+    }
+
+private:
+    MappedMesh(const MappedMesh&);
+    MappedMesh& operator = (const MappedMesh&);
+    const char* at(const uint64_t offset) const {return (const char*)_data + offset;}
+    // count items of itemSize bytes at offset lie inside the mapping, without overflow
+    bool isInside(const uint64_t offset, const uint64_t count, const uint64_t itemSize) const
+    {
+        return offset % sizeof(uint64_t) == 0 && offset <= _size && count <= (_size - offset) / itemSize;
+    }
+    bool isValid() const;
+
+    void* _data;
+    std::size_t _size;
+    const MeshFileHeader* _header;
+    const MeshFileBlock* _blocks;
+};
+
+
+inline bool MappedMesh::open(const std::string& filename)
+{
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (std::size_t)st.st_size < sizeof(MeshFileHeader))
+    {
+        ::close(fd);
+        return false;
+    }
+    void* data = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+    if(data == MAP_FAILED)
+        return false;
+    _data = data;
+    _size = st.st_size;
+    _header = (const MeshFileHeader*)_data;
+    _blocks = (const MeshFileBlock*)(at(sizeof(MeshFileHeader)));
+
+    if(!isValid())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+inline bool MappedMesh::isValid() const
+{
+    const MeshFileHeader& h = *_header;
+    if(std::memcmp(h.magic, MESH_FILE_MAGIC, 8) != 0 || h.version != MESH_FILE_VERSION || h.fileSize > _size)
+        return false;
+    if(!isInside(sizeof(MeshFileHeader), h.numBlocks, sizeof(MeshFileBlock)))
+        return false;
+    // node ids are stored as uint32
+    if(h.numNodes > 0xFFFFFFFFULL || !isInside(h.nodeTagsOffset, h.numNodes, sizeof(uint64_t)) || !isInside(h.xOffset, h.numNodes, sizeof(double))
+       || !isInside(h.yOffset, h.numNodes, sizeof(double)) || !isInside(h.zOffset, h.numNodes, sizeof(double)))
+        return false;
+    for(std::size_t b = 0; b < h.numBlocks; b++)
+    {
+        const MeshFileBlock& fb = _blocks[b];
+        if(fb.numNodes <= 0 || !isInside(fb.elementTagsOffset, fb.numElements, sizeof(uint64_t))
+           || !isInside(fb.connectivityOffset, fb.numElements, (uint64_t)fb.numNodes * sizeof(uint32_t)))
+            return false;
+    }
+    return true;
+}
+
+inline bool MappedMesh::validateConnectivity() const
+{
+    for(std::size_t b = 0; b < getNumBlocks(); b++)
+    {
+        const uint32_t* ids = getConnectivity(b);
+        const std::size_t n = getBlockSize(b) * getBlockNumNodes(b);
+        for(std::size_t i = 0; i < n; i++)
+        {
+            if(ids[i] >= getNumNodes())
+                return false;
+        }
+    }
+    return true;
+}
+
+inline void MappedMesh::close()
+{
+    if(_data)
+        munmap(_data, _size);
+    _data = 0;
+    _size = 0;
+    _header = 0;
+    _blocks = 0;
+}
+
+// copy a binary mesh file into mesh, returns false if it can not be opened or a node id is out of range
+inline bool readMeshBinary(const std::string& filename, MeshData& mesh)
+{
+    MappedMesh file;
+    if(!file.open(filename) || !file.validateConnectivity())
+        return false;
+    const std::size_t n = file.getNumNodes();
+    std::vector<std::size_t> nodeTags(file.getNodeTags(), file.getNodeTags() + n);
+    std::vector<double> coord(3 * n);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        coord[3*i] = file.getXs()[i];
+        coord[3*i+1] = file.getYs()[i];
+        coord[3*i+2] = file.getZs()[i];
+    }
+    mesh.clear();
+    mesh.setNodes(nodeTags, coord);
+    for(std::size_t b = 0; b < file.getNumBlocks(); b++)
+    {
+        const std::size_t size = file.getBlockSize(b);
+        std::vector<std::size_t> elementTags(file.getElementTags(b), file.getElementTags(b) + size);
+        std::vector<unsigned int> nodeIds(file.getConnectivity(b), file.getConnectivity(b) + size * file.getBlockNumNodes(b));
+        mesh.addBlockByIndex(file.getBlockType(b), elementTags, nodeIds);
+    }
+    return true;
+}
+
+#endif
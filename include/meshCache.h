@@ -0,0 +1,329 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <gmsh.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+#include <ostream>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "meshHash.h"
+#include "meshBinary.h"
+#include "meshData.h"
+
+
+// bump when the content of a cache entry changes, every older entry is then a miss
+#define MESH_CACHE_VERSION 1
+#define MESH_CACHE_ARRAYS_MAGIC "LGMSHARR"
+
+
+/**
+ * Canonical hash of everything the mesh depends on: the geometry entities in
+ * the order they are created, their mesh sizes and the mesh options.
+ * Doubles are hashed by value (-0 is 0), so the same input always gives the
+ * same key on one machine. Options are kept by name and hashed sorted, the
+ * order they are added in does not matter. The key is 128 bits, two
+ * independent 64 bit hashes, as 32 hex digits.
+ */
+class MeshCacheKey
+{
+public:
+    MeshCacheKey() : _h1(0xcbf29ce484222325ULL), _h2(0x9E3779B97F4A7C15ULL), _options()
+    {
+        add((long long)MESH_CACHE_VERSION);
+#ifdef GMSH_API_VERSION
+        add(std::string(GMSH_API_VERSION));
+#endif
+    }
+    ~MeshCacheKey() {}
+
+    void add(const long long value) {addBytes(&value, sizeof(value));}
+    void add(const double value)
+    {
+        double v = value == 0 ? 0.0 : value;
+        addBytes(&v, sizeof(v));
+    }
+    void add(const std::string& value)
+    {
+        add((long long)value.size());
+        addBytes(value.data(), value.size());
+    }
+    // a geometry point and its mesh size
+    void addPoint(const double x, const double y, const double z, const double lc)
+    {
+        add(x);
+        add(y);
+        add(z);
+        add(lc);
+    }
+    void addOption(const std::string& name, const double value) {_options[name] = value;}
+    // the current value of a gmsh number option
+    void addGmshOption(const std::string& name)
+    {
+        double value = 0;
+        gmsh::option::getNumber(name, value);
+        addOption(name, value);
+    }
+    // the gmsh options that change a generated mesh
+    void addGmshMeshOptions()
+    {
+        static const char* names[] = {"Mesh.Algorithm", "Mesh.Algorithm3D", "Mesh.MeshSizeFactor", "Mesh.MeshSizeMin",
+            "Mesh.MeshSizeMax", "Mesh.MeshSizeFromPoints", "Mesh.MeshSizeExtendFromBoundary", "Mesh.ElementOrder",
+            "Mesh.RecombineAll", "Mesh.Smoothing", "Mesh.RandomFactor"};
+        for(std::size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        {
+            addGmshOption(names[i]);
+        }
+    }
+
+    std::string getKey() const;
+
+private:
+    void addBytes(const void* data, const std::size_t size)
+    {
+        const unsigned char* p = (const unsigned char*)data;
+        for(std::size_t i = 0; i < size; i++)
+        {
+            _h1 = (_h1 ^ p[i]) * 0x100000001b3ULL;
+            _h2 = mixHash(_h2 ^ p[i]);
+        }
+    }
+
+    unsigned long long _h1, _h2;
+    std::map<std::string, double> _options;
+};
+
+inline std::string MeshCacheKey::getKey() const
+{
+    MeshCacheKey key(*this);
+    for(std::map<std::string, double>::const_iterator iter = _options.begin(); iter != _options.end(); ++iter)
+    {
+        key.add(iter->first);
+        key.add(iter->second);
+    }
+    char hex[33];
+    std::snprintf(hex, sizeof(hex), "%016llx%016llx", key._h1, key._h2);
+    return std::string(hex);
+}
+
+
+/**
+ * Named integer arrays stored next to the mesh of a cache entry, e.g. the
+ * boundary node ids a demo extracted, so a hit needs no gmsh query at all.
+ */
+class MeshCacheArrays
+{
+public:
+    MeshCacheArrays() : _arrays() {}
+    ~MeshCacheArrays() {}
+
+    template<class T> void put(const std::string& name, const std::vector<T>& values)
+    {
+        _arrays[name].assign(values.begin(), values.end());
+    }
+    // false if there is no array of that name
+    template<class T> bool get(const std::string& name, std::vector<T>& values) const
+    {
+        std::map<std::string, std::vector<long long> >::const_iterator iter = _arrays.find(name);
+        if(iter == _arrays.end())
+            return false;
+        values.assign(iter->second.begin(), iter->second.end());
+        return true;
+    }
+    void clear() {_arrays.clear();}
+
+    bool write(const std::string& filename) const;
+    bool read(const std::string& filename);
+
+private:
+    std::map<std::string, std::vector<long long> > _arrays;
+};
+
+inline bool MeshCacheArrays::write(const std::string& filename) const
+{
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    uint64_t count = _arrays.size();
+    out.write(MESH_CACHE_ARRAYS_MAGIC, 8);
+    out.write((const char*)&count, sizeof(count));
+    for(std::map<std::string, std::vector<long long> >::const_iterator iter = _arrays.begin(); iter != _arrays.end(); ++iter)
+    {
+        uint64_t nameSize = iter->first.size(), size = iter->second.size();
+        out.write((const char*)&nameSize, sizeof(nameSize));
+        out.write(iter->first.data(), nameSize);
+        out.write((const char*)&size, sizeof(size));
+        if(size > 0)
+            out.write((const char*)&iter->second[0], size * sizeof(long long));
+    }
+    out.close();
+    return !out.fail();
+}
+
+inline bool MeshCacheArrays::read(const std::string& filename)
+{
+    _arrays.clear();
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    char magic[8];
+    uint64_t count = 0;
+    if(!in.read(magic, 8) || std::memcmp(magic, MESH_CACHE_ARRAYS_MAGIC, 8) != 0 || !in.read((char*)&count, sizeof(count)))
+        return false;
+    for(uint64_t i = 0; i < count; i++)
+    {
+        uint64_t nameSize = 0, size = 0;
+        if(!in.read((char*)&nameSize, sizeof(nameSize)) || nameSize > (1 << 16))
+            return false;
+        std::string name(nameSize, ' ');
+        if(!in.read(&name[0], nameSize) || !in.read((char*)&size, sizeof(size)))
+            return false;
+        std::vector<long long>& values = _arrays[name];
+        values.resize(size);
+        if(size > 0 && !in.read((char*)&values[0], size * sizeof(long long)))
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ * On-disk cache of generated meshes, one entry per MeshCacheKey in directory:
+ *   <key>.bin    : the extracted MeshData (meshBinary.h), mapped on load
+ *   <key>.arrays : the named arrays of MeshCacheArrays
+ *   <key>.msh    : the gmsh mesh file, copied to the output on a hit
+ *
+ * Invalidation rules:
+ * - any change of the geometry, a mesh size or a hashed option gives a new key,
+ *   so a stale entry is never read, it is only left behind;
+ * - MESH_CACHE_VERSION and the gmsh API version are part of every key;
+ * - an entry that is missing a file or can not be read is a miss, counted as
+ *   invalid, and its files are removed;
+ * - invalidate() removes one entry, clear() every entry of the directory.
+ * Every file is written under a temporary name and renamed, the .bin last, so
+ * an interrupted store never leaves an entry that looks complete.
+ */
+class MeshCache
+{
+public:
+    MeshCache(const std::string& directory = "meshCache") : _directory(directory), _hits(0), _misses(0), _invalid(0)
+    {
+        mkdir(_directory.c_str(), 0755);
+    }
+    ~MeshCache() {}
+
+    // true on a hit, mesh and arrays then hold the stored entry;
+    // with needGmshMesh an entry stored without its gmsh mesh file is invalid
+    bool load(const std::string& key, MeshData& mesh, MeshCacheArrays& arrays, const bool needGmshMesh = true);
+    // store mesh and arrays, with the current gmsh mesh when writeGmshMesh is true
+    bool store(const std::string& key, const MeshData& mesh, const MeshCacheArrays& arrays, const bool writeGmshMesh = true);
+    // copy the gmsh mesh file of an entry to filename, what gmsh::write(filename) would give
+    bool copyGmshMesh(const std::string& key, const std::string& filename) const;
+    void invalidate(const std::string& key) const;
+    void clear() const;
+
+    std::string getPath(const std::string& key, const std::string& extension) const {return _directory + "/" + key + extension;}
+    std::size_t getHits() const {return _hits;}
+    std::size_t getMisses() const {return _misses;}
+    // misses on an entry that existed but could not be read
+    std::size_t getInvalid() const {return _invalid;}
+    void printStats(std::ostream& out) const
+    {
+        out<<"mesh cache: "<<_hits<<" hits, "<<_misses<<" misses ("<<_invalid<<" invalid entries)"<<std::endl;
+    }
+
+private:
+    static bool exists(const std::string& filename)
+    {
+        struct stat st;
+        return stat(filename.c_str(), &st) == 0;
+    }
+
+    std::string _directory;
+    std::size_t _hits, _misses, _invalid;
+};
+
+
+inline bool MeshCache::load(const std::string& key, MeshData& mesh, MeshCacheArrays& arrays, const bool needGmshMesh)
+{
+    const std::string bin = getPath(key, ".bin");
+    if(!exists(bin))
+    {
+        _misses++;
+        return false;
+    }
+    if((needGmshMesh && !exists(getPath(key, ".msh"))) || !arrays.read(getPath(key, ".arrays")) || !readMeshBinary(bin, mesh))
+    {
+        invalidate(key);
+        mesh.clear();
+        arrays.clear();
+        _misses++;
+        _invalid++;
+        return false;
+    }
+    _hits++;
+    return true;
+}
+
+inline bool MeshCache::store(const std::string& key, const MeshData& mesh, const MeshCacheArrays& arrays, const bool writeGmshMesh)
+{
+    const std::string tmp = getPath(key, ".tmp");
+    // gmsh picks the format from the extension
+    if(writeGmshMesh)
+    {
+        gmsh::write(tmp + ".msh");
+        if(std::rename((tmp + ".msh").c_str(), getPath(key, ".msh").c_str()) != 0)
+            return false;
+    }
+    if(!arrays.write(tmp) || std::rename(tmp.c_str(), getPath(key, ".arrays").c_str()) != 0)
+        return false;
+    if(!writeMeshBinary(mesh, tmp) || std::rename(tmp.c_str(), getPath(key, ".bin").c_str()) != 0)
+        return false;
+    return true;
+}
+
+inline bool MeshCache::copyGmshMesh(const std::string& key, const std::string& filename) const
+{
+    std::ifstream in(getPath(key, ".msh").c_str(), std::ios::in | std::ios::binary);
+    std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!in || !out)
+        return false;
+    out<<in.rdbuf();
+    out.close();
+    return !out.fail();
+}
+
+inline void MeshCache::invalidate(const std::string& key) const
+{
+    // the .bin first, the entry is then a plain miss even if a later remove fails
+    std::remove(getPath(key, ".bin").c_str());
+    std::remove(getPath(key, ".arrays").c_str());
+    std::remove(getPath(key, ".msh").c_str());
+}
+
+inline void MeshCache::clear() const
+{
+    DIR* dir = opendir(_directory.c_str());
+    if(!dir)
+        return;
+    std::vector<std::string> names;
+    for(struct dirent* entry = readdir(dir); entry; entry = readdir(dir))
+    {
+        const std::string name = entry->d_name;
+        const std::size_t dot = name.rfind('.');
+        if(dot == std::string::npos)
+            continue;
+        const std::string extension = name.substr(dot);
+        if(extension == ".bin" || extension == ".arrays" || extension == ".msh" || extension == ".tmp")
+            names.push_back(name);
+    }
+    closedir(dir);
+    for(std::size_t i = 0; i < names.size(); i++)
+    {
+        std::remove((_directory + "/" + names[i]).c_str());
+    }
+}
+
+#endif
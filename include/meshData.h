@@ -0,0 +1,333 @@
+#ifndef MESH_DATA_H
+#define MESH_DATA_H
+
+#include <gmsh.h>
+#include <vector>
+#include <deque>
+#include <cstddef>
+#include "memoryUsage.h"
+#include "tagIndexMap.h"
+#include "elementTypes.h"
+#include "trace.h"
+
+
+/**
+ * Read-only view on the nodes of one element inside an ElementBlock.
+ * Node ids are 0-based indices into the MeshData coordinate arrays, whatever
+ * the gmsh node tags are.
+ *
+ * For a second order triangle (gmsh type 9) the layout is
+ * id[0] ~ id[2] : three vertices index of triangle
+ * id[3] is the midpoint between id[0] and id[1]
+ * id[4] is the midpoint between id[1] and id[2]
+ * id[5] is the midpoint between id[2] and id[0]
+ */
+class ElementView
+{
+public:
+    ElementView(const unsigned int* ids, const int numNodes, const std::size_t tag) : _ids(ids), _numNodes(numNodes), _tag(tag) {}
+    ~ElementView() {}
+    int size() const {return _numNodes;}
+    unsigned int operator [] (const int i) const {return _ids[i];}
+    const unsigned int* begin() const {return _ids;}
+    const unsigned int* end() const {return _ids + _numNodes;}
+    std::size_t getTag() const {return _tag;}
+
+private:
+    const unsigned int* _ids;
+    int _numNodes;
+    std::size_t _tag;
+};
+
+
+/**
+ * All elements of one gmsh element type, stored with a fixed stride of
+ * numNodes node ids per element in one contiguous array.
+ */
+class ElementBlock
+{
+public:
+    ElementBlock(const int type = 0, const int numNodes = 0) : _type(type), _numNodes(numNodes), _elementTags(), _connectivity() {}
+    ~ElementBlock() {}
+    int getType() const {return _type;}
+    int getNumNodes() const {return _numNodes;}
+    std::size_t size() const {return _elementTags.size();}
+    ElementView operator [] (const std::size_t i) const {return ElementView(&_connectivity[i * _numNodes], _numNodes, _elementTags[i]);}
+    // fixed stride view, Type must be the type of this block (see visitBlock)
+    template<int Type> TypedBlockView<Type> view() const
+    {
+        return TypedBlockView<Type>(_connectivity.empty() ? 0 : &_connectivity[0], _elementTags.empty() ? 0 : &_elementTags[0], size());
+    }
+    const CountedVector<std::size_t>& getElementTags() const {return _elementTags;}
+    const CountedVector<unsigned int>& getConnectivity() const {return _connectivity;}
+    CountedVector<std::size_t>& getElementTags() {return _elementTags;}
+    CountedVector<unsigned int>& getConnectivity() {return _connectivity;}
+
+private:
+    int _type, _numNodes;
+    CountedVector<std::size_t> _elementTags;
+    CountedVector<unsigned int> _connectivity;
+};
+
+
+/**
+ * Structure-of-arrays mesh: contiguous x / y / z arrays and one
+ * fixed-stride connectivity array per element type.
+ * Every array is sized exactly from the counts gmsh returns.
+ */
+class MeshData
+{
+public:
+    MeshData() : _x(), _y(), _z(), _nodeTags(), _nodeIndex(), _blocks() {}
+    ~MeshData() {}
+
+    // nodeTags / coord as returned by getNodes(), coord is (x1, y1, z1, .....)
+    void setNodes(const std::vector<std::size_t>& nodeTags, const std::vector<double>& coord);
+    // add nodes after the existing ones, e.g. the mid-edge nodes of a second order mesh
+    void appendNodes(const std::vector<std::size_t>& nodeTags, const std::vector<double>& coord);
+    // one block of getElements(), node tags are converted to 0-based node ids through getNodeIndex()
+    ElementBlock& addBlock(const int type, const std::vector<std::size_t>& elementTags, const std::vector<std::size_t>& nodeTags);
+    // a block whose connectivity already holds 0-based node ids
+    ElementBlock& addBlockByIndex(const int type, const std::vector<std::size_t>& elementTags, const std::vector<unsigned int>& nodeIds);
+    // order[newId] = oldId: nodes are moved with their tags and the connectivity of every block is renumbered
+    void renumberNodes(const std::vector<unsigned int>& order);
+    // order[newId] = oldId: elements of block i are moved with their tags
+    void reorderElements(const std::size_t i, const std::vector<unsigned int>& order);
+    // getNodes() + getElements() of the current gmsh model; with a dim / tag
+    // filter the nodes on the boundary of the entities are loaded too
+    void loadFromGmsh(const int dim = -1, const int tag = -1);
+    void clear();
+
+    std::size_t getNumNodes() const {return _x.size();}
+    double getX(const std::size_t i) const {return _x[i];}
+    double getY(const std::size_t i) const {return _y[i];}
+    double getZ(const std::size_t i) const {return _z[i];}
+    const CountedVector<double>& getXs() const {return _x;}
+    const CountedVector<double>& getYs() const {return _y;}
+    const CountedVector<double>& getZs() const {return _z;}
+    const CountedVector<std::size_t>& getNodeTags() const {return _nodeTags;}
+    // node tag -> index into the coordinate arrays, safe for sparse tags
+    const TagIndexMap& getNodeIndex() const {return _nodeIndex;}
+
+    std::size_t getNumBlocks() const {return _blocks.size();}
+    const ElementBlock& getBlock(const std::size_t i) const {return _blocks[i];}
+    // block of the given gmsh element type, 0 if the mesh has none
+    const ElementBlock* findBlock(const int type) const;
+    // number of elements of dimension dim over all blocks
+    std::size_t getNumElements(const int dim) const;
+    // number of connectivity entries over all blocks whose node tag was not loaded (TagIndexMap::npos)
+    std::size_t getNumUnknownNodes() const;
+    // bytes held by the coordinate, tag, index and connectivity arrays
+    std::size_t getMemory() const;
+
+private:
+    // counted in getHeapCounters(), like every array of our own
+    CountedVector<double> _x, _y, _z;
+    CountedVector<std::size_t> _nodeTags;
+    TagIndexMap _nodeIndex;
+    // a deque, so references to a block stay valid when more blocks are added
+    std::deque<ElementBlock> _blocks;
+};
+
+
+inline void MeshData::setNodes(const std::vector<std::size_t>& nodeTags, const std::vector<double>& coord)
+{
+    TRACE_SCOPE("MeshData::setNodes");
+    const std::size_t n = coord.size() / 3;
+    _x.resize(n);
+    _y.resize(n);
+    _z.resize(n);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        _x[i] = coord[3*i];
+        _y[i] = coord[3*i+1];
+        _z[i] = coord[3*i+2];
+    }
+    _nodeTags.assign(nodeTags.begin(), nodeTags.end());
+    _nodeIndex.build(_nodeTags);
+}
+
+inline void MeshData::appendNodes(const std::vector<std::size_t>& nodeTags, const std::vector<double>& coord)
+{
+    const std::size_t first = _x.size(), n = coord.size() / 3;
+    _x.resize(first + n);
+    _y.resize(first + n);
+    _z.resize(first + n);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        _x[first+i] = coord[3*i];
+        _y[first+i] = coord[3*i+1];
+        _z[first+i] = coord[3*i+2];
+    }
+    _nodeTags.insert(_nodeTags.end(), nodeTags.begin(), nodeTags.end());
+    _nodeIndex.build(_nodeTags);
+}
+
+inline ElementBlock& MeshData::addBlockByIndex(const int type, const std::vector<std::size_t>& elementTags, const std::vector<unsigned int>& nodeIds)
+{
+    int numNodes = getElementNumNodes(type);
+    if(numNodes == 0 && !elementTags.empty())
+        numNodes = (int)(nodeIds.size() / elementTags.size());
+    _blocks.push_back(ElementBlock(type, numNodes));
+    ElementBlock& block = _blocks.back();
+    block.getElementTags().assign(elementTags.begin(), elementTags.end());
+    block.getConnectivity().assign(nodeIds.begin(), nodeIds.end());
+    return block;
+}
+
+inline ElementBlock& MeshData::addBlock(const int type, const std::vector<std::size_t>& elementTags, const std::vector<std::size_t>& nodeTags)
+{
+    TRACE_SCOPE_ARG("MeshData::addBlock", type);
+    int numNodes = getElementNumNodes(type);
+    if(numNodes == 0 && !elementTags.empty())
+        numNodes = (int)(nodeTags.size() / elementTags.size());
+    _blocks.push_back(ElementBlock(type, numNodes));
+    ElementBlock& block = _blocks.back();
+    block.getElementTags().assign(elementTags.begin(), elementTags.end());
+    _nodeIndex.map(nodeTags, block.getConnectivity());
+    return block;
+}
+
+inline void MeshData::loadFromGmsh(const int dim, const int tag)
+{
+    TRACE_SCOPE_ARG("MeshData::loadFromGmsh", dim);
+    clear();
+    std::vector<std::size_t> nodeTags;
+    std::vector<double> coord, parametricCoord;
+    // the elements of an entity also use the nodes classified on its boundary
+    TRACE_CALL(gmsh::model::mesh::getNodes(nodeTags, coord, parametricCoord, dim, tag, dim >= 0, false));
+    setNodes(nodeTags, coord);
+    if(_nodeIndex.size() > 0 && dim >= 0)
+    {
+        // a curve shared by two surfaces gives its nodes twice, keep the first
+        std::size_t n = 0;
+        for(std::size_t i = 0; i < nodeTags.size(); i++)
+        {
+            if(_nodeIndex.find(nodeTags[i]) != i)
+                continue;
+            nodeTags[n] = nodeTags[i];
+            for(int k = 0; k < 3; k++)
+                coord[3*n+k] = coord[3*i+k];
+            n++;
+        }
+        if(n < nodeTags.size())
+        {
+            nodeTags.resize(n);
+            coord.resize(3 * n);
+            setNodes(nodeTags, coord);
+        }
+    }
+
+    std::vector<int> elementTypes;
+    std::vector<std::vector<std::size_t> > elementTags, nodeTagss;
+    TRACE_CALL(gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTagss, dim, tag));
+    for(std::size_t i = 0; i < elementTypes.size(); i++)
+    {
+        addBlock(elementTypes[i], elementTags[i], nodeTagss[i]);
+    }
+}
+
+inline std::size_t MeshData::getMemory() const
+{
+    std::size_t bytes = (_x.capacity() + _y.capacity() + _z.capacity()) * sizeof(double) + _nodeTags.capacity() * sizeof(std::size_t) + _nodeIndex.memory();
+    for(std::size_t i = 0; i < _blocks.size(); i++)
+    {
+        bytes += _blocks[i].getElementTags().capacity() * sizeof(std::size_t) + _blocks[i].getConnectivity().capacity() * sizeof(unsigned int);
+    }
+    return bytes;
+}
+
+inline void MeshData::renumberNodes(const std::vector<unsigned int>& order)
+{
+    TRACE_SCOPE("MeshData::renumberNodes");
+    const std::size_t n = _x.size();
+    CountedVector<double> x(n), y(n), z(n);
+    CountedVector<std::size_t> nodeTags(n);
+    std::vector<unsigned int> rank(n);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        x[i] = _x[order[i]];
+        y[i] = _y[order[i]];
+        z[i] = _z[order[i]];
+        nodeTags[i] = _nodeTags[order[i]];
+        rank[order[i]] = (unsigned int)i;
+    }
+    _x.swap(x);
+    _y.swap(y);
+    _z.swap(z);
+    _nodeTags.swap(nodeTags);
+    _nodeIndex.build(_nodeTags);
+    for(std::size_t b = 0; b < _blocks.size(); b++)
+    {
+        CountedVector<unsigned int>& ids = _blocks[b].getConnectivity();
+        for(std::size_t i = 0; i < ids.size(); i++)
+        {
+            ids[i] = rank[ids[i]];
+        }
+    }
+}
+
+inline void MeshData::reorderElements(const std::size_t i, const std::vector<unsigned int>& order)
+{
+    ElementBlock& block = _blocks[i];
+    const int numNodes = block.getNumNodes();
+    const CountedVector<std::size_t>& oldTags = block.getElementTags();
+    const CountedVector<unsigned int>& oldIds = block.getConnectivity();
+    CountedVector<std::size_t> elementTags(oldTags.size());
+    CountedVector<unsigned int> ids(oldIds.size());
+    for(std::size_t e = 0; e < order.size(); e++)
+    {
+        elementTags[e] = oldTags[order[e]];
+        for(int k = 0; k < numNodes; k++)
+        {
+            ids[numNodes*e+k] = oldIds[numNodes*order[e]+k];
+        }
+    }
+    block.getElementTags().swap(elementTags);
+    block.getConnectivity().swap(ids);
+}
+
+inline void MeshData::clear()
+{
+    _x.clear();
+    _y.clear();
+    _z.clear();
+    _nodeTags.clear();
+    _nodeIndex.clear();
+    _blocks.clear();
+}
+
+inline const ElementBlock* MeshData::findBlock(const int type) const
+{
+    for(std::size_t i = 0; i < _blocks.size(); i++)
+    {
+        if(_blocks[i].getType() == type)
+            return &_blocks[i];
+    }
+    return 0;
+}
+
+inline std::size_t MeshData::getNumElements(const int dim) const
+{
+    std::size_t n = 0;
+    for(std::size_t i = 0; i < _blocks.size(); i++)
+    {
+        if(getElementDim(_blocks[i].getType()) == dim)
+            n += _blocks[i].size();
+    }
+    return n;
+}
+
+inline std::size_t MeshData::getNumUnknownNodes() const
+{
+    std::size_t n = 0;
+    for(std::size_t i = 0; i < _blocks.size(); i++)
+    {
+        const CountedVector<unsigned int>& ids = _blocks[i].getConnectivity();
+        for(std::size_t k = 0; k < ids.size(); k++)
+            n += ids[k] >= _x.size();
+    }
+    return n;
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef MESH_HASH_H
+#define MESH_HASH_H
+
+#include <cstddef>
+
+
+/**
+ * Undirected mesh edge between two node tags.
+ * The smaller tag is always stored first, so (a, b) and (b, a) are the same key.
+ */
+class EdgeKey
+{
+public:
+    EdgeKey(const std::size_t a = 0, const std::size_t b = 0) : _first(a < b ? a : b), _second(a < b ? b : a) {}
+    ~EdgeKey() {}
+    std::size_t getFirst() const {return _first;}
+    std::size_t getSecond() const {return _second;}
+    bool operator == (const EdgeKey& e) const {return _first == e._first && _second == e._second;}
+    bool operator < (const EdgeKey& e) const {return _first == e._first ? _second < e._second : _first < e._first;}
+
+private:
+    std::size_t _first, _second;
+};
+
+// splitmix64 finalizer, spreads regular keys over all bits
+inline unsigned long long mixHash(unsigned long long h)
+{
+    h ^= h >> 30;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 27;
+    h *= 0x94D049BB133111EBULL;
+    h ^= h >> 31;
+    return h;
+}
+
+struct EdgeKeyHash
+{
+    std::size_t operator () (const EdgeKey& e) const
+    {
+        return (std::size_t)mixHash(mixHash((unsigned long long)e.getFirst()) ^ (unsigned long long)e.getSecond());
+    }
+};
+
+#endif
@@ -0,0 +1,569 @@
+#ifndef MESH_PARTITIONER_H
+#define MESH_PARTITIONER_H
+
+#include <gmsh.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cstddef>
+#include <stdint.h>
+#include "elementTypes.h"
+#include "meshBinary.h"
+#include "meshData.h"
+#include "parallelSort.h"
+#include "tagIndexMap.h"
+#include "trace.h"
+
+
+enum PartitionMethod
+{
+    // recursive coordinate bisection: every cut is across the longest side of the box of the element centroids
+    PARTITION_COORDINATE,
+    // recursive inertial bisection: every cut is across the principal axis of inertia of the centroids
+    PARTITION_INERTIAL,
+    // graph partitioning by gmsh::model::mesh::partition (Metis), the gmsh model must hold the mesh
+    PARTITION_GMSH
+};
+
+
+/**
+ * One part with its ghost layers. Ids are 0-based: global element ids are
+ * positions in the partitioned block, global node ids MeshData node ids.
+ */
+struct MeshPartition
+{
+    // global element of every local element: the owned ones first, then ghost layer 1, 2, ...;
+    // layer l is [_layerOffsets[l], _layerOffsets[l+1]), layer 0 is the owned elements
+    std::vector<unsigned int> _elements;
+    std::vector<std::size_t> _layerOffsets;
+    // global node of every local node, the nodes this part owns first
+    std::vector<unsigned int> _nodes;
+    std::size_t _numOwnedNodes;
+    // local node ids of the local elements, with the stride of the block
+    std::vector<unsigned int> _connectivity;
+    // neighbour parts in increasing order; for _neighbours[k], the owned local nodes sent to it and
+    // the local nodes it owns that are received from it, a shared node is at the same position on both sides
+    std::vector<int> _neighbours;
+    std::vector<std::vector<unsigned int> > _send, _receive;
+};
+
+struct PartitionQuality
+{
+    // element facets (edges of 2D elements, faces of tetrahedra) whose two elements are in different parts
+    std::size_t _edgeCut;
+    // largest part over the mean part size
+    double _imbalance;
+    std::size_t _minElements, _maxElements;
+    // over all parts, once buildPartitions() ran
+    std::size_t _ghostElements, _ghostNodes;
+};
+
+
+/**
+ * Element partitioning of one block, for runs over several processes.
+ *
+ * partition() gives every element a part: recursive coordinate or inertial
+ * bisection of the element centroids (built in, any number of parts, the
+ * halves of the first cuts are cut on their own threads), or gmsh's graph
+ * partitioner. buildPartitions() adds the ghost layers (layer l + 1 is the
+ * elements sharing a node with layer l), numbers every part locally and
+ * builds the node exchange: a node is owned by the smallest part among its
+ * elements, the other parts receive it from that owner. write() writes every
+ * part to its own files on several threads.
+ */
+class MeshPartitioner
+{
+public:
+    MeshPartitioner() : _numParts(0), _parts(), _partitions() {}
+    ~MeshPartitioner() {}
+
+    void partition(const MeshData& mesh, const ElementBlock& block, const int numParts, const PartitionMethod method = PARTITION_COORDINATE, const int numThreads = 0);
+    // parts chosen elsewhere, one per element of the block, in [0, numParts)
+    void setParts(const std::vector<int>& parts, const int numParts);
+    // ghost layers, local numbering and send / receive lists of every part; with 0 layers a
+    // part still receives the nodes of its own elements that another part owns
+    void buildPartitions(const MeshData& mesh, const ElementBlock& block, const int numLayers = 1, const int numThreads = 0);
+    PartitionQuality getQuality(const ElementBlock& block, const int numThreads = 0) const;
+    // <prefix>_<part>.bin: the local mesh in the meshBinary format, the local -> global maps are its node
+    // and element tags (the gmsh tags); <prefix>_<part>.txt: ghost layers, neighbours, send / receive lists
+    bool write(const MeshData& mesh, const ElementBlock& block, const std::string& prefix, const int numThreads = 0) const;
+
+    int getNumParts() const {return _numParts;}
+    const std::vector<int>& getParts() const {return _parts;}
+    int getPart(const std::size_t element) const {return _parts[element];}
+    const MeshPartition& getPartition(const int part) const {return _partitions[part];}
+
+private:
+    void bisect(const std::vector<double>& centroids, std::vector<double>& keys, std::vector<unsigned int>& order, const std::size_t begin, const std::size_t end, const int firstPart, const int numParts, const PartitionMethod method, const int numThreads);
+    void partitionWithGmsh(const ElementBlock& block, const int numParts);
+
+    int _numParts;
+    std::vector<int> _parts;
+    std::vector<MeshPartition> _partitions;
+};
+
+
+// unit direction to cut order[begin, end) across
+inline void getCutDirection(const std::vector<double>& centroids, const std::vector<unsigned int>& order, const std::size_t begin, const std::size_t end, const PartitionMethod method, double dir[3])
+{
+    double lo[3], hi[3], mean[3] = {0, 0, 0};
+    for(int k = 0; k < 3; k++)
+        lo[k] = hi[k] = centroids[3*order[begin]+k];
+    for(std::size_t i = begin; i < end; i++)
+    {
+        const double* c = &centroids[3*order[i]];
+        for(int k = 0; k < 3; k++)
+        {
+            lo[k] = std::min(lo[k], c[k]);
+            hi[k] = std::max(hi[k], c[k]);
+            mean[k] += c[k];
+        }
+    }
+    int axis = 0;
+    for(int k = 1; k < 3; k++)
+    {
+        if(hi[k] - lo[k] > hi[axis] - lo[axis])
+            axis = k;
+    }
+    for(int k = 0; k < 3; k++)
+        dir[k] = k == axis ? 1 : 0;
+    if(method != PARTITION_INERTIAL)
+        return;
+
+    // principal axis of the covariance of the centroids, by power iteration from the longest box side
+    double cov[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+    for(int k = 0; k < 3; k++)
+        mean[k] /= (double)(end - begin);
+    for(std::size_t i = begin; i < end; i++)
+    {
+        const double* c = &centroids[3*order[i]];
+        const double d[3] = {c[0] - mean[0], c[1] - mean[1], c[2] - mean[2]};
+        for(int r = 0; r < 3; r++)
+            for(int s = 0; s < 3; s++)
+                cov[r][s] += d[r] * d[s];
+    }
+    // a little of every axis so that a start orthogonal to the principal axis still converges
+    double v[3] = {dir[0] + 1e-3, dir[1] + 2e-3, dir[2] + 3e-3};
+    for(int it = 0; it < 64; it++)
+    {
+        double w[3];
+        for(int r = 0; r < 3; r++)
+            w[r] = cov[r][0] * v[0] + cov[r][1] * v[1] + cov[r][2] * v[2];
+        const double norm = std::sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+        if(!(norm > 0))
+            return;
+        const double change = std::fabs(w[0] / norm - v[0]) + std::fabs(w[1] / norm - v[1]) + std::fabs(w[2] / norm - v[2]);
+        for(int r = 0; r < 3; r++)
+            v[r] = w[r] / norm;
+        if(change < 1e-12)
+            break;
+    }
+    for(int k = 0; k < 3; k++)
+        dir[k] = v[k];
+}
+
+inline void MeshPartitioner::bisect(const std::vector<double>& centroids, std::vector<double>& keys, std::vector<unsigned int>& order, const std::size_t begin, const std::size_t end, const int firstPart, const int numParts, const PartitionMethod method, const int numThreads)
+{
+    if(numParts <= 1 || end - begin < 2)
+    {
+        for(std::size_t i = begin; i < end; i++)
+            _parts[order[i]] = firstPart;
+        return;
+    }
+    double dir[3];
+    getCutDirection(centroids, order, begin, end, method, dir);
+    for(std::size_t i = begin; i < end; i++)
+    {
+        const double* c = &centroids[3*order[i]];
+        keys[order[i]] = c[0] * dir[0] + c[1] * dir[1] + c[2] * dir[2];
+    }
+    // the halves get elements in proportion to their number of parts
+    const int left = numParts / 2;
+    const std::size_t split = begin + (std::size_t)((double)(end - begin) * left / numParts);
+    std::nth_element(order.begin() + begin, order.begin() + split, order.begin() + end, [&keys](const unsigned int a, const unsigned int b) {
+        return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+    });
+    if(numThreads > 1 && end - begin > 65536)
+    {
+        std::thread first([&]() {
+            TRACE_SCOPE_ARG("MeshPartitioner::bisect", firstPart);
+            bisect(centroids, keys, order, begin, split, firstPart, left, method, numThreads / 2);
+        });
+        bisect(centroids, keys, order, split, end, firstPart + left, numParts - left, method, numThreads - numThreads / 2);
+        first.join();
+        return;
+    }
+    bisect(centroids, keys, order, begin, split, firstPart, left, method, 1);
+    bisect(centroids, keys, order, split, end, firstPart + left, numParts - left, method, 1);
+}
+
+inline void MeshPartitioner::partitionWithGmsh(const ElementBlock& block, const int numParts)
+{
+    TRACE_CALL(gmsh::model::mesh::partition(numParts));
+    TagIndexMap elementIndex;
+    elementIndex.build(block.getElementTags());
+    const int dim = getElementDim(block.getType());
+    gmsh::vectorpair entities;
+    gmsh::model::getEntities(entities, dim);
+    std::vector<int> partitions, elementTypes;
+    std::vector<std::vector<std::size_t> > elementTags, nodeTags;
+    for(std::size_t i = 0; i < entities.size(); i++)
+    {
+        // the entities of a partitioned model belong to one partition, numbered from 1
+        gmsh::model::getPartitions(entities[i].first, entities[i].second, partitions);
+        if(partitions.size() != 1)
+            continue;
+        gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags, entities[i].first, entities[i].second);
+        const int t = findElementType(elementTypes, block.getType());
+        if(t < 0)
+            continue;
+        for(std::size_t j = 0; j < elementTags[t].size(); j++)
+        {
+            const unsigned int e = elementIndex.find(elementTags[t][j]);
+            if(e != TagIndexMap::npos)
+                _parts[e] = partitions[0] - 1;
+        }
+    }
+    // the model is given back as it was, the element tags do not change
+    TRACE_CALL(gmsh::model::mesh::unpartition());
+}
+
+inline void MeshPartitioner::partition(const MeshData& mesh, const ElementBlock& block, const int numParts, const PartitionMethod method, const int numThreads)
+{
+    TRACE_SCOPE("MeshPartitioner::partition");
+    const std::size_t n = block.size();
+    _numParts = std::max(numParts, 1);
+    _parts.assign(n, 0);
+    _partitions.clear();
+    if(_numParts == 1 || n == 0)
+        return;
+    if(method == PARTITION_GMSH)
+    {
+        partitionWithGmsh(block, _numParts);
+        return;
+    }
+    const int stride = block.getNumNodes(), nv = getElementNumVertices(block.getType()) > 0 ? getElementNumVertices(block.getType()) : stride;
+    const CountedVector<unsigned int>& ids = block.getConnectivity();
+    std::vector<double> centroids(3 * n), keys(n);
+    std::vector<unsigned int> order(n);
+    parallelFor(n, numThreads, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t i = b; i < e; i++)
+        {
+            double c[3] = {0, 0, 0};
+            for(int k = 0; k < nv; k++)
+            {
+                const unsigned int v = ids[stride*i+k];
+                c[0] += mesh.getX(v);
+                c[1] += mesh.getY(v);
+                c[2] += mesh.getZ(v);
+            }
+            for(int k = 0; k < 3; k++)
+                centroids[3*i+k] = c[k] / nv;
+            order[i] = (unsigned int)i;
+        }
+    });
+    bisect(centroids, keys, order, 0, n, 0, _numParts, method, getNumThreads(numThreads));
+}
+
+inline void MeshPartitioner::setParts(const std::vector<int>& parts, const int numParts)
+{
+    _numParts = std::max(numParts, 1);
+    _parts = parts;
+    _partitions.clear();
+}
+
+inline void MeshPartitioner::buildPartitions(const MeshData& mesh, const ElementBlock& block, const int numLayers, const int numThreads)
+{
+    TRACE_SCOPE("MeshPartitioner::buildPartitions");
+    const std::size_t n = block.size(), numNodes = mesh.getNumNodes();
+    const int stride = block.getNumNodes();
+    const CountedVector<unsigned int>& ids = block.getConnectivity();
+
+    // node -> elements (CSR) and the owner of every node, the smallest part among its elements
+    std::vector<std::size_t> nodeOffsets(numNodes + 1, 0);
+    std::vector<int> owner(numNodes, INT_MAX);
+    for(std::size_t i = 0; i < n * stride; i++)
+    {
+        nodeOffsets[ids[i] + 1]++;
+        owner[ids[i]] = std::min(owner[ids[i]], _parts[i / stride]);
+    }
+    for(std::size_t v = 0; v < numNodes; v++)
+        nodeOffsets[v+1] += nodeOffsets[v];
+    std::vector<unsigned int> nodeElements(nodeOffsets[numNodes]);
+    {
+        std::vector<std::size_t> cursor(nodeOffsets.begin(), nodeOffsets.end() - 1);
+        for(std::size_t i = 0; i < n * stride; i++)
+            nodeElements[cursor[ids[i]]++] = (unsigned int)(i / stride);
+    }
+    // part -> owned elements in increasing order
+    std::vector<std::size_t> partOffsets(_numParts + 1, 0);
+    for(std::size_t e = 0; e < n; e++)
+        partOffsets[_parts[e] + 1]++;
+    for(int p = 0; p < _numParts; p++)
+        partOffsets[p+1] += partOffsets[p];
+    std::vector<unsigned int> partElements(n);
+    {
+        std::vector<std::size_t> cursor(partOffsets.begin(), partOffsets.end() - 1);
+        for(std::size_t e = 0; e < n; e++)
+            partElements[cursor[_parts[e]]++] = (unsigned int)e;
+    }
+
+    _partitions.assign(_numParts, MeshPartition());
+    parallelFor((std::size_t)_numParts, numThreads, [&](int, std::size_t b, std::size_t e) {
+        // marks hold the last part that saw an element / node, so they are never cleared
+        std::vector<int> elementMark(n, -1), nodeMark(numNodes, -1);
+        std::vector<unsigned int> local(numNodes), others;
+        for(std::size_t p = b; p < e; p++)
+        {
+            TRACE_SCOPE_ARG("MeshPartitioner::buildPartition", p);
+            const int part = (int)p;
+            MeshPartition& mp = _partitions[p];
+            mp._elements.assign(partElements.begin() + partOffsets[p], partElements.begin() + partOffsets[p+1]);
+            for(std::size_t i = 0; i < mp._elements.size(); i++)
+                elementMark[mp._elements[i]] = part;
+            mp._layerOffsets.assign(1, 0);
+            mp._layerOffsets.push_back(mp._elements.size());
+            for(int l = 0; l < numLayers; l++)
+            {
+                const std::size_t from = mp._layerOffsets[l], to = mp._layerOffsets[l+1];
+                for(std::size_t i = from; i < to; i++)
+                {
+                    const unsigned int* ele = &ids[(std::size_t)stride * mp._elements[i]];
+                    for(int k = 0; k < stride; k++)
+                    {
+                        for(std::size_t j = nodeOffsets[ele[k]]; j < nodeOffsets[ele[k] + 1]; j++)
+                        {
+                            const unsigned int other = nodeElements[j];
+                            if(elementMark[other] == part)
+                                continue;
+                            elementMark[other] = part;
+                            mp._elements.push_back(other);
+                        }
+                    }
+                }
+                std::sort(mp._elements.begin() + to, mp._elements.end());
+                mp._layerOffsets.push_back(mp._elements.size());
+            }
+
+            // owned nodes first in increasing order, then the others by owner, so that every
+            // receive list is one range sorted like the owner's send list
+            mp._nodes.clear();
+            others.clear();
+            for(std::size_t i = 0; i < mp._elements.size(); i++)
+            {
+                const unsigned int* ele = &ids[(std::size_t)stride * mp._elements[i]];
+                for(int k = 0; k < stride; k++)
+                {
+                    if(nodeMark[ele[k]] == part)
+                        continue;
+                    nodeMark[ele[k]] = part;
+                    (owner[ele[k]] == part ? mp._nodes : others).push_back(ele[k]);
+                }
+            }
+            std::sort(mp._nodes.begin(), mp._nodes.end());
+            std::sort(others.begin(), others.end(), [&owner](const unsigned int a, const unsigned int b) {
+                return owner[a] < owner[b] || (owner[a] == owner[b] && a < b);
+            });
+            mp._numOwnedNodes = mp._nodes.size();
+            mp._nodes.insert(mp._nodes.end(), others.begin(), others.end());
+            for(std::size_t i = 0; i < mp._nodes.size(); i++)
+                local[mp._nodes[i]] = (unsigned int)i;
+            mp._connectivity.resize(mp._elements.size() * stride);
+            for(std::size_t i = 0; i < mp._elements.size(); i++)
+            {
+                for(int k = 0; k < stride; k++)
+                    mp._connectivity[i * stride + k] = local[ids[(std::size_t)stride * mp._elements[i] + k]];
+            }
+            for(std::size_t i = mp._numOwnedNodes; i < mp._nodes.size(); i++)
+            {
+                const int q = owner[mp._nodes[i]];
+                if(mp._neighbours.empty() || mp._neighbours.back() != q)
+                {
+                    mp._neighbours.push_back(q);
+                    mp._receive.push_back(std::vector<unsigned int>());
+                }
+                mp._receive.back().push_back((unsigned int)i);
+            }
+        }
+    }, 1);
+
+    // what part q receives from p, p sends to q: the same nodes in the same order, as p's local ids
+    std::vector<std::vector<std::pair<int, std::vector<unsigned int> > > > sends(_numParts);
+    for(int q = 0; q < _numParts; q++)
+    {
+        const MeshPartition& mq = _partitions[q];
+        for(std::size_t k = 0; k < mq._neighbours.size(); k++)
+        {
+            const MeshPartition& mp = _partitions[mq._neighbours[k]];
+            std::vector<unsigned int> list(mq._receive[k].size());
+            for(std::size_t i = 0; i < list.size(); i++)
+            {
+                const unsigned int node = mq._nodes[mq._receive[k][i]];
+                list[i] = (unsigned int)(std::lower_bound(mp._nodes.begin(), mp._nodes.begin() + mp._numOwnedNodes, node) - mp._nodes.begin());
+            }
+            sends[mq._neighbours[k]].push_back(std::make_pair(q, list));
+        }
+    }
+    // neighbours are the parts a part receives from or sends to, both lists in increasing part order
+    for(int p = 0; p < _numParts; p++)
+    {
+        MeshPartition& mp = _partitions[p];
+        std::vector<int> neighbours;
+        std::vector<std::vector<unsigned int> > send, receive;
+        std::size_t r = 0, s = 0;
+        while(r < mp._neighbours.size() || s < sends[p].size())
+        {
+            const int q = s == sends[p].size() || (r < mp._neighbours.size() && mp._neighbours[r] < sends[p][s].first) ? mp._neighbours[r] : sends[p][s].first;
+            neighbours.push_back(q);
+            receive.push_back(r < mp._neighbours.size() && mp._neighbours[r] == q ? mp._receive[r++] : std::vector<unsigned int>());
+            send.push_back(s < sends[p].size() && sends[p][s].first == q ? sends[p][s++].second : std::vector<unsigned int>());
+        }
+        mp._neighbours.swap(neighbours);
+        mp._send.swap(send);
+        mp._receive.swap(receive);
+    }
+}
+
+
+// a facet (edge or triangle) of one element, with its vertices sorted
+struct PartitionFacet
+{
+    unsigned int _a, _b, _c;
+    unsigned int _element;
+    bool sameFacet(const PartitionFacet& f) const {return _a == f._a && _b == f._b && _c == f._c;}
+    bool operator < (const PartitionFacet& f) const
+    {
+        if(_a != f._a)
+            return _a < f._a;
+        if(_b != f._b)
+            return _b < f._b;
+        if(_c != f._c)
+            return _c < f._c;
+        return _element < f._element;
+    }
+};
+
+inline PartitionQuality MeshPartitioner::getQuality(const ElementBlock& block, const int numThreads) const
+{
+    TRACE_SCOPE("MeshPartitioner::getQuality");
+    PartitionQuality quality = {0, 0, 0, 0, 0, 0};
+    const std::size_t n = block.size();
+    if(_numParts == 0)
+        return quality;
+    std::vector<std::size_t> sizes(_numParts, 0);
+    for(std::size_t e = 0; e < n; e++)
+        sizes[_parts[e]]++;
+    quality._minElements = *std::min_element(sizes.begin(), sizes.end());
+    quality._maxElements = *std::max_element(sizes.begin(), sizes.end());
+    quality._imbalance = n > 0 ? (double)quality._maxElements * _numParts / n : 0;
+    for(std::size_t p = 0; p < _partitions.size(); p++)
+    {
+        quality._ghostElements += _partitions[p]._elements.size() - _partitions[p]._layerOffsets[1];
+        quality._ghostNodes += _partitions[p]._nodes.size() - _partitions[p]._numOwnedNodes;
+    }
+
+    // facets of the corner vertices: the edges of 2D elements, the faces of tetrahedra
+    const int dim = getElementDim(block.getType()), nv = getElementNumVertices(block.getType()), stride = block.getNumNodes();
+    if(!((dim == 2 && nv >= 3) || (dim == 3 && nv == 4)))
+        return quality;
+    const CountedVector<unsigned int>& ids = block.getConnectivity();
+    const int numFacets = dim == 2 ? nv : 4;
+    std::vector<PartitionFacet> facets(n * numFacets);
+    parallelFor(n, numThreads, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t i = b; i < e; i++)
+        {
+            const unsigned int* ele = &ids[stride * i];
+            for(int j = 0; j < numFacets; j++)
+            {
+                unsigned int v[3];
+                if(dim == 2)
+                {
+                    v[0] = std::min(ele[j], ele[(j + 1) % nv]);
+                    v[1] = std::max(ele[j], ele[(j + 1) % nv]);
+                    v[2] = UINT_MAX;
+                }
+                else
+                {
+                    for(int k = 0, l = 0; k < 4; k++)
+                    {
+                        if(k != j)
+                            v[l++] = ele[k];
+                    }
+                    if(v[0] > v[1]) std::swap(v[0], v[1]);
+                    if(v[1] > v[2]) std::swap(v[1], v[2]);
+                    if(v[0] > v[1]) std::swap(v[0], v[1]);
+                }
+                PartitionFacet& f = facets[i * numFacets + j];
+                f._a = v[0];
+                f._b = v[1];
+                f._c = v[2];
+                f._element = (unsigned int)i;
+            }
+        }
+    });
+    parallelSort(facets, numThreads);
+    for(std::size_t i = 1; i < facets.size(); i++)
+    {
+        if(facets[i].sameFacet(facets[i-1]) && _parts[facets[i]._element] != _parts[facets[i-1]._element])
+            quality._edgeCut++;
+    }
+    return quality;
+}
+
+inline bool MeshPartitioner::write(const MeshData& mesh, const ElementBlock& block, const std::string& prefix, const int numThreads) const
+{
+    TRACE_SCOPE("MeshPartitioner::write");
+    std::vector<char> ok(_partitions.size(), 0);
+    const CountedVector<std::size_t>& nodeTags = mesh.getNodeTags();
+    const CountedVector<std::size_t>& elementTags = block.getElementTags();
+    parallelFor(_partitions.size(), numThreads, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t p = b; p < e; p++)
+        {
+            TRACE_SCOPE_ARG("MeshPartitioner::writePartition", p);
+            const MeshPartition& mp = _partitions[p];
+            std::vector<std::size_t> localNodeTags(mp._nodes.size()), localElementTags(mp._elements.size());
+            std::vector<double> coord(3 * mp._nodes.size());
+            for(std::size_t i = 0; i < mp._nodes.size(); i++)
+            {
+                localNodeTags[i] = nodeTags[mp._nodes[i]];
+                coord[3*i] = mesh.getX(mp._nodes[i]);
+                coord[3*i+1] = mesh.getY(mp._nodes[i]);
+                coord[3*i+2] = mesh.getZ(mp._nodes[i]);
+            }
+            for(std::size_t i = 0; i < mp._elements.size(); i++)
+                localElementTags[i] = elementTags[mp._elements[i]];
+            MeshData local;
+            local.setNodes(localNodeTags, coord);
+            local.addBlockByIndex(block.getType(), localElementTags, mp._connectivity);
+            const std::string name = prefix + "_" + std::to_string(p);
+            bool good = writeMeshBinary(local, name + ".bin");
+
+            std::ofstream out((name + ".txt").c_str());
+            out<<"part "<<p<<" "<<_partitions.size()<<"\n";
+            out<<"layers "<<mp._layerOffsets.size() - 1;
+            for(std::size_t l = 1; l < mp._layerOffsets.size(); l++)
+                out<<" "<<mp._layerOffsets[l];
+            out<<"\nnodes "<<mp._nodes.size()<<" "<<mp._numOwnedNodes<<"\n";
+            out<<"neighbours "<<mp._neighbours.size()<<"\n";
+            for(std::size_t k = 0; k < mp._neighbours.size(); k++)
+            {
+                out<<"send "<<mp._neighbours[k]<<" "<<mp._send[k].size();
+                for(std::size_t i = 0; i < mp._send[k].size(); i++)
+                    out<<" "<<mp._send[k][i];
+                out<<"\nreceive "<<mp._neighbours[k]<<" "<<mp._receive[k].size();
+                for(std::size_t i = 0; i < mp._receive[k].size(); i++)
+                    out<<" "<<mp._receive[k][i];
+                out<<"\n";
+            }
+            out.close();
+            ok[p] = good && !out.fail();
+        }
+    }, 1);
+    return std::find(ok.begin(), ok.end(), 0) == ok.end();
+}
+
+#endif
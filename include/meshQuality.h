@@ -0,0 +1,404 @@
+#ifndef MESH_QUALITY_H
+#define MESH_QUALITY_H
+
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+#include "elementTypes.h"
+#include "meshData.h"
+#include "parallelSort.h"
+
+
+// quality measures of one element, 1 (or 60 / 70.53 degrees) for the equilateral element
+enum QualityMetric
+{
+    ASPECT_RATIO = 0,       // longest edge over the one of the equilateral element with the same inradius, >= 1
+    MIN_ANGLE = 1,          // smallest corner (triangle) or dihedral (tetrahedron) angle, degrees
+    MAX_ANGLE = 2,          // largest corner or dihedral angle, degrees
+    SCALED_JACOBIAN = 3,    // smallest corner Jacobian over the product of its edge lengths, in [-1, 1], < 0 when inverted
+    EDGE_RATIO = 4          // longest over shortest edge, >= 1
+};
+const int NUM_QUALITY_METRICS = 5;
+
+// true when a larger value of the metric is a worse element
+inline bool isLargerWorse(const int metric)
+{
+    return metric == ASPECT_RATIO || metric == MAX_ANGLE || metric == EDGE_RATIO;
+}
+
+
+/**
+ * Fixed range histogram: numBins equal bins over [lo, hi], values outside the
+ * range go to the first or the last bin.
+ */
+class QualityHistogram
+{
+public:
+    QualityHistogram(const double lo = 0, const double hi = 1, const int numBins = 20) : _lo(lo), _hi(hi), _counts(numBins > 0 ? numBins : 1, 0) {}
+    ~QualityHistogram() {}
+
+    void add(const double value) {_counts[getBin(value)]++;}
+    void merge(const QualityHistogram& h)
+    {
+        for(std::size_t i = 0; i < _counts.size(); i++)
+            _counts[i] += h._counts[i];
+    }
+    int getBin(const double value) const
+    {
+        const int n = (int)_counts.size();
+        if(!(value > _lo))
+            return 0;
+        const int b = (int)((value - _lo) / (_hi - _lo) * n);
+        return b < n ? b : n - 1;
+    }
+    int getNumBins() const {return (int)_counts.size();}
+    double getBinLow(const int i) const {return _lo + (_hi - _lo) * i / _counts.size();}
+    double getBinHigh(const int i) const {return _lo + (_hi - _lo) * (i + 1) / _counts.size();}
+    std::size_t getCount(const int i) const {return _counts[i];}
+
+private:
+    double _lo, _hi;
+    std::vector<std::size_t> _counts;
+};
+
+
+/**
+ * Limits a mesh must meet before it is written, see MeshQuality::check().
+ * The defaults accept every element that is not inverted or degenerate.
+ */
+struct QualityThresholds
+{
+    QualityThresholds() : maxAspectRatio(std::numeric_limits<double>::max()), minAngle(0), maxAngle(180),
+        minScaledJacobian(std::numeric_limits<double>::min()), maxEdgeRatio(std::numeric_limits<double>::max()) {}
+
+    double maxAspectRatio, minAngle, maxAngle, minScaledJacobian, maxEdgeRatio;
+};
+
+
+/**
+ * In-process quality of one triangle or tetrahedron block (only the vertices
+ * of second order elements are used). Elements are computed ELEMENT_BATCH
+ * at a time, coordinates gathered into lane arrays, on several threads;
+ * every thread keeps its own statistics and histograms, merged at the end.
+ *
+ * The values of every metric are kept per element (0-based block ids), so the
+ * worst elements and the elements failing a threshold can be listed.
+ * The sign of a triangle's scaled Jacobian is the sign of its normal along z,
+ * so inverted triangles of a mesh in the xy plane are negative.
+ */
+class MeshQuality
+{
+public:
+    static const int ELEMENT_BATCH = 8;
+
+    MeshQuality() : _values(NUM_QUALITY_METRICS), _min(NUM_QUALITY_METRICS, 0), _max(NUM_QUALITY_METRICS, 0), _mean(NUM_QUALITY_METRICS, 0), _histograms() {}
+    ~MeshQuality() {}
+
+    // false if the block is not made of triangles or tetrahedra
+    bool compute(const MeshData& mesh, const ElementBlock& block, const int numThreads = 0, const int numBins = 20);
+    // the same with the stride known at compile time, Type must be a triangle or a tetrahedron
+    template<int Type> void compute(const MeshData& mesh, const TypedBlockView<Type>& block, const int numThreads = 0, const int numBins = 20);
+
+    std::size_t size() const {return _values[0].size();}
+    const std::vector<double>& getValues(const int metric) const {return _values[metric];}
+    double getMin(const int metric) const {return _min[metric];}
+    double getMax(const int metric) const {return _max[metric];}
+    double getMean(const int metric) const {return _mean[metric];}
+    const QualityHistogram& getHistogram(const int metric) const {return _histograms[metric];}
+    // the count worst elements for metric, worst first
+    void getWorst(const int metric, const std::size_t count, std::vector<unsigned int>& ids) const;
+    // number of elements failing any threshold, their ids are written to failing when it is given
+    std::size_t check(const QualityThresholds& thresholds, std::vector<unsigned int>* failing = 0) const;
+
+private:
+    template<int NumVertices> void computeBatch(const double x[][ELEMENT_BATCH], const double y[][ELEMENT_BATCH], const double z[][ELEMENT_BATCH], double q[][ELEMENT_BATCH]) const;
+
+    std::vector<std::vector<double> > _values;
+    std::vector<double> _min, _max, _mean;
+    std::vector<QualityHistogram> _histograms;
+};
+
+
+// histogram range of every metric
+inline QualityHistogram makeQualityHistogram(const int metric, const int numBins)
+{
+    switch(metric)
+    {
+        case MIN_ANGLE: case MAX_ANGLE: return QualityHistogram(0, 180, numBins);
+        case SCALED_JACOBIAN: return QualityHistogram(-1, 1, numBins);
+        default: return QualityHistogram(1, 10, numBins);
+    }
+}
+
+template<> inline void MeshQuality::computeBatch<3>(const double x[][ELEMENT_BATCH], const double y[][ELEMENT_BATCH], const double z[][ELEMENT_BATCH], double q[][ELEMENT_BATCH]) const
+{
+    const double toDegrees = 180 / 3.14159265358979323846, sqrt3 = std::sqrt(3.0);
+    for(int l = 0; l < ELEMENT_BATCH; l++)
+    {
+        // edge a goes from vertex a to vertex a + 1
+        double ex[3], ey[3], ez[3], len[3];
+        for(int a = 0; a < 3; a++)
+        {
+            const int b = a == 2 ? 0 : a + 1;
+            ex[a] = x[b][l] - x[a][l];
+            ey[a] = y[b][l] - y[a][l];
+            ez[a] = z[b][l] - z[a][l];
+            len[a] = std::sqrt(ex[a] * ex[a] + ey[a] * ey[a] + ez[a] * ez[a]);
+        }
+        // normal e0 x (p2 - p0) = e2 x e0, twice the area
+        const double nx = ey[2] * ez[0] - ez[2] * ey[0], ny = ez[2] * ex[0] - ex[2] * ez[0], nz = ex[2] * ey[0] - ey[2] * ex[0];
+        const double area2 = std::sqrt(nx * nx + ny * ny + nz * nz);
+        const double sign = nz < 0 ? -1 : 1;
+        const double lmin = std::min(len[0], std::min(len[1], len[2])), lmax = std::max(len[0], std::max(len[1], len[2]));
+        double amin = 180, amax = 0, corner = 0;
+        for(int a = 0; a < 3; a++)
+        {
+            // corner a between the edges a and a - 1 reversed
+            const int p = a == 0 ? 2 : a - 1;
+            const double dot = -(ex[a] * ex[p] + ey[a] * ey[p] + ez[a] * ez[p]);
+            const double angle = std::atan2(area2, dot) * toDegrees;
+            amin = std::min(amin, angle);
+            amax = std::max(amax, angle);
+            corner = std::max(corner, len[a] * len[p]);
+        }
+        q[ASPECT_RATIO][l] = lmax * (len[0] + len[1] + len[2]) / (2 * sqrt3 * area2);
+        q[MIN_ANGLE][l] = amin;
+        q[MAX_ANGLE][l] = amax;
+        q[SCALED_JACOBIAN][l] = sign * area2 / corner * 2 / sqrt3;
+        q[EDGE_RATIO][l] = lmax / lmin;
+    }
+}
+
+template<> inline void MeshQuality::computeBatch<4>(const double x[][ELEMENT_BATCH], const double y[][ELEMENT_BATCH], const double z[][ELEMENT_BATCH], double q[][ELEMENT_BATCH]) const
+{
+    static const int edges[6][2] = {{0, 1}, {0, 2}, {0, 3}, {1, 2}, {1, 3}, {2, 3}};
+    // face k is opposite vertex k
+    static const int faces[4][3] = {{1, 2, 3}, {0, 3, 2}, {0, 1, 3}, {0, 2, 1}};
+    const double toDegrees = 180 / 3.14159265358979323846, sqrt2 = std::sqrt(2.0), sqrt6 = std::sqrt(6.0);
+    for(int l = 0; l < ELEMENT_BATCH; l++)
+    {
+        double len[6];
+        for(int a = 0; a < 6; a++)
+        {
+            const double dx = x[edges[a][1]][l] - x[edges[a][0]][l];
+            const double dy = y[edges[a][1]][l] - y[edges[a][0]][l];
+            const double dz = z[edges[a][1]][l] - z[edges[a][0]][l];
+            len[a] = std::sqrt(dx * dx + dy * dy + dz * dz);
+        }
+        const double ax = x[1][l] - x[0][l], ay = y[1][l] - y[0][l], az = z[1][l] - z[0][l];
+        const double bx = x[2][l] - x[0][l], by = y[2][l] - y[0][l], bz = z[2][l] - z[0][l];
+        const double cx = x[3][l] - x[0][l], cy = y[3][l] - y[0][l], cz = z[3][l] - z[0][l];
+        // six times the signed volume, > 0 for the gmsh orientation
+        const double v6 = ax * (by * cz - bz * cy) - ay * (bx * cz - bz * cx) + az * (bx * cy - by * cx);
+
+        // outward face normals (for a positive tetrahedron), their norms are twice the face areas
+        double n[4][3], area2[4], surface2 = 0;
+        for(int k = 0; k < 4; k++)
+        {
+            const int i0 = faces[k][0], i1 = faces[k][1], i2 = faces[k][2];
+            const double ux = x[i1][l] - x[i0][l], uy = y[i1][l] - y[i0][l], uz = z[i1][l] - z[i0][l];
+            const double wx = x[i2][l] - x[i0][l], wy = y[i2][l] - y[i0][l], wz = z[i2][l] - z[i0][l];
+            n[k][0] = uy * wz - uz * wy;
+            n[k][1] = uz * wx - ux * wz;
+            n[k][2] = ux * wy - uy * wx;
+            area2[k] = std::sqrt(n[k][0] * n[k][0] + n[k][1] * n[k][1] + n[k][2] * n[k][2]);
+            surface2 += area2[k];
+        }
+        // dihedral angle along edge (i, j) is pi minus the angle between the normals of the two other faces
+        double amin = 180, amax = 0;
+        for(int a = 0; a < 6; a++)
+        {
+            const int i = edges[a][0], j = edges[a][1];
+            int k = 0;
+            while(k == i || k == j)
+                k++;
+            const int m = 6 - i - j - k;
+            const double c = -(n[k][0] * n[m][0] + n[k][1] * n[m][1] + n[k][2] * n[m][2]) / (area2[k] * area2[m]);
+            const double angle = std::acos(std::max(-1.0, std::min(1.0, c))) * toDegrees;
+            amin = std::min(amin, angle);
+            amax = std::max(amax, angle);
+        }
+        // corner i has the three edges to the other vertices, all corners have |det| = |v6|
+        const double corner[4] = {len[0] * len[1] * len[2], len[0] * len[3] * len[4], len[1] * len[3] * len[5], len[2] * len[4] * len[5]};
+        double jmin = std::numeric_limits<double>::max(), lmin = len[0], lmax = len[0];
+        for(int i = 0; i < 4; i++)
+        {
+            jmin = std::min(jmin, v6 * sqrt2 / corner[i]);
+        }
+        for(int a = 1; a < 6; a++)
+        {
+            lmin = std::min(lmin, len[a]);
+            lmax = std::max(lmax, len[a]);
+        }
+        q[ASPECT_RATIO][l] = lmax * 0.5 * surface2 / (sqrt6 * std::fabs(v6));
+        q[MIN_ANGLE][l] = amin;
+        q[MAX_ANGLE][l] = amax;
+        q[SCALED_JACOBIAN][l] = jmin;
+        q[EDGE_RATIO][l] = lmax / lmin;
+    }
+}
+
+inline bool MeshQuality::compute(const MeshData& mesh, const ElementBlock& block, const int numThreads, const int numBins)
+{
+    switch(block.getType())
+    {
+        case TRIANGLE: compute(mesh, block.view<TRIANGLE>(), numThreads, numBins); return true;
+        case TRIANGLE6: compute(mesh, block.view<TRIANGLE6>(), numThreads, numBins); return true;
+        case TETRAHEDRON: compute(mesh, block.view<TETRAHEDRON>(), numThreads, numBins); return true;
+        case TETRAHEDRON10: compute(mesh, block.view<TETRAHEDRON10>(), numThreads, numBins); return true;
+        default: return false;
+    }
+}
+
+template<int Type> inline void MeshQuality::compute(const MeshData& mesh, const TypedBlockView<Type>& block, const int numThreads, const int numBins)
+{
+    const int k = ElementTraits<Type>::numVertices;
+    static_assert((ElementTraits<Type>::dim == 2 && k == 3) || (ElementTraits<Type>::dim == 3 && k == 4), "MeshQuality needs triangles or tetrahedra");
+    const std::size_t n = block.size();
+    for(int m = 0; m < NUM_QUALITY_METRICS; m++)
+    {
+        _values[m].resize(n);
+    }
+
+    // statistics of every thread
+    const int t = getNumThreads(numThreads);
+    std::vector<std::vector<double> > lo(t, std::vector<double>(NUM_QUALITY_METRICS, std::numeric_limits<double>::max()));
+    std::vector<std::vector<double> > hi(t, std::vector<double>(NUM_QUALITY_METRICS, -std::numeric_limits<double>::max()));
+    std::vector<std::vector<double> > sum(t, std::vector<double>(NUM_QUALITY_METRICS, 0));
+    std::vector<std::vector<QualityHistogram> > histograms(t);
+    for(int i = 0; i < t; i++)
+    {
+        for(int m = 0; m < NUM_QUALITY_METRICS; m++)
+        {
+            histograms[i].push_back(makeQualityHistogram(m, numBins));
+        }
+    }
+
+    parallelFor(n, t, [&](int thread, std::size_t b, std::size_t e) {
+        const int W = ELEMENT_BATCH;
+        double x[4][W], y[4][W], z[4][W], q[NUM_QUALITY_METRICS][W];
+        for(std::size_t s = b; s < e; s += W)
+        {
+            const int count = (int)std::min<std::size_t>(W, e - s);
+            for(int l = 0; l < W; l++)
+            {
+                // a short last batch repeats its first element, the extra lanes are not stored
+                const unsigned int* ele = block.nodes(s + (l < count ? l : 0));
+                for(int a = 0; a < k; a++)
+                {
+                    x[a][l] = mesh.getX(ele[a]);
+                    y[a][l] = mesh.getY(ele[a]);
+                    z[a][l] = mesh.getZ(ele[a]);
+                }
+            }
+            computeBatch<k>(x, y, z, q);
+            for(int m = 0; m < NUM_QUALITY_METRICS; m++)
+            {
+                for(int l = 0; l < count; l++)
+                {
+                    const double v = q[m][l];
+                    _values[m][s+l] = v;
+                    lo[thread][m] = std::min(lo[thread][m], v);
+                    hi[thread][m] = std::max(hi[thread][m], v);
+                    sum[thread][m] += v;
+                    histograms[thread][m].add(v);
+                }
+            }
+        }
+    });
+
+    _histograms.clear();
+    for(int m = 0; m < NUM_QUALITY_METRICS; m++)
+    {
+        _histograms.push_back(makeQualityHistogram(m, numBins));
+        double total = 0;
+        _min[m] = std::numeric_limits<double>::max();
+        _max[m] = -std::numeric_limits<double>::max();
+        for(int i = 0; i < t; i++)
+        {
+            _min[m] = std::min(_min[m], lo[i][m]);
+            _max[m] = std::max(_max[m], hi[i][m]);
+            total += sum[i][m];
+            _histograms[m].merge(histograms[i][m]);
+        }
+        _mean[m] = n > 0 ? total / n : 0;
+        if(n == 0)
+            _min[m] = _max[m] = 0;
+    }
+}
+
+inline void MeshQuality::getWorst(const int metric, const std::size_t count, std::vector<unsigned int>& ids) const
+{
+    const std::vector<double>& v = _values[metric];
+    const bool larger = isLargerWorse(metric);
+    ids.resize(v.size());
+    for(std::size_t i = 0; i < v.size(); i++)
+    {
+        ids[i] = (unsigned int)i;
+    }
+    const std::size_t m = std::min(count, ids.size());
+    // NaN (a degenerate element) is the worst of all
+    std::partial_sort(ids.begin(), ids.begin() + m, ids.end(), [&](unsigned int a, unsigned int b) {
+        if(v[a] != v[a] || v[b] != v[b])
+            return v[a] != v[a] && v[b] == v[b];
+        return larger ? v[a] > v[b] : v[a] < v[b];
+    });
+    ids.resize(m);
+}
+
+inline std::size_t MeshQuality::check(const QualityThresholds& thresholds, std::vector<unsigned int>* failing) const
+{
+    std::size_t count = 0;
+    if(failing)
+        failing->clear();
+    for(std::size_t i = 0; i < size(); i++)
+    {
+        // written so that a NaN fails
+        const bool ok = _values[ASPECT_RATIO][i] <= thresholds.maxAspectRatio
+            && _values[MIN_ANGLE][i] >= thresholds.minAngle
+            && _values[MAX_ANGLE][i] <= thresholds.maxAngle
+            && _values[SCALED_JACOBIAN][i] >= thresholds.minScaledJacobian
+            && _values[EDGE_RATIO][i] <= thresholds.maxEdgeRatio;
+        if(!ok)
+        {
+            count++;
+            if(failing)
+                failing->push_back((unsigned int)i);
+        }
+    }
+    return count;
+}
+
+inline const char* getQualityMetricName(const int metric)
+{
+    static const char* names[NUM_QUALITY_METRICS] = {"aspect ratio", "min angle", "max angle", "scaled Jacobian", "edge ratio"};
+    return names[metric];
+}
+
+// min / mean / max of every metric, the histogram of one metric and its worst elements (gmsh tags)
+inline void printQualityReport(std::ostream& out, const MeshQuality& quality, const ElementBlock& block, const int metric = MIN_ANGLE, const std::size_t numWorst = 5)
+{
+    for(int m = 0; m < NUM_QUALITY_METRICS; m++)
+    {
+        out<<getQualityMetricName(m)<<": min "<<quality.getMin(m)<<", mean "<<quality.getMean(m)<<", max "<<quality.getMax(m)<<"\n";
+    }
+    const QualityHistogram& h = quality.getHistogram(metric);
+    for(int i = 0; i < h.getNumBins(); i++)
+    {
+        if(h.getCount(i) > 0)
+            out<<"  ["<<h.getBinLow(i)<<", "<<h.getBinHigh(i)<<") "<<h.getCount(i)<<"\n";
+    }
+    std::vector<unsigned int> worst;
+    quality.getWorst(metric, numWorst, worst);
+    out<<"worst "<<getQualityMetricName(metric)<<":";
+    for(std::size_t i = 0; i < worst.size(); i++)
+    {
+        out<<" "<<block.getElementTags()[worst[i]]<<" ("<<quality.getValues(metric)[worst[i]]<<")";
+    }
+    out<<std::endl;
+}
+
+#endif
@@ -0,0 +1,358 @@
+#ifndef MESH_REORDER_H
+#define MESH_REORDER_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cstddef>
+#include "elementTypes.h"
+#include "meshData.h"
+#include "parallelSort.h"
+
+
+// node -> node graph of every block of dimension >= 1, two nodes are
+// neighbours when they share an element. Row i is adj[offsets[i] .. offsets[i+1]).
+inline void buildNodeGraph(const MeshData& mesh, std::vector<std::size_t>& offsets, std::vector<unsigned int>& adj)
+{
+    const std::size_t n = mesh.getNumNodes();
+    offsets.assign(n + 1, 0);
+    for(std::size_t b = 0; b < mesh.getNumBlocks(); b++)
+    {
+        const ElementBlock& block = mesh.getBlock(b);
+        const int k = block.getNumNodes();
+        if(getElementDim(block.getType()) < 1)
+            continue;
+        const CountedVector<unsigned int>& ids = block.getConnectivity();
+        for(std::size_t i = 0; i < ids.size(); i++)
+        {
+            offsets[ids[i]+1] += k - 1;
+        }
+    }
+    for(std::size_t i = 0; i < n; i++)
+    {
+        offsets[i+1] += offsets[i];
+    }
+    adj.resize(offsets[n]);
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for(std::size_t b = 0; b < mesh.getNumBlocks(); b++)
+    {
+        const ElementBlock& block = mesh.getBlock(b);
+        const int k = block.getNumNodes();
+        if(getElementDim(block.getType()) < 1)
+            continue;
+        const CountedVector<unsigned int>& ids = block.getConnectivity();
+        for(std::size_t e = 0; e < block.size(); e++)
+        {
+            const unsigned int* ele = &ids[k*e];
+            for(int i = 0; i < k; i++)
+            {
+                for(int j = 0; j < k; j++)
+                {
+                    if(i != j)
+                        adj[cursor[ele[i]]++] = ele[j];
+                }
+            }
+        }
+    }
+    // sort and compact every row in place
+    std::size_t w = 0;
+    for(std::size_t i = 0; i < n; i++)
+    {
+        const std::size_t b = offsets[i], e = offsets[i+1];
+        std::sort(adj.begin() + b, adj.begin() + e);
+        offsets[i] = w;
+        for(std::size_t j = b; j < e; j++)
+        {
+            if(j == b || adj[j] != adj[j-1])
+                adj[w++] = adj[j];
+        }
+    }
+    offsets[n] = w;
+    adj.resize(w);
+}
+
+/**
+ * Reverse Cuthill-McKee order of a node graph, order[newId] = oldId.
+ * Every connected component starts from a pseudo-peripheral node found by
+ * repeated breadth-first searches, neighbours are visited by increasing degree.
+ */
+inline void rcmOrdering(const std::vector<std::size_t>& offsets, const std::vector<unsigned int>& adj, std::vector<unsigned int>& order)
+{
+    const std::size_t n = offsets.size() - 1;
+    order.clear();
+    order.reserve(n);
+    std::vector<char> visited(n, 0);
+    std::vector<int> level(n, -1);
+    std::vector<unsigned int> queue, neighbours;
+    queue.reserve(n);
+    for(std::size_t seed = 0; seed < n; seed++)
+    {
+        if(visited[seed])
+            continue;
+        // pseudo-peripheral node: the smallest degree node of the last level, while the depth grows
+        unsigned int start = (unsigned int)seed;
+        int depth = -1;
+        for(int iter = 0; iter < 8; iter++)
+        {
+            queue.assign(1, start);
+            level[start] = 0;
+            for(std::size_t q = 0; q < queue.size(); q++)
+            {
+                const unsigned int v = queue[q];
+                for(std::size_t j = offsets[v]; j < offsets[v+1]; j++)
+                {
+                    if(level[adj[j]] < 0)
+                    {
+                        level[adj[j]] = level[v] + 1;
+                        queue.push_back(adj[j]);
+                    }
+                }
+            }
+            const int last = level[queue.back()];
+            unsigned int next = queue.back();
+            for(std::size_t q = queue.size(); q-- > 0 && level[queue[q]] == last; )
+            {
+                if(offsets[queue[q]+1] - offsets[queue[q]] < offsets[next+1] - offsets[next])
+                    next = queue[q];
+            }
+            for(std::size_t q = 0; q < queue.size(); q++)
+            {
+                level[queue[q]] = -1;
+            }
+            if(last <= depth)
+                break;
+            depth = last;
+            start = next;
+        }
+
+        // Cuthill-McKee breadth-first search from start
+        const std::size_t first = order.size();
+        order.push_back(start);
+        visited[start] = 1;
+        for(std::size_t q = first; q < order.size(); q++)
+        {
+            const unsigned int v = order[q];
+            neighbours.clear();
+            for(std::size_t j = offsets[v]; j < offsets[v+1]; j++)
+            {
+                if(!visited[adj[j]])
+                {
+                    visited[adj[j]] = 1;
+                    neighbours.push_back(adj[j]);
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end(), [&](unsigned int a, unsigned int b) {
+                return offsets[a+1] - offsets[a] < offsets[b+1] - offsets[b];
+            });
+            order.insert(order.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+}
+
+// position of a point along the curve, coordinates are integers of bits bits in dims dimensions;
+// hilbert = false interleaves the bits as they are (Morton / Z order), otherwise
+// they are first transposed to the Hilbert curve (J. Skilling, AIP Conf. Proc. 707, 2004)
+inline unsigned long long spaceFillingKey(unsigned int X[3], const int dims, const int bits, const bool hilbert)
+{
+    if(hilbert)
+    {
+        const unsigned int M = 1u << (bits - 1);
+        for(unsigned int Q = M; Q > 1; Q >>= 1)
+        {
+            const unsigned int P = Q - 1;
+            for(int i = 0; i < dims; i++)
+            {
+                if(X[i] & Q)
+                {
+                    X[0] ^= P;
+                } else {
+                    const unsigned int t = (X[0] ^ X[i]) & P;
+                    X[0] ^= t;
+                    X[i] ^= t;
+                }
+            }
+        }
+        for(int i = 1; i < dims; i++)
+        {
+            X[i] ^= X[i-1];
+        }
+        unsigned int t = 0;
+        for(unsigned int Q = M; Q > 1; Q >>= 1)
+        {
+            if(X[dims-1] & Q)
+                t ^= Q - 1;
+        }
+        for(int i = 0; i < dims; i++)
+        {
+            X[i] ^= t;
+        }
+    }
+    unsigned long long key = 0;
+    for(int b = bits - 1; b >= 0; b--)
+    {
+        for(int i = 0; i < dims; i++)
+        {
+            key = (key << 1) | ((X[i] >> b) & 1);
+        }
+    }
+    return key;
+}
+
+/**
+ * Order of the elements of one block along a Hilbert (or Morton) curve through
+ * their centroids, order[newId] = oldId. A flat mesh uses the 2D curve.
+ */
+inline void spaceFillingOrdering(const MeshData& mesh, const ElementBlock& block, std::vector<unsigned int>& order, const bool hilbert = true, const int numThreads = 0)
+{
+    double lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+    const CountedVector<double>* xyz[3] = {&mesh.getXs(), &mesh.getYs(), &mesh.getZs()};
+    for(int d = 0; d < 3; d++)
+    {
+        if(mesh.getNumNodes() == 0)
+            break;
+        lo[d] = *std::min_element(xyz[d]->begin(), xyz[d]->end());
+        hi[d] = *std::max_element(xyz[d]->begin(), xyz[d]->end());
+    }
+    // axes with an extent, so a mesh in the plane z = 0 (or x = 0 ...) gets a 2D curve
+    int axes[3], dims = 0;
+    for(int d = 0; d < 3; d++)
+    {
+        if(hi[d] > lo[d])
+            axes[dims++] = d;
+    }
+    // 2^16 cells per axis separate the elements of any mesh we extract, more bits only cost time
+    const int bits = 16;
+    const double cells = (double)((1ULL << bits) - 1);
+
+    const std::size_t n = block.size();
+    const int k = block.getNumNodes();
+    const CountedVector<unsigned int>& ids = block.getConnectivity();
+    std::vector<std::pair<unsigned long long, unsigned int> > keys(n);
+    parallelFor(n, numThreads, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t i = b; i < e; i++)
+        {
+            unsigned int X[3] = {0, 0, 0};
+            for(int a = 0; a < dims; a++)
+            {
+                const CountedVector<double>& c = *xyz[axes[a]];
+                double sum = 0;
+                for(int j = 0; j < k; j++)
+                {
+                    sum += c[ids[k*i+j]];
+                }
+                const double u = (sum / k - lo[axes[a]]) / (hi[axes[a]] - lo[axes[a]]);
+                X[a] = (unsigned int)(u * cells);
+            }
+            keys[i] = std::make_pair(dims > 0 ? spaceFillingKey(X, dims, bits, hilbert) : 0ULL, (unsigned int)i);
+        }
+    });
+    parallelSort(keys, numThreads);
+    order.resize(n);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        order[i] = keys[i].second;
+    }
+}
+
+// half bandwidth max(i - j) and profile sum(i - min j) of the node matrix of all blocks,
+// j runs over the nodes sharing an element with node i
+inline void measureBandwidth(const MeshData& mesh, std::size_t& bandwidth, unsigned long long& profile)
+{
+    const std::size_t n = mesh.getNumNodes();
+    std::vector<unsigned int> rowMin(n);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        rowMin[i] = (unsigned int)i;
+    }
+    for(std::size_t b = 0; b < mesh.getNumBlocks(); b++)
+    {
+        const ElementBlock& block = mesh.getBlock(b);
+        const int k = block.getNumNodes();
+        const CountedVector<unsigned int>& ids = block.getConnectivity();
+        for(std::size_t e = 0; e < block.size(); e++)
+        {
+            const unsigned int* ele = &ids[k*e];
+            const unsigned int m = *std::min_element(ele, ele + k);
+            for(int j = 0; j < k; j++)
+            {
+                rowMin[ele[j]] = std::min(rowMin[ele[j]], m);
+            }
+        }
+    }
+    bandwidth = 0;
+    profile = 0;
+    for(std::size_t i = 0; i < n; i++)
+    {
+        bandwidth = std::max<std::size_t>(bandwidth, i - rowMin[i]);
+        profile += i - rowMin[i];
+    }
+}
+
+
+/**
+ * Renumbering stage run after the extraction: RCM for the nodes, a space
+ * filling curve for the elements of every block.
+ *
+ * The permutations are kept, order[newId] = oldId and rank[oldId] = newId,
+ * so ids computed before the renumbering can be mapped to the new ones.
+ * Node and element tags are moved with their nodes and elements, so
+ * mesh.getNodeTags()[newId] and getElementTags()[newId] still give the gmsh tags.
+ */
+class MeshReorder
+{
+public:
+    MeshReorder() : _nodeOrder(), _nodeRank(), _elementOrders(), _elementRanks() {}
+    ~MeshReorder() {}
+
+    void reorderNodes(MeshData& mesh);
+    void reorderElements(MeshData& mesh, const bool hilbert = true, const int numThreads = 0);
+
+    const std::vector<unsigned int>& getNodeOrder() const {return _nodeOrder;}
+    const std::vector<unsigned int>& getNodeRank() const {return _nodeRank;}
+    // empty for a block that was not reordered
+    const std::vector<unsigned int>& getElementOrder(const std::size_t block) const {return _elementOrders[block];}
+    const std::vector<unsigned int>& getElementRank(const std::size_t block) const {return _elementRanks[block];}
+
+private:
+    static void invert(const std::vector<unsigned int>& order, std::vector<unsigned int>& rank);
+
+    std::vector<unsigned int> _nodeOrder, _nodeRank;
+    std::vector<std::vector<unsigned int> > _elementOrders, _elementRanks;
+};
+
+
+inline void MeshReorder::invert(const std::vector<unsigned int>& order, std::vector<unsigned int>& rank)
+{
+    rank.resize(order.size());
+    for(std::size_t i = 0; i < order.size(); i++)
+    {
+        rank[order[i]] = (unsigned int)i;
+    }
+}
+
+inline void MeshReorder::reorderNodes(MeshData& mesh)
+{
+    std::vector<std::size_t> offsets;
+    std::vector<unsigned int> adj;
+    buildNodeGraph(mesh, offsets, adj);
+    rcmOrdering(offsets, adj, _nodeOrder);
+    invert(_nodeOrder, _nodeRank);
+    mesh.renumberNodes(_nodeOrder);
+}
+
+inline void MeshReorder::reorderElements(MeshData& mesh, const bool hilbert, const int numThreads)
+{
+    _elementOrders.assign(mesh.getNumBlocks(), std::vector<unsigned int>());
+    _elementRanks.assign(mesh.getNumBlocks(), std::vector<unsigned int>());
+    for(std::size_t b = 0; b < mesh.getNumBlocks(); b++)
+    {
+        if(getElementDim(mesh.getBlock(b).getType()) < 1)
+            continue;
+        spaceFillingOrdering(mesh, mesh.getBlock(b), _elementOrders[b], hilbert, numThreads);
+        invert(_elementOrders[b], _elementRanks[b]);
+        mesh.reorderElements(b, _elementOrders[b]);
+    }
+}
+
+#endif
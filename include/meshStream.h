@@ -0,0 +1,385 @@
+#ifndef MESH_STREAM_H
+#define MESH_STREAM_H
+
+#include <gmsh.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+#include "elementTypes.h"
+#include "meshBinary.h"
+#include "trace.h"
+
+
+// receives a mesh entity by entity
+class MeshStreamSink
+{
+public:
+    virtual ~MeshStreamSink() {}
+    // nodes of one entity, they get the ids firstId, firstId + 1, ... in order
+    virtual void addNodes(const int dim, const int tag, const std::size_t firstId, const std::vector<std::size_t>& nodeTags, const std::vector<double>& coord) = 0;
+    // elements of one type of one entity, nodeIds are 0-based ids of nodes added before
+    virtual void addElements(const int dim, const int tag, const int type, const std::vector<std::size_t>& elementTags, const std::vector<unsigned int>& nodeIds) = 0;
+    virtual void finish() {}
+};
+
+
+/**
+ * Extraction of the current gmsh mesh one entity at a time, for meshes too
+ * large to hold twice: getNodes / getElements are called per entity, in
+ * increasing dimension, so the elements of an entity only use nodes that
+ * were already sent. Node tags are renumbered on the fly to 0-based ids in
+ * the order the nodes are sent, through a flat table of getMaxNodeTag() + 1
+ * ids (4 bytes per tag); apart from that table only the arrays of the current
+ * entity are held, so peak memory follows the largest entity and not the
+ * whole mesh.
+ */
+class MeshStreamer
+{
+public:
+    MeshStreamer() : _ids(), _numNodes(0), _numElements(0), _numEntities(0), _maxEntityNodes(0) {}
+    ~MeshStreamer() {}
+
+    // dim < 0 sends every entity; dim >= 0 the elements of dimension dim with the
+    // nodes they use, only those of entity (dim, tag) when tag >= 0
+    void stream(MeshStreamSink& sink, const int dim = -1, const int tag = -1);
+
+    std::size_t getNumNodes() const {return _numNodes;}
+    std::size_t getNumElements() const {return _numElements;}
+    std::size_t getNumEntities() const {return _numEntities;}
+    // nodes of the largest entity, what bounds the memory of a stream
+    std::size_t getMaxEntityNodes() const {return _maxEntityNodes;}
+
+private:
+    void streamEntity(MeshStreamSink& sink, const int dim, const int tag, const bool nodes, const bool elements, const bool includeBoundary);
+
+    std::vector<unsigned int> _ids;
+    std::size_t _numNodes, _numElements, _numEntities, _maxEntityNodes;
+    std::vector<std::size_t> _nodeTags;
+    std::vector<double> _coord, _parametricCoord;
+    std::vector<int> _elementTypes;
+    std::vector<std::vector<std::size_t> > _elementTags, _elementNodeTags;
+    std::vector<unsigned int> _nodeIds;
+};
+
+
+inline void MeshStreamer::streamEntity(MeshStreamSink& sink, const int dim, const int tag, const bool nodes, const bool elements, const bool includeBoundary)
+{
+    TRACE_SCOPE_ARG("MeshStreamer::streamEntity", tag);
+    _numEntities++;
+    if(nodes)
+    {
+        TRACE_CALL(gmsh::model::mesh::getNodes(_nodeTags, _coord, _parametricCoord, dim, tag, includeBoundary, false));
+        // a node can come twice through the boundary, only new ones are sent
+        std::size_t n = 0;
+        for(std::size_t i = 0; i < _nodeTags.size(); i++)
+        {
+            const std::size_t t = _nodeTags[i];
+            if(t >= _ids.size())
+                _ids.resize(t + 1, (unsigned int)-1);
+            if(_ids[t] != (unsigned int)-1)
+                continue;
+            _ids[t] = (unsigned int)(_numNodes + n);
+            _nodeTags[n] = t;
+            for(int k = 0; k < 3; k++)
+                _coord[3*n+k] = _coord[3*i+k];
+            n++;
+        }
+        _nodeTags.resize(n);
+        _coord.resize(3 * n);
+        if(n > 0)
+            sink.addNodes(dim, tag, _numNodes, _nodeTags, _coord);
+        _numNodes += n;
+        _maxEntityNodes = std::max(_maxEntityNodes, n);
+    }
+    if(elements)
+    {
+        TRACE_CALL(gmsh::model::mesh::getElements(_elementTypes, _elementTags, _elementNodeTags, dim, tag));
+        for(std::size_t b = 0; b < _elementTypes.size(); b++)
+        {
+            const std::vector<std::size_t>& nodeTags = _elementNodeTags[b];
+            _nodeIds.resize(nodeTags.size());
+            for(std::size_t i = 0; i < nodeTags.size(); i++)
+            {
+                _nodeIds[i] = nodeTags[i] < _ids.size() ? _ids[nodeTags[i]] : (unsigned int)-1;
+            }
+            sink.addElements(dim, tag, _elementTypes[b], _elementTags[b], _nodeIds);
+            _numElements += _elementTags[b].size();
+        }
+    }
+}
+
+inline void MeshStreamer::stream(MeshStreamSink& sink, const int dim, const int tag)
+{
+    _numNodes = _numElements = _numEntities = _maxEntityNodes = 0;
+    std::size_t maxTag = 0;
+    gmsh::model::mesh::getMaxNodeTag(maxTag);
+    _ids.assign(maxTag + 1, (unsigned int)-1);
+    if(dim >= 0 && tag >= 0)
+    {
+        streamEntity(sink, dim, tag, true, true, true);
+    } else {
+        for(int d = 0; d <= (dim < 0 ? 3 : dim); d++)
+        {
+            gmsh::vectorpair entities;
+            gmsh::model::getEntities(entities, d);
+            for(std::size_t i = 0; i < entities.size(); i++)
+            {
+                streamEntity(sink, d, entities[i].second, true, dim < 0 || d == dim, false);
+            }
+        }
+    }
+    sink.finish();
+    // the arrays of the largest entity are not kept
+    std::vector<unsigned int>().swap(_ids);
+    std::vector<std::size_t>().swap(_nodeTags);
+    std::vector<double>().swap(_coord);
+    std::vector<std::vector<std::size_t> >().swap(_elementTags);
+    std::vector<std::vector<std::size_t> >().swap(_elementNodeTags);
+    std::vector<unsigned int>().swap(_nodeIds);
+}
+
+
+/**
+ * Writes a stream straight to the binary mesh file of meshBinary.h.
+ * The file puts every array in one piece (all node tags, then all x, ...),
+ * so each array is spooled to its own temporary file <filename>.part<k>
+ * through a buffer of budget / 8 bytes and finish() copies the parts into
+ * place and removes them: memory stays within about budget bytes whatever
+ * the mesh size (plus budget / 8 per array beyond 8, for meshes with more
+ * than two element types).
+ */
+class MeshFileSink : public MeshStreamSink
+{
+public:
+    MeshFileSink(const std::string& filename, const std::size_t budget = 64 << 20) : _filename(filename),
+        _bufferSize(std::max<std::size_t>(budget / 8, 1 << 16)), _spools(), _blocks(), _numNodes(0), _error() {}
+    ~MeshFileSink() {removeSpools();}
+
+    void addNodes(const int dim, const int tag, const std::size_t firstId, const std::vector<std::size_t>& nodeTags, const std::vector<double>& coord);
+    void addElements(const int dim, const int tag, const int type, const std::vector<std::size_t>& elementTags, const std::vector<unsigned int>& nodeIds);
+    void finish();
+
+    // empty if the file was written
+    const std::string& getError() const {return _error;}
+
+private:
+    MeshFileSink(const MeshFileSink&);
+    MeshFileSink& operator = (const MeshFileSink&);
+
+    // one array of the file, buffered and spilled to a temporary file
+    struct Spool
+    {
+        std::FILE* _file;
+        std::string _path;
+        std::vector<char> _buffer;
+        uint64_t _size;
+    };
+    // spools 0 .. 3 are the node tags, x, y, z; a block has two, element tags and connectivity
+    struct Block
+    {
+        int _type, _numNodes;
+        uint64_t _numElements;
+        std::size_t _tags, _connectivity;
+    };
+
+    std::size_t addSpool();
+    void append(const std::size_t s, const void* data, const std::size_t size);
+    bool flush(Spool& spool);
+    void removeSpools();
+
+    std::string _filename;
+    std::size_t _bufferSize;
+    std::vector<Spool> _spools;
+    std::vector<Block> _blocks;
+    uint64_t _numNodes;
+    std::string _error;
+};
+
+
+inline std::size_t MeshFileSink::addSpool()
+{
+    Spool spool;
+    spool._path = _filename + ".part" + std::to_string(_spools.size());
+    spool._file = std::fopen(spool._path.c_str(), "w+b");
+    spool._size = 0;
+    if(!spool._file && _error.empty())
+        _error = "can not open " + spool._path;
+    _spools.push_back(spool);
+    return _spools.size() - 1;
+}
+
+inline bool MeshFileSink::flush(Spool& spool)
+{
+    if(!spool._buffer.empty() && (!spool._file || std::fwrite(&spool._buffer[0], 1, spool._buffer.size(), spool._file) != spool._buffer.size()))
+    {
+        if(_error.empty())
+            _error = "can not write " + spool._path;
+        spool._buffer.clear();
+        return false;
+    }
+    spool._buffer.clear();
+    return true;
+}
+
+inline void MeshFileSink::append(const std::size_t s, const void* data, const std::size_t size)
+{
+    Spool& spool = _spools[s];
+    const char* p = (const char*)data;
+    for(std::size_t done = 0; done < size; )
+    {
+        if(spool._buffer.capacity() < _bufferSize)
+            spool._buffer.reserve(_bufferSize);
+        const std::size_t n = std::min(size - done, _bufferSize - spool._buffer.size());
+        spool._buffer.insert(spool._buffer.end(), p + done, p + done + n);
+        done += n;
+        if(spool._buffer.size() == _bufferSize)
+            flush(spool);
+    }
+    spool._size += size;
+}
+
+inline void MeshFileSink::addNodes(const int, const int, const std::size_t, const std::vector<std::size_t>& nodeTags, const std::vector<double>& coord)
+{
+    if(_spools.empty())
+    {
+        for(int k = 0; k < 4; k++)
+            addSpool();
+    }
+    const std::size_t n = nodeTags.size();
+    // the arrays of one entity are small next to the mesh, converted here in one go
+    std::vector<uint64_t> tags64(nodeTags.begin(), nodeTags.end());
+    std::vector<double> c(n);
+    append(0, tags64.empty() ? 0 : &tags64[0], n * sizeof(uint64_t));
+    for(int k = 0; k < 3; k++)
+    {
+        for(std::size_t i = 0; i < n; i++)
+            c[i] = coord[3*i+k];
+        append(1 + k, c.empty() ? 0 : &c[0], n * sizeof(double));
+    }
+    _numNodes += n;
+}
+
+inline void MeshFileSink::addElements(const int, const int, const int type, const std::vector<std::size_t>& elementTags, const std::vector<unsigned int>& nodeIds)
+{
+    if(_spools.empty())
+    {
+        for(int k = 0; k < 4; k++)
+            addSpool();
+    }
+    std::size_t b = 0;
+    while(b < _blocks.size() && _blocks[b]._type != type)
+        b++;
+    if(b == _blocks.size())
+    {
+        Block block;
+        block._type = type;
+        block._numNodes = getElementNumNodes(type);
+        if(block._numNodes == 0 && !elementTags.empty())
+            block._numNodes = (int)(nodeIds.size() / elementTags.size());
+        block._numElements = 0;
+        block._tags = addSpool();
+        block._connectivity = addSpool();
+        _blocks.push_back(block);
+    }
+    std::vector<uint64_t> tags64(elementTags.begin(), elementTags.end());
+    append(_blocks[b]._tags, tags64.empty() ? 0 : &tags64[0], tags64.size() * sizeof(uint64_t));
+    append(_blocks[b]._connectivity, nodeIds.empty() ? 0 : &nodeIds[0], nodeIds.size() * sizeof(uint32_t));
+    _blocks[b]._numElements += elementTags.size();
+}
+
+inline void MeshFileSink::finish()
+{
+    for(std::size_t s = 0; s < _spools.size(); s++)
+    {
+        flush(_spools[s]);
+        std::vector<char>().swap(_spools[s]._buffer);
+    }
+    if(!_error.empty())
+    {
+        removeSpools();
+        return;
+    }
+
+    MeshFileHeader header;
+    std::vector<MeshFileBlock> blocks(_blocks.size());
+    for(std::size_t i = 0; i < blocks.size(); i++)
+    {
+        MeshFileBlock& fb = blocks[i];
+        std::memset(&fb, 0, sizeof(fb));
+        fb.type = _blocks[i]._type;
+        fb.numNodes = _blocks[i]._numNodes;
+        fb.numElements = _blocks[i]._numElements;
+    }
+    layoutMeshFile(_numNodes, header, blocks);
+
+    MeshFileWriter out;
+    if(!out.open(_filename))
+    {
+        _error = "can not open " + _filename;
+        removeSpools();
+        return;
+    }
+    out.write(0, &header, sizeof(header));
+    if(!blocks.empty())
+        out.write(out.tell(), &blocks[0], blocks.size() * sizeof(MeshFileBlock));
+    std::vector<uint64_t> offsets;
+    offsets.push_back(header.nodeTagsOffset);
+    offsets.push_back(header.xOffset);
+    offsets.push_back(header.yOffset);
+    offsets.push_back(header.zOffset);
+    for(std::size_t i = 0; i < blocks.size(); i++)
+    {
+        offsets.push_back(blocks[i].elementTagsOffset);
+        offsets.push_back(blocks[i].connectivityOffset);
+    }
+    // spools in file order: nodes, then every block's tags and connectivity
+    std::vector<std::size_t> order;
+    for(std::size_t s = 0; s < 4 && s < _spools.size(); s++)
+        order.push_back(s);
+    for(std::size_t i = 0; i < _blocks.size(); i++)
+    {
+        order.push_back(_blocks[i]._tags);
+        order.push_back(_blocks[i]._connectivity);
+    }
+    std::vector<char> chunk(_bufferSize);
+    for(std::size_t k = 0; k < order.size(); k++)
+    {
+        Spool& spool = _spools[order[k]];
+        std::rewind(spool._file);
+        out.write(offsets[k], 0, 0);
+        for(uint64_t copied = 0; copied < spool._size; )
+        {
+            const std::size_t n = std::fread(&chunk[0], 1, (std::size_t)std::min<uint64_t>(chunk.size(), spool._size - copied), spool._file);
+            if(n == 0)
+            {
+                _error = "can not read " + spool._path;
+                break;
+            }
+            out.write(out.tell(), &chunk[0], n);
+            copied += n;
+        }
+    }
+    out.write(header.fileSize, 0, 0);
+    if(!out.close() && _error.empty())
+        _error = "can not write " + _filename;
+    removeSpools();
+}
+
+inline void MeshFileSink::removeSpools()
+{
+    for(std::size_t s = 0; s < _spools.size(); s++)
+    {
+        if(_spools[s]._file)
+        {
+            std::fclose(_spools[s]._file);
+            std::remove(_spools[s]._path.c_str());
+        }
+    }
+    _spools.clear();
+}
+
+#endif
@@ -0,0 +1,468 @@
+#ifndef PARALLEL_MESHER_H
+#define PARALLEL_MESHER_H
+
+#include <gmsh.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <stdint.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include "meshData.h"
+#include "phaseTimer.h"
+#include "trace.h"
+
+
+/**
+ * Meshes independent plane surfaces of the current model on several worker
+ * processes and merges them into one conformal mesh.
+ *
+ * 1. the shared curves are meshed once in this process (generate(1))
+ * 2. every worker is a fork with its own gmsh model; for each of its surfaces it
+ *    rebuilds the region as a polygon through the 1D mesh nodes, one
+ *    transfinite 2-node line per boundary segment, and meshes it in 2D
+ * 3. the workers send their nodes and triangles back through a pipe and the
+ *    boundary nodes are matched by their 1D node tag, so regions that share a
+ *    curve share its nodes and the merged mesh has a single node numbering
+ *
+ * Every outer loop is rebuilt counterclockwise and every hole clockwise, so all
+ * merged triangles are counterclockwise in the xy plane; generate() fails otherwise.
+ *
+ * gmsh is not thread safe, which is why the workers are processes and not threads.
+ */
+class ParallelMesher
+{
+public:
+    ParallelMesher(const int numWorkers = 1) : _numWorkers(numWorkers > 0 ? numWorkers : 1), _timer(), _error() {}
+    ~ParallelMesher() {}
+
+    // mesh the plane surfaces into mesh: line block (type 1) of the 1D mesh and triangle block (type 2)
+    bool generate(const std::vector<int>& surfaceTags, MeshData& mesh);
+
+    int getNumWorkers() const {return _numWorkers;}
+    // "curves", "workers" and "merge" wall times of the last generate()
+    const PhaseTimer& getTimer() const {return _timer;}
+    const std::string& getError() const {return _error;}
+
+private:
+    // one surface: its closed boundary loops as ordered 1D node tags, outer loop first
+    struct Region
+    {
+        std::vector<std::vector<std::size_t> > _loops;
+    };
+    // what a worker sends back for one region
+    struct RegionMesh
+    {
+        std::vector<double> _coord;
+        // 1D node tag of every node, 0 for interior nodes
+        std::vector<uint64_t> _boundaryTags;
+        std::vector<uint32_t> _triangles;
+    };
+
+    bool buildRegions(const std::vector<int>& surfaceTags, std::vector<Region>& regions);
+    static void meshRegion(const Region& region, const std::map<std::size_t, std::size_t>& nodeIndex, const std::vector<double>& coord, std::vector<char>& out);
+    static bool readRegion(const std::vector<char>& buffer, std::size_t& pos, RegionMesh& region);
+
+    int _numWorkers;
+    PhaseTimer _timer;
+    std::string _error;
+    // nodes of the 1D mesh
+    std::vector<std::size_t> _curveNodeTags;
+    std::vector<double> _curveCoord;
+    std::map<std::size_t, std::size_t> _curveNodeIndex;
+    std::vector<std::size_t> _curveSegments;
+};
+
+
+inline bool ParallelMesher::buildRegions(const std::vector<int>& surfaceTags, std::vector<Region>& regions)
+{
+    std::vector<double> parametricCoord;
+    gmsh::model::mesh::getNodes(_curveNodeTags, _curveCoord, parametricCoord, 1, -1, true, false);
+    _curveNodeIndex.clear();
+    for(std::size_t i = 0; i < _curveNodeTags.size(); i++)
+    {
+        _curveNodeIndex[_curveNodeTags[i]] = i;
+    }
+
+    // segments of every curve, fetched once even when two regions share the curve
+    std::map<int, std::vector<std::size_t> > curveSegments;
+    std::vector<int> elementTypes;
+    std::vector<std::vector<std::size_t> > elementTags, nodeTags;
+    _curveSegments.clear();
+    regions.resize(surfaceTags.size());
+    for(std::size_t r = 0; r < surfaceTags.size(); r++)
+    {
+        gmsh::vectorpair surface(1, std::make_pair(2, surfaceTags[r])), curves;
+        gmsh::model::getBoundary(surface, curves, false, false, false);
+
+        // undirected node -> two neighbours, every boundary node of a region has exactly two
+        std::map<std::size_t, std::vector<std::size_t> > neighbours;
+        for(std::size_t c = 0; c < curves.size(); c++)
+        {
+            int curve = std::abs(curves[c].second);
+            std::map<int, std::vector<std::size_t> >::iterator iter = curveSegments.find(curve);
+            if(iter == curveSegments.end())
+            {
+                gmsh::model::mesh::getElements(elementTypes, elementTags, nodeTags, 1, curve);
+                std::vector<std::size_t>& segs = curveSegments[curve];
+                for(std::size_t b = 0; b < nodeTags.size(); b++)
+                {
+                    segs.insert(segs.end(), nodeTags[b].begin(), nodeTags[b].end());
+                }
+                _curveSegments.insert(_curveSegments.end(), segs.begin(), segs.end());
+                iter = curveSegments.find(curve);
+            }
+            const std::vector<std::size_t>& segs = iter->second;
+            for(std::size_t k = 0; k + 1 < segs.size(); k += 2)
+            {
+                neighbours[segs[k]].push_back(segs[k+1]);
+                neighbours[segs[k+1]].push_back(segs[k]);
+            }
+        }
+
+        // walk the closed loops
+        Region& region = regions[r];
+        region._loops.clear();
+        std::map<std::size_t, bool> visited;
+        // twice the signed area of every loop, positive when counterclockwise
+        std::vector<double> areas;
+        for(std::map<std::size_t, std::vector<std::size_t> >::const_iterator it = neighbours.begin(); it != neighbours.end(); ++it)
+        {
+            if(visited[it->first])
+                continue;
+            if(it->second.size() != 2)
+            {
+                _error = "surface " + std::to_string(surfaceTags[r]) + " has a boundary node with " + std::to_string(it->second.size()) + " segments";
+                return false;
+            }
+            std::vector<std::size_t> loop;
+            std::size_t prev = it->first, node = it->first;
+            do
+            {
+                visited[node] = true;
+                loop.push_back(node);
+                const std::vector<std::size_t>& n = neighbours[node];
+                std::size_t next = n[0] != prev || loop.size() == 1 ? n[0] : n[1];
+                prev = node;
+                node = next;
+            } while(node != it->first && !visited[node]);
+
+            // the loop with the largest area is the outer boundary
+            double area = 0;
+            for(std::size_t i = 0; i < loop.size(); i++)
+            {
+                std::size_t a = _curveNodeIndex[loop[i]], b = _curveNodeIndex[loop[(i+1)%loop.size()]];
+                area += _curveCoord[3*a]*_curveCoord[3*b+1] - _curveCoord[3*b]*_curveCoord[3*a+1];
+            }
+            region._loops.push_back(loop);
+            areas.push_back(area);
+            if(std::fabs(area) > std::fabs(areas.front()))
+            {
+                std::swap(region._loops.front(), region._loops.back());
+                std::swap(areas.front(), areas.back());
+            }
+        }
+
+        // the walk direction is arbitrary: the outer loop goes counterclockwise and the
+        // holes clockwise, so every region is meshed with the same orientation
+        for(std::size_t l = 0; l < region._loops.size(); l++)
+        {
+            if((l == 0) != (areas[l] > 0))
+                std::reverse(region._loops[l].begin(), region._loops[l].end());
+        }
+    }
+    return true;
+}
+
+inline void ParallelMesher::meshRegion(const Region& region, const std::map<std::size_t, std::size_t>& nodeIndex, const std::vector<double>& coord, std::vector<char>& out)
+{
+    gmsh::model::add("region");
+    std::vector<int> pointTags, planeSurface;
+    std::vector<std::size_t> boundaryTags;
+    for(std::size_t l = 0; l < region._loops.size(); l++)
+    {
+        const std::vector<std::size_t>& loop = region._loops[l];
+        const std::size_t n = loop.size();
+        std::vector<int> points(n), curveLoop(n);
+        for(std::size_t i = 0; i < n; i++)
+        {
+            const double* p = &coord[3*nodeIndex.find(loop[i])->second];
+            const double* q = &coord[3*nodeIndex.find(loop[(i+1)%n])->second];
+            const double* o = &coord[3*nodeIndex.find(loop[(i+n-1)%n])->second];
+            // mesh size from the two neighbouring boundary segments
+            double lc = 0.5*(std::sqrt((q[0]-p[0])*(q[0]-p[0]) + (q[1]-p[1])*(q[1]-p[1]) + (q[2]-p[2])*(q[2]-p[2]))
+                           + std::sqrt((o[0]-p[0])*(o[0]-p[0]) + (o[1]-p[1])*(o[1]-p[1]) + (o[2]-p[2])*(o[2]-p[2])));
+            points[i] = gmsh::model::geo::addPoint(p[0], p[1], p[2], lc);
+            pointTags.push_back(points[i]);
+            boundaryTags.push_back(loop[i]);
+        }
+        for(std::size_t i = 0; i < n; i++)
+        {
+            curveLoop[i] = gmsh::model::geo::addLine(points[i], points[(i+1)%n]);
+            // exactly the two end nodes, so the region boundary is the shared 1D mesh
+            gmsh::model::geo::mesh::setTransfiniteCurve(curveLoop[i], 2);
+        }
+        planeSurface.push_back(gmsh::model::geo::addCurveLoop(curveLoop));
+    }
+    gmsh::model::geo::addPlaneSurface(planeSurface);
+    gmsh::model::geo::synchronize();
+    gmsh::model::mesh::generate(2);
+
+    std::vector<std::size_t> nodeTags, tags;
+    std::vector<double> nodeCoord, parametricCoord, pointCoord;
+    gmsh::model::mesh::getNodes(nodeTags, nodeCoord, parametricCoord, -1, -1, true, false);
+    std::map<std::size_t, uint32_t> local;
+    for(std::size_t i = 0; i < nodeTags.size(); i++)
+    {
+        local[nodeTags[i]] = (uint32_t)i;
+    }
+    std::vector<uint64_t> nodeBoundary(nodeTags.size(), 0);
+    for(std::size_t i = 0; i < pointTags.size(); i++)
+    {
+        gmsh::model::mesh::getNodes(tags, pointCoord, parametricCoord, 0, pointTags[i], false, false);
+        if(!tags.empty())
+            nodeBoundary[local[tags[0]]] = boundaryTags[i];
+    }
+    std::vector<int> elementTypes;
+    std::vector<std::vector<std::size_t> > elementTags, elementNodes;
+    gmsh::model::mesh::getElements(elementTypes, elementTags, elementNodes, 2, -1);
+    std::vector<uint32_t> triangles;
+    for(std::size_t b = 0; b < elementTypes.size(); b++)
+    {
+        if(elementTypes[b] != 2)
+            continue;
+        for(std::size_t i = 0; i < elementNodes[b].size(); i++)
+        {
+            triangles.push_back(local[elementNodes[b][i]]);
+        }
+    }
+    gmsh::model::remove();
+
+    // numNodes, coord, boundary tags, numTriangles, triangles
+    uint64_t numNodes = nodeTags.size(), numTriangles = triangles.size()/3;
+    std::size_t pos = out.size();
+    out.resize(pos + 16 + numNodes*(3*sizeof(double) + sizeof(uint64_t)) + triangles.size()*sizeof(uint32_t));
+    char* p = &out[pos];
+    std::memcpy(p, &numNodes, 8); p += 8;
+    if(numNodes) {std::memcpy(p, &nodeCoord[0], numNodes*3*sizeof(double)); p += numNodes*3*sizeof(double);}
+    if(numNodes) {std::memcpy(p, &nodeBoundary[0], numNodes*sizeof(uint64_t)); p += numNodes*sizeof(uint64_t);}
+    std::memcpy(p, &numTriangles, 8); p += 8;
+    if(numTriangles) std::memcpy(p, &triangles[0], triangles.size()*sizeof(uint32_t));
+}
+
+inline bool ParallelMesher::readRegion(const std::vector<char>& buffer, std::size_t& pos, RegionMesh& region)
+{
+    uint64_t numNodes, numTriangles;
+    if(pos + 8 > buffer.size())
+        return false;
+    std::memcpy(&numNodes, &buffer[pos], 8);
+    pos += 8;
+    if(pos + numNodes*(3*sizeof(double) + sizeof(uint64_t)) + 8 > buffer.size())
+        return false;
+    region._coord.resize(3*numNodes);
+    region._boundaryTags.resize(numNodes);
+    if(numNodes)
+    {
+        std::memcpy(&region._coord[0], &buffer[pos], numNodes*3*sizeof(double));
+        pos += numNodes*3*sizeof(double);
+        std::memcpy(&region._boundaryTags[0], &buffer[pos], numNodes*sizeof(uint64_t));
+        pos += numNodes*sizeof(uint64_t);
+    }
+    std::memcpy(&numTriangles, &buffer[pos], 8);
+    pos += 8;
+    if(pos + numTriangles*3*sizeof(uint32_t) > buffer.size())
+        return false;
+    region._triangles.resize(3*numTriangles);
+    if(numTriangles)
+        std::memcpy(&region._triangles[0], &buffer[pos], numTriangles*3*sizeof(uint32_t));
+    pos += numTriangles*3*sizeof(uint32_t);
+    return true;
+}
+
+inline bool ParallelMesher::generate(const std::vector<int>& surfaceTags, MeshData& mesh)
+{
+    _error.clear();
+    _timer.clear();
+    _timer.start("curves");
+    gmsh::model::mesh::generate(1);
+    std::vector<Region> regions;
+    if(!buildRegions(surfaceTags, regions))
+        return false;
+
+    // largest regions first, dealt round robin so the workers get similar loads
+    std::vector<std::size_t> order(regions.size());
+    std::vector<std::size_t> weight(regions.size(), 0);
+    for(std::size_t r = 0; r < regions.size(); r++)
+    {
+        order[r] = r;
+        for(std::size_t l = 0; l < regions[r]._loops.size(); l++)
+            weight[r] += regions[r]._loops[l].size();
+    }
+    std::stable_sort(order.begin(), order.end(), [&weight](std::size_t a, std::size_t b) {return weight[a] > weight[b];});
+    const int numWorkers = (int)std::min<std::size_t>(_numWorkers, std::max<std::size_t>(regions.size(), 1));
+    std::vector<std::vector<std::size_t> > assigned(numWorkers);
+    for(std::size_t i = 0; i < order.size(); i++)
+    {
+        assigned[i % numWorkers].push_back(order[i]);
+    }
+
+    _timer.start("workers");
+    std::vector<pid_t> pids(numWorkers, -1);
+    std::vector<int> fds(numWorkers, -1);
+    for(int w = 0; w < numWorkers; w++)
+    {
+        int fd[2];
+        if(pipe(fd) != 0)
+        {
+            _error = "pipe failed";
+            break;
+        }
+        pid_t pid = fork();
+        if(pid == 0)
+        {
+            close(fd[0]);
+            gmsh::option::setNumber("General.Terminal", 0);
+            std::vector<char> out;
+            for(std::size_t i = 0; i < assigned[w].size(); i++)
+            {
+                meshRegion(regions[assigned[w][i]], _curveNodeIndex, _curveCoord, out);
+            }
+            std::size_t written = 0;
+            while(written < out.size())
+            {
+                ssize_t n = write(fd[1], &out[written], out.size() - written);
+                if(n <= 0)
+                    _exit(1);
+                written += n;
+            }
+            close(fd[1]);
+            _exit(0);
+        }
+        close(fd[1]);
+        if(pid < 0)
+        {
+            close(fd[0]);
+            _error = "fork failed";
+            break;
+        }
+        pids[w] = pid;
+        fds[w] = fd[0];
+    }
+
+    // drain every pipe as data arrives, a full pipe would stall its worker
+    std::vector<std::vector<char> > buffers(numWorkers);
+    std::vector<char> chunk(1 << 16);
+    int numOpen = 0;
+    for(int w = 0; w < numWorkers; w++)
+        numOpen += fds[w] >= 0;
+    while(numOpen > 0)
+    {
+        std::vector<struct pollfd> polls;
+        std::vector<int> owners;
+        for(int w = 0; w < numWorkers; w++)
+        {
+            if(fds[w] < 0)
+                continue;
+            struct pollfd pfd = {fds[w], POLLIN, 0};
+            polls.push_back(pfd);
+            owners.push_back(w);
+        }
+        // the time the parent waits on its workers
+        if(TRACE_CALL(poll(&polls[0], polls.size(), -1)) < 0)
+            continue;
+        for(std::size_t i = 0; i < polls.size(); i++)
+        {
+            if(!(polls[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            int w = owners[i];
+            ssize_t n = read(fds[w], &chunk[0], chunk.size());
+            if(n > 0)
+            {
+                buffers[w].insert(buffers[w].end(), chunk.begin(), chunk.begin() + n);
+            } else {
+                close(fds[w]);
+                fds[w] = -1;
+                numOpen--;
+            }
+        }
+    }
+    for(int w = 0; w < numWorkers; w++)
+    {
+        int status = 0;
+        if(pids[w] > 0 && (waitpid(pids[w], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) && _error.empty())
+            _error = "worker " + std::to_string(w) + " failed";
+    }
+    if(!_error.empty())
+        return false;
+
+    // merge: the 1D mesh nodes first, then the interior nodes of every region
+    _timer.start("merge");
+    std::vector<double> coord(_curveCoord);
+    std::vector<std::size_t> triangles;
+    for(int w = 0; w < numWorkers; w++)
+    {
+        std::size_t pos = 0;
+        RegionMesh region;
+        for(std::size_t i = 0; i < assigned[w].size(); i++)
+        {
+            if(!readRegion(buffers[w], pos, region))
+            {
+                _error = "truncated result from worker " + std::to_string(w);
+                return false;
+            }
+            std::vector<std::size_t> global(region._boundaryTags.size());
+            for(std::size_t n = 0; n < global.size(); n++)
+            {
+                if(region._boundaryTags[n])
+                {
+                    global[n] = _curveNodeIndex[region._boundaryTags[n]];
+                } else {
+                    global[n] = coord.size()/3;
+                    coord.insert(coord.end(), &region._coord[3*n], &region._coord[3*n] + 3);
+                }
+            }
+            for(std::size_t t = 0; t + 2 < region._triangles.size(); t += 3)
+            {
+                // every region is counterclockwise in the xy plane, an inverted triangle means a broken merge
+                const double* a = &coord[3*global[region._triangles[t]]];
+                const double* b = &coord[3*global[region._triangles[t+1]]];
+                const double* c = &coord[3*global[region._triangles[t+2]]];
+                if(!((b[0]-a[0])*(c[1]-a[1]) - (b[1]-a[1])*(c[0]-a[0]) > 0))
+                {
+                    _error = "region " + std::to_string(assigned[w][i]) + " has a clockwise or flat triangle";
+                    return false;
+                }
+                // 1-based tags, the convention of MeshData::addBlock
+                for(int k = 0; k < 3; k++)
+                    triangles.push_back(global[region._triangles[t+k]] + 1);
+            }
+        }
+        std::vector<char>().swap(buffers[w]);
+    }
+
+    std::vector<std::size_t> nodeTags(coord.size()/3);
+    for(std::size_t i = 0; i < nodeTags.size(); i++)
+        nodeTags[i] = i + 1;
+    std::vector<std::size_t> lines(_curveSegments.size());
+    for(std::size_t i = 0; i < lines.size(); i++)
+        lines[i] = _curveNodeIndex[_curveSegments[i]] + 1;
+    std::vector<std::size_t> lineTags(lines.size()/2), triangleTags(triangles.size()/3);
+    for(std::size_t i = 0; i < lineTags.size(); i++)
+        lineTags[i] = i + 1;
+    for(std::size_t i = 0; i < triangleTags.size(); i++)
+        triangleTags[i] = lineTags.size() + i + 1;
+
+    mesh.clear();
+    mesh.setNodes(nodeTags, coord);
+    mesh.addBlock(1, lineTags, lines);
+    mesh.addBlock(2, triangleTags, triangles);
+    _timer.stop();
+    return true;
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef PARALLEL_SORT_H
+#define PARALLEL_SORT_H
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstddef>
+#include "trace.h"
+
+
+// number of worker threads to use, numThreads <= 0 means one per hardware thread
+inline int getNumThreads(const int numThreads = 0)
+{
+    if(numThreads > 0)
+        return numThreads;
+    int n = (int)std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+// run f(thread, begin, end) on numThreads threads over [0, n) cut in equal ranges,
+// with at least grain items per thread so small loops stay on one thread
+template<class F> void parallelFor(const std::size_t n, const int numThreads, F f, const std::size_t grain = 4096)
+{
+    const int t = (int)std::min<std::size_t>(getNumThreads(numThreads), std::max<std::size_t>(n / (grain > 0 ? grain : 1), 1));
+    if(t == 1)
+    {
+        f(0, (std::size_t)0, n);
+        return;
+    }
+    std::vector<std::thread> threads;
+    for(int i = 0; i < t; i++)
+    {
+        threads.push_back(std::thread([f, i, n, t]() mutable {
+            TRACE_SCOPE_ARG("parallelFor chunk", i);
+            f(i, n * i / t, n * (i + 1) / t);
+        }));
+    }
+    // the caller's wait for the slowest chunk
+    TRACE_SCOPE("parallelFor join");
+    for(int i = 0; i < t; i++)
+    {
+        threads[i].join();
+    }
+}
+
+/**
+ * Sort on several threads: every thread sorts one chunk, then pairs of
+ * neighbouring chunks are merged in parallel rounds.
+ */
+template<class T> void parallelSort(std::vector<T>& values, const int numThreads = 0)
+{
+    const std::size_t n = values.size();
+    int t = (int)std::min<std::size_t>(getNumThreads(numThreads), std::max<std::size_t>(n / 65536, 1));
+    if(t == 1)
+    {
+        std::sort(values.begin(), values.end());
+        return;
+    }
+    std::vector<std::size_t> bounds(t + 1);
+    for(int i = 0; i <= t; i++)
+    {
+        bounds[i] = n * i / t;
+    }
+    typename std::vector<T>::iterator begin = values.begin();
+    parallelFor((std::size_t)t, t, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t i = b; i < e; i++)
+            std::sort(begin + bounds[i], begin + bounds[i+1]);
+    }, 1);
+    for(std::size_t width = 1; width < (std::size_t)t; width *= 2)
+    {
+        std::vector<std::thread> threads;
+        for(std::size_t i = 0; i + width < (std::size_t)t; i += 2 * width)
+        {
+            std::size_t lo = bounds[i], mid = bounds[i + width], hi = bounds[std::min<std::size_t>(i + 2 * width, t)];
+            threads.push_back(std::thread([begin, lo, mid, hi, width]() {
+                TRACE_SCOPE_ARG("parallelSort merge", width);
+                std::inplace_merge(begin + lo, begin + mid, begin + hi);
+            }));
+        }
+        for(std::size_t i = 0; i < threads.size(); i++)
+        {
+            threads[i].join();
+        }
+    }
+}
+
+#endif
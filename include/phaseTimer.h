@@ -0,0 +1,172 @@
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+#include <cstdio>
+#include "memoryUsage.h"
+#include "trace.h"
+
+
+// memory at the end of a phase and its peaks during the phase, in bytes
+struct PhaseMemory
+{
+    std::size_t _resident, _peakResident, _malloc, _counted, _peakCounted;
+};
+
+
+/**
+ * Wall clock time per named pipeline phase.
+ * start() closes the running phase, so a pipeline is timed with one call per
+ * phase boundary. Repeated phases accumulate.
+ *
+ * With setTrackMemory(true) every phase boundary also samples memory: the
+ * resident size, malloc bytes in use and CountingAllocator bytes at the end
+ * of the phase, and the peak resident size and counted bytes during it (the
+ * resident peak is restarted at every start() through /proc/self/clear_refs;
+ * where that is not allowed it is the peak since the start of the process).
+ * Repeated phases keep the last end values and the largest peaks.
+ *
+ * While the tracer is enabled every phase is also a trace event, so the
+ * phases frame the scopes traced inside them.
+ */
+class PhaseTimer
+{
+public:
+    PhaseTimer() : _seconds(), _phases(), _current(), _begin(), _trackMemory(false), _memory(), _traceName(0), _traceBegin(0) {}
+    ~PhaseTimer() {}
+
+    void start(const std::string& phase)
+    {
+        stop();
+        _current = phase;
+        if(_trackMemory)
+        {
+            resetPeakResidentMemory();
+            getHeapCounters().resetPeak();
+        }
+        if(getTracer().isEnabled())
+        {
+            _traceName = getTracer().intern(phase);
+            getTracer().getThreadBuffer();
+            _traceBegin = getTracer().now();
+        }
+        _begin = std::chrono::steady_clock::now();
+    }
+    void stop()
+    {
+        if(_current.empty())
+            return;
+        double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - _begin).count();
+        if(_seconds.find(_current) == _seconds.end())
+            _phases.push_back(_current);
+        _seconds[_current] += s;
+        if(_traceName)
+        {
+            getTracer().record(_traceName, _traceBegin, getTracer().now() - _traceBegin);
+            _traceName = 0;
+        }
+        if(_trackMemory)
+            sampleMemory();
+        _current.clear();
+    }
+    void clear()
+    {
+        _seconds.clear();
+        _phases.clear();
+        _current.clear();
+        _memory.clear();
+    }
+    // sample memory at every phase boundary from now on, a few microseconds each
+    void setTrackMemory(const bool track) {_trackMemory = track;}
+
+    // phases in the order they were first started
+    const std::vector<std::string>& getPhases() const {return _phases;}
+    double getSeconds(const std::string& phase) const
+    {
+        std::map<std::string, double>::const_iterator iter = _seconds.find(phase);
+        return iter == _seconds.end() ? 0 : iter->second;
+    }
+    double getTotalSeconds() const
+    {
+        double total = 0;
+        for(std::map<std::string, double>::const_iterator iter = _seconds.begin(); iter != _seconds.end(); ++iter)
+            total += iter->second;
+        return total;
+    }
+
+    // memory of a phase, zero if it was not tracked
+    PhaseMemory getMemory(const std::string& phase) const
+    {
+        std::map<std::string, PhaseMemory>::const_iterator iter = _memory.find(phase);
+        if(iter != _memory.end())
+            return iter->second;
+        PhaseMemory memory = {0, 0, 0, 0, 0};
+        return memory;
+    }
+
+    // {"geometry": 0.001, "generate": 0.25, ...}
+    void writeJson(std::ostream& out) const
+    {
+        out<<"{";
+        for(std::size_t i = 0; i < _phases.size(); i++)
+        {
+            out<<(i ? ", " : "")<<"\""<<_phases[i]<<"\": "<<getSeconds(_phases[i]);
+        }
+        out<<"}";
+    }
+
+    // {"generate": {"rss": 12.5, "peakRss": 40.1, "malloc": 8.2, "counted": 0.1, "peakCounted": 0.3}, ...} in MB
+    void writeMemoryJson(std::ostream& out) const
+    {
+        out<<"{";
+        for(std::size_t i = 0; i < _phases.size(); i++)
+        {
+            const PhaseMemory m = getMemory(_phases[i]);
+            out<<(i ? ", " : "")<<"\""<<_phases[i]<<"\": {\"rss\": "<<m._resident / 1048576.0<<", \"peakRss\": "<<m._peakResident / 1048576.0
+               <<", \"malloc\": "<<m._malloc / 1048576.0<<", \"counted\": "<<m._counted / 1048576.0<<", \"peakCounted\": "<<m._peakCounted / 1048576.0<<"}";
+        }
+        out<<"}";
+    }
+    // one line per phase: time, then the memory columns in MB
+    void printReport(std::ostream& out) const
+    {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-12s %9s %9s %9s %9s %9s %9s", "phase", "seconds", "rss", "peak rss", "malloc", "counted", "peak cnt");
+        out<<line<<std::endl;
+        for(std::size_t i = 0; i < _phases.size(); i++)
+        {
+            const PhaseMemory m = getMemory(_phases[i]);
+            std::snprintf(line, sizeof(line), "%-12s %9.4f %9.2f %9.2f %9.2f %9.2f %9.2f", _phases[i].c_str(), getSeconds(_phases[i]),
+                m._resident / 1048576.0, m._peakResident / 1048576.0, m._malloc / 1048576.0, m._counted / 1048576.0, m._peakCounted / 1048576.0);
+            out<<line<<std::endl;
+        }
+    }
+
+private:
+    void sampleMemory()
+    {
+        PhaseMemory& m = _memory[_current];
+        const HeapCounters& heap = getHeapCounters();
+        m._resident = getResidentMemory();
+        m._peakResident = std::max(m._peakResident, getPeakResidentMemory());
+        m._malloc = getMallocMemory();
+        m._counted = heap.getLive();
+        m._peakCounted = std::max(m._peakCounted, heap.getPeak());
+    }
+
+    std::map<std::string, double> _seconds;
+    std::vector<std::string> _phases;
+    std::string _current;
+    std::chrono::steady_clock::time_point _begin;
+    bool _trackMemory;
+    std::map<std::string, PhaseMemory> _memory;
+    const char* _traceName;
+    unsigned long long _traceBegin;
+};
+
+#endif
@@ -0,0 +1,399 @@
+#ifndef POINT_LOCATOR_H
+#define POINT_LOCATOR_H
+
+#include <vector>
+#include <utility>
+#include <type_traits>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include "elementTypes.h"
+#include "memoryUsage.h"
+#include "meshData.h"
+#include "faceAdjacency.h"
+#include "parallelSort.h"
+#include "trace.h"
+
+
+/**
+ * Point location in a block of triangles (in the xy plane) or tetrahedra,
+ * without a call to gmsh::model::mesh::getElementsByCoordinates per point.
+ *
+ * The elements are listed in the cells of a uniform grid that their bounding
+ * box overlaps (CSR, about one cell per element), and the inverse of the
+ * affine map of every element is stored, so testing a candidate is a few
+ * multiply-adds. Only the vertices are used, a TRIANGLE6 / TETRAHEDRON10
+ * block is located as its straight sided P1 element.
+ *
+ * With a hint (the element of the previous point) the query first walks from
+ * the hint towards the point, across the face opposite the most negative
+ * barycentric coordinate; points that are close to each other then cost a
+ * few steps. A walk that leaves the mesh (a hole, a concave boundary) or takes
+ * too long falls back to the grid.
+ *
+ * Element ids are 0-based positions in the block. The barycentric coordinates
+ * bary[0..dim] are those of vertex 0..dim, bary[1], bary[2], bary[3] are
+ * gmsh's u, v, w.
+ */
+class PointLocator
+{
+public:
+    PointLocator() : _dim(0), _numElements(0), _inverse(), _neighbours(), _min(), _cellSize(1), _numCells(), _offsets(1, 0), _elements() {}
+    ~PointLocator() {}
+
+    // block must be a TRIANGLE, TRIANGLE6, TETRAHEDRON or TETRAHEDRON10 block of mesh
+    void build(const MeshData& mesh, const ElementBlock& block, const int numThreads = 0);
+    // the same with the stride known at compile time
+    template<int Type> void build(const MeshData& mesh, const TypedBlockView<Type>& block, const int numThreads = 0);
+    void clear() {*this = PointLocator();}
+
+    int getDim() const {return _dim;}
+    std::size_t size() const {return _numElements;}
+    // element containing (x, y, z), -1 if there is none; bary gets dim + 1 values
+    // hint is an element to walk from, -1 for a grid lookup only
+    int locate(const double x, const double y, const double z, double* bary, const int hint = -1) const;
+    // xyz holds (x, y, z) triples; elements gets one id per point (-1 outside),
+    // bary (dim + 1) values per point. Every thread handles a contiguous range
+    // of points and, with walk, walks from its last hit when the point is within
+    // two grid cells of the previous one. Returns the number of points found.
+    std::size_t locate(const std::vector<double>& xyz, std::vector<int>& elements, std::vector<double>& bary,
+        const bool walk = true, const int numThreads = 0) const;
+
+private:
+    // _neighbours of a triangle block (edges) or of a tetrahedron block (faces)
+    template<int Type> void buildNeighbours(const TypedBlockView<Type>& block, const int numThreads, std::integral_constant<int, 2>);
+    template<int Type> void buildNeighbours(const TypedBlockView<Type>& block, const int numThreads, std::integral_constant<int, 3>);
+    // barycentric coordinates of (x, y, z) in element e, returns the smallest one
+    double barycentric(const std::size_t e, const double x, const double y, const double z, double* bary) const;
+    // the element test of a walk or a grid lookup accepts points this far outside
+    static double tolerance() {return 1e-10;}
+    int walk(int e, const double x, const double y, const double z, double* bary) const;
+    int gridLocate(const double x, const double y, const double z, double* bary) const;
+    long long cell(const int k, const double v) const
+    {
+        return std::max(0LL, std::min((long long)_numCells[k] - 1, (long long)std::floor((v - _min[k]) / _cellSize)));
+    }
+
+    int _dim;
+    std::size_t _numElements;
+    // per element: the first vertex, then the rows of the inverse affine map (dim + dim * dim values)
+    CountedVector<double> _inverse;
+    // (dim + 1) per element, the neighbour opposite vertex j, -1 on the boundary
+    CountedVector<int> _neighbours;
+    double _min[3], _cellSize;
+    std::size_t _numCells[3];
+    // elements of cell (i, j, k) are _elements[_offsets[c] .. _offsets[c+1]), c = (k * ny + j) * nx + i
+    CountedVector<std::size_t> _offsets;
+    CountedVector<int> _elements;
+};
+
+
+inline void PointLocator::build(const MeshData& mesh, const ElementBlock& block, const int numThreads)
+{
+    switch(block.getType())
+    {
+        case TRIANGLE: build(mesh, block.view<TRIANGLE>(), numThreads); break;
+        case TRIANGLE6: build(mesh, block.view<TRIANGLE6>(), numThreads); break;
+        case TETRAHEDRON: build(mesh, block.view<TETRAHEDRON>(), numThreads); break;
+        case TETRAHEDRON10: build(mesh, block.view<TETRAHEDRON10>(), numThreads); break;
+        default: clear();
+    }
+}
+
+template<int Type> inline void PointLocator::build(const MeshData& mesh, const TypedBlockView<Type>& block, const int numThreads)
+{
+    static const int dim = ElementTraits<Type>::dim;
+    static_assert((dim == 2 && ElementTraits<Type>::numVertices == 3) || (dim == 3 && ElementTraits<Type>::numVertices == 4), "PointLocator needs triangles or tetrahedra");
+    TRACE_SCOPE("PointLocator::build");
+    clear();
+    _dim = dim;
+    const std::size_t n = _numElements = block.size();
+    const int nv = dim + 1, ni = dim + dim * dim;
+    const CountedVector<double>& xs = mesh.getXs();
+    const CountedVector<double>& ys = mesh.getYs();
+    const CountedVector<double>& zs = mesh.getZs();
+
+    // inverse affine maps: bary[1..dim] = A^-1 (p - p0)
+    _inverse.resize(n * ni);
+    parallelFor(n, numThreads, [&](int, std::size_t b, std::size_t e) {
+        for(std::size_t i = b; i < e; i++)
+        {
+            const unsigned int* ele = block.nodes(i);
+            double* inv = &_inverse[ni*i];
+            if(dim == 2)
+            {
+                const double x0 = xs[ele[0]], y0 = ys[ele[0]];
+                const double a = xs[ele[1]] - x0, b = xs[ele[2]] - x0, c = ys[ele[1]] - y0, d = ys[ele[2]] - y0;
+                const double det = a * d - b * c, r = det != 0 ? 1 / det : 0;
+                inv[0] = x0;
+                inv[1] = y0;
+                inv[2] = d * r;
+                inv[3] = -b * r;
+                inv[4] = -c * r;
+                inv[5] = a * r;
+            }
+            else
+            {
+                const double x0 = xs[ele[0]], y0 = ys[ele[0]], z0 = zs[ele[0]];
+                double m[3][3];
+                for(int k = 0; k < 3; k++)
+                {
+                    m[0][k] = xs[ele[k+1]] - x0;
+                    m[1][k] = ys[ele[k+1]] - y0;
+                    m[2][k] = zs[ele[k+1]] - z0;
+                }
+                const double c00 = m[1][1] * m[2][2] - m[1][2] * m[2][1], c01 = m[1][2] * m[2][0] - m[1][0] * m[2][2], c02 = m[1][0] * m[2][1] - m[1][1] * m[2][0];
+                const double det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02, r = det != 0 ? 1 / det : 0;
+                inv[0] = x0;
+                inv[1] = y0;
+                inv[2] = z0;
+                inv[3] = c00 * r;
+                inv[4] = (m[0][2] * m[2][1] - m[0][1] * m[2][2]) * r;
+                inv[5] = (m[0][1] * m[1][2] - m[0][2] * m[1][1]) * r;
+                inv[6] = c01 * r;
+                inv[7] = (m[0][0] * m[2][2] - m[0][2] * m[2][0]) * r;
+                inv[8] = (m[0][2] * m[1][0] - m[0][0] * m[1][2]) * r;
+                inv[9] = c02 * r;
+                inv[10] = (m[0][1] * m[2][0] - m[0][0] * m[2][1]) * r;
+                inv[11] = (m[0][0] * m[1][1] - m[0][1] * m[1][0]) * r;
+            }
+        }
+    });
+
+    // neighbours across the face opposite every vertex
+    _neighbours.assign(n * nv, -1);
+    buildNeighbours(block, numThreads, std::integral_constant<int, dim>());
+
+    if(n == 0)
+        return;
+    // grid over the bounding box, about one cell per element
+    double max[3];
+    for(int k = 0; k < 3; k++)
+    {
+        const CountedVector<double>& c = k == 0 ? xs : (k == 1 ? ys : zs);
+        _min[k] = max[k] = c[block.node(0, 0)];
+        for(std::size_t i = 0; i < n; i++)
+        {
+            for(int j = 0; j < nv; j++)
+            {
+                _min[k] = std::min(_min[k], c[block.node(i, j)]);
+                max[k] = std::max(max[k], c[block.node(i, j)]);
+            }
+        }
+    }
+    double volume = 1;
+    for(int k = 0; k < dim; k++)
+    {
+        volume *= max[k] - _min[k];
+    }
+    _cellSize = std::pow(volume / n, 1.0 / dim);
+    if(!(_cellSize > 0))
+        _cellSize = std::max(max[0] - _min[0], std::max(max[1] - _min[1], max[2] - _min[2])) / n;
+    if(!(_cellSize > 0))
+        _cellSize = 1;
+    for(int k = 0; k < 3; k++)
+    {
+        _numCells[k] = k < dim ? (std::size_t)((max[k] - _min[k]) / _cellSize) + 1 : 1;
+    }
+    const std::size_t numCells = _numCells[0] * _numCells[1] * _numCells[2];
+    _offsets.assign(numCells + 1, 0);
+    std::vector<std::size_t> cursor;
+    for(int pass = 0; pass < 2; pass++)
+    {
+        if(pass == 1)
+        {
+            for(std::size_t c = 0; c < numCells; c++)
+            {
+                _offsets[c+1] += _offsets[c];
+            }
+            _elements.resize(_offsets[numCells]);
+            cursor.assign(_offsets.begin(), _offsets.end() - 1);
+        }
+        for(std::size_t i = 0; i < n; i++)
+        {
+            const unsigned int* ele = block.nodes(i);
+            long long lo[3] = {0, 0, 0}, hi[3] = {0, 0, 0};
+            for(int k = 0; k < dim; k++)
+            {
+                const CountedVector<double>& c = k == 0 ? xs : (k == 1 ? ys : zs);
+                double a = c[ele[0]], b = a;
+                for(int j = 1; j < nv; j++)
+                {
+                    a = std::min(a, c[ele[j]]);
+                    b = std::max(b, c[ele[j]]);
+                }
+                lo[k] = cell(k, a);
+                hi[k] = cell(k, b);
+            }
+            for(long long ck = lo[2]; ck <= hi[2]; ck++)
+            {
+                for(long long cj = lo[1]; cj <= hi[1]; cj++)
+                {
+                    for(long long ci = lo[0]; ci <= hi[0]; ci++)
+                    {
+                        const std::size_t c = (ck * _numCells[1] + cj) * _numCells[0] + ci;
+                        if(pass == 0)
+                            _offsets[c+1]++;
+                        else
+                            _elements[cursor[c]++] = (int)i;
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<int Type> inline void PointLocator::buildNeighbours(const TypedBlockView<Type>& block, const int numThreads, std::integral_constant<int, 2>)
+{
+    // (sorted edge, 3 * element + opposite vertex), equal neighbours after the sort are one edge
+    const std::size_t n = block.size();
+    std::vector<std::pair<unsigned long long, unsigned int> > edges(3 * n);
+    for(std::size_t i = 0; i < n; i++)
+    {
+        const unsigned int* ele = block.nodes(i);
+        for(int j = 0; j < 3; j++)
+        {
+            const unsigned long long a = ele[(j+1)%3], b = ele[(j+2)%3];
+            edges[3*i+j] = std::make_pair(a < b ? (a << 32) | b : (b << 32) | a, (unsigned int)(3 * i + j));
+        }
+    }
+    parallelSort(edges, numThreads);
+    for(std::size_t k = 0; k + 1 < edges.size(); k++)
+    {
+        if(edges[k].first == edges[k+1].first)
+        {
+            _neighbours[edges[k].second] = (int)(edges[k+1].second / 3);
+            _neighbours[edges[k+1].second] = (int)(edges[k].second / 3);
+            k++;
+        }
+    }
+}
+
+template<int Type> inline void PointLocator::buildNeighbours(const TypedBlockView<Type>& block, const int numThreads, std::integral_constant<int, 3>)
+{
+    FaceAdjacency faces;
+    faces.build(block, numThreads);
+    for(std::size_t i = 0; i < block.size(); i++)
+    {
+        for(int j = 0; j < 4; j++)
+            _neighbours[4*i+j] = faces.getNeighbour(i, j);
+    }
+}
+
+inline double PointLocator::barycentric(const std::size_t e, const double x, const double y, const double z, double* bary) const
+{
+    if(_dim == 2)
+    {
+        const double* inv = &_inverse[6*e];
+        const double dx = x - inv[0], dy = y - inv[1];
+        bary[1] = inv[2] * dx + inv[3] * dy;
+        bary[2] = inv[4] * dx + inv[5] * dy;
+        bary[0] = 1 - bary[1] - bary[2];
+        return std::min(bary[0], std::min(bary[1], bary[2]));
+    }
+    const double* inv = &_inverse[12*e];
+    const double dx = x - inv[0], dy = y - inv[1], dz = z - inv[2];
+    bary[1] = inv[3] * dx + inv[4] * dy + inv[5] * dz;
+    bary[2] = inv[6] * dx + inv[7] * dy + inv[8] * dz;
+    bary[3] = inv[9] * dx + inv[10] * dy + inv[11] * dz;
+    bary[0] = 1 - bary[1] - bary[2] - bary[3];
+    return std::min(std::min(bary[0], bary[1]), std::min(bary[2], bary[3]));
+}
+
+inline int PointLocator::walk(int e, const double x, const double y, const double z, double* bary) const
+{
+    const int nv = _dim + 1;
+    // a walk that goes on for long is most likely going around a hole
+    for(int step = 0; step < 64; step++)
+    {
+        if(barycentric(e, x, y, z, bary) >= -tolerance())
+            return e;
+        int j = 0;
+        for(int k = 1; k < nv; k++)
+        {
+            if(bary[k] < bary[j])
+                j = k;
+        }
+        e = _neighbours[nv*e+j];
+        if(e < 0)
+            return -1;
+    }
+    return -1;
+}
+
+inline int PointLocator::gridLocate(const double x, const double y, const double z, double* bary) const
+{
+    const double p[3] = {x, y, z};
+    std::size_t c = 0;
+    for(int k = _dim - 1; k >= 0; k--)
+    {
+        const double v = (p[k] - _min[k]) / _cellSize;
+        if(v < -tolerance() || v > _numCells[k] + tolerance())
+            return -1;
+        c = c * _numCells[k] + cell(k, p[k]);
+    }
+    for(std::size_t q = _offsets[c]; q < _offsets[c+1]; q++)
+    {
+        if(barycentric(_elements[q], x, y, z, bary) >= -tolerance())
+            return _elements[q];
+    }
+    return -1;
+}
+
+inline int PointLocator::locate(const double x, const double y, const double z, double* bary, const int hint) const
+{
+    if(_numElements == 0)
+        return -1;
+    if(hint >= 0)
+    {
+        const int e = walk(hint, x, y, z, bary);
+        if(e >= 0)
+            return e;
+    }
+    return gridLocate(x, y, z, bary);
+}
+
+inline std::size_t PointLocator::locate(const std::vector<double>& xyz, std::vector<int>& elements, std::vector<double>& bary,
+    const bool walk, const int numThreads) const
+{
+    const std::size_t n = xyz.size() / 3;
+    const int nv = _dim + 1;
+    elements.resize(n);
+    bary.resize(n * nv);
+    std::vector<std::size_t> found(getNumThreads(numThreads), 0);
+    parallelFor(n, numThreads, [&](int t, std::size_t b, std::size_t e) {
+        int last = -1;
+        std::size_t count = 0;
+        for(std::size_t i = b; i < e; i++)
+        {
+            // a walk is only worth it for a point next to the previous one
+            int hint = -1;
+            if(walk && last >= 0)
+            {
+                double d2 = 0;
+                for(int k = 0; k < _dim; k++)
+                {
+                    d2 += (xyz[3*i+k] - xyz[3*i+k-3]) * (xyz[3*i+k] - xyz[3*i+k-3]);
+                }
+                if(d2 <= 4 * _cellSize * _cellSize)
+                    hint = last;
+            }
+            const int ele = locate(xyz[3*i], xyz[3*i+1], xyz[3*i+2], &bary[nv*i], hint);
+            elements[i] = ele;
+            if(ele >= 0)
+            {
+                last = ele;
+                count++;
+            }
+        }
+        found[t] = count;
+    }, 1024);
+    std::size_t total = 0;
+    for(std::size_t t = 0; t < found.size(); t++)
+    {
+        total += found[t];
+    }
+    return total;
+}
+
+#endif
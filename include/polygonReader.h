@@ -0,0 +1,309 @@
+#ifndef POLYGON_READER_H
+#define POLYGON_READER_H
+
+#include <gmsh.h>
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+#include <cstdlib>
+#include <cstddef>
+#include "vertexWelder.h"
+
+
+/**
+ * Polygon file, one polygon with its holes per line (WKT-like):
+ *
+ *   # comment
+ *   name, POLYGON((x y [z], x y [z], ...), (hole x y [z], ...), ...)
+ *
+ * The first ring is the outer boundary, the others are holes. The name is
+ * optional, z defaults to 0, and a ring may repeat its first point at the end.
+ */
+class PolygonRecord
+{
+public:
+    PolygonRecord() : _name(), _rings(), _numRings(0) {}
+    ~PolygonRecord() {}
+    const std::string& getName() const {return _name;}
+    std::size_t getNumRings() const {return _numRings;}
+    // ring coordinates (x1, y1, z1, .....), ring 0 is the outer boundary
+    const std::vector<double>& getRing(const std::size_t i) const {return _rings[i];}
+
+    void setName(const std::string& name) {_name = name;}
+    // rings keep their capacity, so a reused record does not allocate again
+    void clear() {_name.clear(); _numRings = 0;}
+    std::vector<double>& addRing()
+    {
+        if(_numRings == _rings.size())
+            _rings.push_back(std::vector<double>());
+        _rings[_numRings].clear();
+        return _rings[_numRings++];
+    }
+
+private:
+    std::string _name;
+    std::vector<std::vector<double> > _rings;
+    std::size_t _numRings;
+};
+
+
+// receives the polygons of a file batch by batch
+class PolygonSink
+{
+public:
+    virtual ~PolygonSink() {}
+    virtual void addBatch(const std::vector<PolygonRecord>& batch, const std::size_t size) = 0;
+};
+
+
+/**
+ * Reads a polygon file one line at a time, only the current line and the
+ * current batch are held in memory.
+ */
+class PolygonReader
+{
+public:
+    PolygonReader() : _in(), _line(), _lineNumber(0), _numPolygons(0), _error() {}
+    ~PolygonReader() {}
+
+    bool open(const std::string& filename)
+    {
+        _in.open(filename.c_str());
+        _lineNumber = 0;
+        _numPolygons = 0;
+        _error.clear();
+        if(!_in.good())
+            _error = "can not open " + filename;
+        return _in.good();
+    }
+    // next polygon, false at the end of the file or on a syntax error (see getError)
+    bool next(PolygonRecord& polygon);
+    // read the whole file in batches of batchSize polygons, returns the number of polygons
+    std::size_t stream(PolygonSink& sink, const std::size_t batchSize = 1024);
+
+    std::size_t getLineNumber() const {return _lineNumber;}
+    std::size_t getNumPolygons() const {return _numPolygons;}
+    const std::string& getError() const {return _error;}
+
+private:
+    bool parse(const char* p, PolygonRecord& polygon);
+    static const char* skip(const char* p)
+    {
+        while(*p == ' ' || *p == '\t' || *p == '\r')
+            p++;
+        return p;
+    }
+    bool fail(const std::string& message)
+    {
+        _error = "line " + std::to_string(_lineNumber) + ": " + message;
+        return false;
+    }
+
+    std::ifstream _in;
+    std::string _line;
+    std::size_t _lineNumber, _numPolygons;
+    std::string _error;
+};
+
+
+inline bool PolygonReader::next(PolygonRecord& polygon)
+{
+    while(_error.empty() && std::getline(_in, _line))
+    {
+        _lineNumber++;
+        const char* p = skip(_line.c_str());
+        if(*p == 0 || *p == '#')
+            continue;
+        if(!parse(p, polygon))
+            return false;
+        _numPolygons++;
+        return true;
+    }
+    return false;
+}
+
+inline bool PolygonReader::parse(const char* line, PolygonRecord& polygon)
+{
+    polygon.clear();
+    std::size_t pos = _line.find("POLYGON", line - _line.c_str());
+    if(pos == std::string::npos)
+        return fail("POLYGON expected");
+
+    // optional name before the comma
+    std::string name(line, _line.c_str() + pos);
+    std::size_t end = name.find_last_not_of(" \t,");
+    name = end == std::string::npos ? "" : name.substr(0, end + 1);
+    polygon.setName(name.empty() ? "poly_" + std::to_string(_numPolygons + 1) : name);
+
+    const char* p = skip(_line.c_str() + pos + 7);
+    if(*p++ != '(')
+        return fail("'(' expected after POLYGON");
+    while(true)
+    {
+        p = skip(p);
+        if(*p++ != '(')
+            return fail("'(' expected at ring start");
+        std::vector<double>& ring = polygon.addRing();
+        while(true)
+        {
+            char* q;
+            double xyz[3] = {0, 0, 0};
+            for(int k = 0; k < 3; k++)
+            {
+                xyz[k] = std::strtod(p, &q);
+                if(q == p)
+                {
+                    if(k < 2)
+                        return fail("coordinate expected");
+                    break;
+                }
+                p = q;
+            }
+            ring.push_back(xyz[0]);
+            ring.push_back(xyz[1]);
+            ring.push_back(xyz[2]);
+            p = skip(p);
+            if(*p == ',')
+            {
+                p++;
+                continue;
+            }
+            if(*p++ != ')')
+                return fail("',' or ')' expected in ring");
+            break;
+        }
+        // WKT closes the ring by repeating the first point
+        const std::size_t n = ring.size();
+        if(n >= 6 && ring[0] == ring[n-3] && ring[1] == ring[n-2] && ring[2] == ring[n-1])
+            ring.resize(n - 3);
+        if(ring.size() < 9)
+            return fail("a ring needs at least three points");
+
+        p = skip(p);
+        if(*p == ',')
+        {
+            p++;
+            continue;
+        }
+        if(*p != ')')
+            return fail("',' or ')' expected after ring");
+        return true;
+    }
+}
+
+inline std::size_t PolygonReader::stream(PolygonSink& sink, const std::size_t batchSize)
+{
+    std::vector<PolygonRecord> batch(batchSize > 0 ? batchSize : 1);
+    std::size_t size = 0, total = 0;
+    while(next(batch[size]))
+    {
+        if(++size == batch.size())
+        {
+            sink.addBatch(batch, size);
+            total += size;
+            size = 0;
+        }
+    }
+    if(size > 0)
+    {
+        sink.addBatch(batch, size);
+        total += size;
+    }
+    return total;
+}
+
+
+/**
+ * Pushes polygons into the built-in CAD kernel: addPoint / addLine /
+ * addCurveLoop / addPlaneSurface. Vertices and lines shared by several
+ * polygons are created once. finish() synchronizes once for the whole input
+ * and adds one physical surface per polygon name.
+ */
+class GmshPolygonSink : public PolygonSink
+{
+public:
+    GmshPolygonSink(const double lc, const double weldEps = 1e-9) : _lc(lc), _points(weldEps), _lines(), _pointTags(), _names(), _surfaceTags() {}
+    ~GmshPolygonSink() {}
+
+    void addBatch(const std::vector<PolygonRecord>& batch, const std::size_t size);
+    void finish();
+
+    std::size_t getNumPolygons() const {return _surfaceTags.size();}
+    std::size_t getNumPoints() const {return _points.size();}
+    std::size_t getNumLines() const {return _lines.size();}
+    // one plane surface per polygon, in file order
+    const std::vector<int>& getSurfaceTags() const {return _surfaceTags;}
+
+private:
+    double _lc;
+    VertexWelder _points;
+    EdgeTable _lines;
+    // welder id -> gmsh point tag
+    std::vector<int> _pointTags;
+    // polygon name -> plane surface tags
+    std::map<std::string, std::vector<int> > _names;
+    std::vector<int> _surfaceTags;
+};
+
+
+inline void GmshPolygonSink::addBatch(const std::vector<PolygonRecord>& batch, const std::size_t size)
+{
+    std::vector<int> loop, curveLoop, planeSurface;
+    for(std::size_t i = 0; i < size; i++)
+    {
+        const PolygonRecord& poly = batch[i];
+        planeSurface.clear();
+        for(std::size_t r = 0; r < poly.getNumRings(); r++)
+        {
+            const std::vector<double>& ring = poly.getRing(r);
+            loop.clear();
+            for(std::size_t j = 0; j < ring.size(); j += 3)
+            {
+                bool isNew;
+                int id = _points.insert(ring[j], ring[j+1], ring[j+2], &isNew);
+                if(isNew)
+                    _pointTags.push_back(gmsh::model::geo::addPoint(ring[j], ring[j+1], ring[j+2], _lc));
+                loop.push_back(_pointTags[id]);
+            }
+            curveLoop.clear();
+            for(std::size_t j = 0; j < loop.size(); j++)
+            {
+                int l1 = loop[j];
+                int l2 = j == loop.size()-1 ? loop[0] : loop[j+1];
+                // two consecutive vertices welded into one point, not an edge
+                if(l1 == l2)
+                    continue;
+                int line = _lines.find(l1, l2);
+                if(line == 0)
+                {
+                    line = gmsh::model::geo::addLine(l1, l2);
+                    _lines.insert(l1, l2, line);
+                }
+                curveLoop.push_back(line);
+            }
+            // a ring welded down to fewer than three edges encloses nothing
+            if(curveLoop.size() >= 3)
+                planeSurface.push_back(gmsh::model::geo::addCurveLoop(curveLoop));
+            else if(r == 0)
+                break;
+        }
+        if(planeSurface.empty())
+            continue;
+        _surfaceTags.push_back(gmsh::model::geo::addPlaneSurface(planeSurface));
+        _names[poly.getName()].push_back(_surfaceTags.back());
+    }
+}
+
+inline void GmshPolygonSink::finish()
+{
+    gmsh::model::geo::synchronize();
+    int dim = 2;
+    for(std::map<std::string, std::vector<int> >::const_iterator iter = _names.begin(); iter != _names.end(); ++iter)
+    {
+        int tag = gmsh::model::addPhysicalGroup(dim, iter->second);
+        gmsh::model::setPhysicalName(dim, tag, iter->first);
+    }
+}
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef REGION_INTERFACES_H
+#define REGION_INTERFACES_H
+
+#include <gmsh.h>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <algorithm>
+#include <ostream>
+#include <cstddef>
+#include "boundaryLoops.h"
+#include "elementTypes.h"
+#include "meshAdjacency.h"
+#include "meshData.h"
+#include "memoryUsage.h"
+#include "trace.h"
+
+
+/**
+ * Interfaces between the regions of a 2D mesh, for domain decomposition.
+ *
+ * Every element has a region (a surface, a physical group, a partition). One
+ * pass over the element edges with a shared edge table finds the edges whose
+ * two elements are in different regions; they are grouped by region pair and
+ * every group is walked into ordered chains with BoundaryLoops, so the
+ * interface nodes come in the order an exchange along the interface needs.
+ *
+ * Interface i is between getRegionA(i) < getRegionB(i). Its segments go the way
+ * the edge goes in the element of region A, so with counterclockwise elements
+ * (gmsh plane surfaces) region A is on the left of every chain. For segment s,
+ * getElementA / getElementB are the elements on either side, as positions in
+ * the element list the interfaces were built from. No coordinate is looked at.
+ */
+class RegionInterfaces
+{
+public:
+    RegionInterfaces() : _interfaces(), _elementTags() {}
+    ~RegionInterfaces() {}
+
+    // one region (>= 0) per element of block (first and second order triangles and quads)
+    void build(const MeshData& mesh, const ElementBlock& block, const std::vector<int>& regions);
+    // the 2D elements of every surface, the region of surfaceTags[i] is i
+    void buildForSurfaces(const MeshData& mesh, const std::vector<int>& surfaceTags);
+    void clear()
+    {
+        _interfaces.clear();
+        _elementTags.clear();
+    }
+
+    // number of region pairs that share at least one edge
+    std::size_t size() const {return _interfaces.size();}
+    int getRegionA(const std::size_t i) const {return _interfaces[i]._regionA;}
+    int getRegionB(const std::size_t i) const {return _interfaces[i]._regionB;}
+    // interface between two regions in any order, -1 if they do not touch
+    int find(const int a, const int b) const;
+
+    // chains of interface i, more than one when the regions touch in several places
+    std::size_t getNumChains(const std::size_t i) const {return _interfaces[i]._closed.size();}
+    bool isClosed(const std::size_t i, const std::size_t c) const {return _interfaces[i]._closed[c] != 0;}
+    // nodes of chain c, in order
+    std::size_t getNumNodes(const std::size_t i, const std::size_t c) const {return _interfaces[i]._nodeOffsets[c+1] - _interfaces[i]._nodeOffsets[c];}
+    unsigned int getNode(const std::size_t i, const std::size_t c, const std::size_t k) const {return _interfaces[i]._nodes[_interfaces[i]._nodeOffsets[c] + k];}
+    // segments of every chain one after the other, segment s of chain c is getFirstSegment(i, c) + s
+    std::size_t getNumSegments(const std::size_t i) const {return _interfaces[i]._elementsA.size();}
+    std::size_t getFirstSegment(const std::size_t i, const std::size_t c) const {return _interfaces[i]._segmentOffsets[c];}
+    int getElementA(const std::size_t i, const std::size_t s) const {return _interfaces[i]._elementsA[s];}
+    int getElementB(const std::size_t i, const std::size_t s) const {return _interfaces[i]._elementsB[s];}
+    // every node of interface i once, chains one after the other (a closed chain does not repeat its first node)
+    const std::vector<unsigned int>& getNodes(const std::size_t i) const {return _interfaces[i]._nodes;}
+    // gmsh tag of an element id
+    std::size_t getElementTag(const int element) const {return _elementTags[element];}
+
+    // "interface regionA regionB numChains numSegments", then per chain "chain numNodes closed" and
+    // one line "nodeTag nodeTag elementTagA elementTagB" per segment, with gmsh tags
+    void write(std::ostream& out, const MeshData& mesh) const;
+
+private:
+    struct Interface
+    {
+        int _regionA, _regionB;
+        std::vector<std::size_t> _nodeOffsets, _segmentOffsets;
+        std::vector<unsigned int> _nodes;
+        std::vector<char> _closed;
+        std::vector<int> _elementsA, _elementsB;
+    };
+
+    void build(const MeshData& mesh, const CountedVector<unsigned int>& ids, const int stride, const int numVertices, const std::vector<int>& regions);
+
+    std::vector<Interface> _interfaces;
+    std::vector<std::size_t> _elementTags;
+};
+
+
+inline void RegionInterfaces::build(const MeshData& mesh, const ElementBlock& block, const std::vector<int>& regions)
+{
+    clear();
+    _elementTags.assign(block.getElementTags().begin(), block.getElementTags().end());
+    build(mesh, block.getConnectivity(), block.getNumNodes(), getElementNumVertices(block.getType()), regions);
+}
+
+inline void RegionInterfaces::buildForSurfaces(const MeshData& mesh, const std::vector<int>& surfaceTags)
+{
+    clear();
+    // triangles and quads of every surface in one list of four vertices per element,
+    // a triangle repeats its last vertex and the zero length edge is skipped
+    std::vector<std::vector<std::size_t> > tags, nodeTags;
+    std::vector<int> elementTypes, regions;
+    std::vector<std::size_t> elementNodes;
+    for(std::size_t i = 0; i < surfaceTags.size(); i++)
+    {
+        TRACE_CALL(gmsh::model::mesh::getElements(elementTypes, tags, nodeTags, 2, surfaceTags[i]));
+        for(std::size_t t = 0; t < elementTypes.size(); t++)
+        {
+            const int numNodes = getElementNumNodes(elementTypes[t]), nv = getElementNumVertices(elementTypes[t]);
+            if(getElementDim(elementTypes[t]) != 2 || nv < 3)
+                continue;
+            for(std::size_t j = 0; j < tags[t].size(); j++)
+            {
+                _elementTags.push_back(tags[t][j]);
+                regions.push_back((int)i);
+                for(int k = 0; k < 4; k++)
+                    elementNodes.push_back(nodeTags[t][j * numNodes + std::min(k, nv - 1)]);
+            }
+        }
+    }
+    CountedVector<unsigned int> ids;
+    mesh.getNodeIndex().map(elementNodes, ids);
+    build(mesh, ids, 4, 4, regions);
+}
+
+inline void RegionInterfaces::build(const MeshData& mesh, const CountedVector<unsigned int>& ids, const int stride, const int numVertices, const std::vector<int>& regions)
+{
+    TRACE_SCOPE("RegionInterfaces::build");
+    const std::size_t n = regions.size();
+    // edge -> the element side that saw it first (element * 4 + local edge)
+    typedef std::unordered_map<EdgeKey, unsigned int, EdgeKeyHash, std::equal_to<EdgeKey>, CountingAllocator<std::pair<const EdgeKey, unsigned int> > > EdgeMap;
+    EdgeMap edges;
+    edges.reserve(n * numVertices / 2 + 16);
+    // interface edges per region pair: two node ids as region A's element goes, and the two elements
+    std::unordered_map<EdgeKey, std::size_t, EdgeKeyHash> pairs;
+    std::vector<std::vector<unsigned int> > segments;
+    std::vector<std::vector<int> > sides;
+    for(std::size_t e = 0; e < n; e++)
+    {
+        const unsigned int* ele = &ids[e * stride];
+        for(int k = 0; k < numVertices; k++)
+        {
+            const unsigned int a = ele[k], b = ele[k + 1 < numVertices ? k + 1 : 0];
+            if(a == b)
+                continue;
+            std::pair<EdgeMap::iterator, bool> found = edges.insert(std::make_pair(EdgeKey(a, b), (unsigned int)(4 * e + k)));
+            if(found.second)
+                continue;
+            const std::size_t other = found.first->second / 4;
+            if(regions[other] == regions[e])
+                continue;
+            // the edge as the element of the smaller region goes
+            const bool mine = regions[e] < regions[other];
+            const std::size_t elementA = mine ? e : other, elementB = mine ? other : e;
+            const int localA = mine ? k : (int)(found.first->second % 4);
+            const unsigned int* eleA = &ids[elementA * stride];
+            const EdgeKey pair(regions[elementA], regions[elementB]);
+            std::unordered_map<EdgeKey, std::size_t, EdgeKeyHash>::iterator p = pairs.find(pair);
+            if(p == pairs.end())
+            {
+                p = pairs.insert(std::make_pair(pair, segments.size())).first;
+                segments.push_back(std::vector<unsigned int>());
+                sides.push_back(std::vector<int>());
+            }
+            segments[p->second].push_back(eleA[localA]);
+            segments[p->second].push_back(eleA[localA + 1 < numVertices ? localA + 1 : 0]);
+            sides[p->second].push_back((int)elementA);
+            sides[p->second].push_back((int)elementB);
+        }
+    }
+
+    // region pairs in increasing order, every pair walked into ordered chains
+    std::vector<std::pair<EdgeKey, std::size_t> > order(pairs.begin(), pairs.end());
+    std::sort(order.begin(), order.end(), [](const std::pair<EdgeKey, std::size_t>& x, const std::pair<EdgeKey, std::size_t>& y) {return x.first < y.first;});
+    _interfaces.resize(order.size());
+    BoundaryLoops loops;
+    const std::vector<std::size_t> noTags;
+    for(std::size_t i = 0; i < order.size(); i++)
+    {
+        Interface& f = _interfaces[i];
+        const std::size_t p = order[i].second;
+        f._regionA = (int)order[i].first.getFirst();
+        f._regionB = (int)order[i].first.getSecond();
+        loops.build(mesh, segments[p], noTags, LOOP_MESH);
+        f._nodeOffsets.assign(1, 0);
+        f._segmentOffsets.assign(1, 0);
+        for(std::size_t c = 0; c < loops.size(); c++)
+        {
+            for(std::size_t k = 0; k < loops.getNumNodes(c); k++)
+            {
+                f._nodes.push_back(loops.getNode(c, k));
+            }
+            for(std::size_t s = 0; s < loops.getNumSegments(c); s++)
+            {
+                const unsigned int segment = loops.getSegment(c, s);
+                f._elementsA.push_back(sides[p][2*segment]);
+                f._elementsB.push_back(sides[p][2*segment+1]);
+            }
+            f._closed.push_back(loops.isClosed(c) ? 1 : 0);
+            f._nodeOffsets.push_back(f._nodes.size());
+            f._segmentOffsets.push_back(f._elementsA.size());
+        }
+    }
+}
+
+inline int RegionInterfaces::find(const int a, const int b) const
+{
+    const int lo = std::min(a, b), hi = std::max(a, b);
+    for(std::size_t i = 0; i < _interfaces.size(); i++)
+    {
+        if(_interfaces[i]._regionA == lo && _interfaces[i]._regionB == hi)
+            return (int)i;
+    }
+    return -1;
+}
+
+inline void RegionInterfaces::write(std::ostream& out, const MeshData& mesh) const
+{
+    const CountedVector<std::size_t>& nodeTags = mesh.getNodeTags();
+    for(std::size_t i = 0; i < size(); i++)
+    {
+        out<<"interface "<<getRegionA(i)<<" "<<getRegionB(i)<<" "<<getNumChains(i)<<" "<<getNumSegments(i)<<"\n";
+        for(std::size_t c = 0; c < getNumChains(i); c++)
+        {
+            const std::size_t numNodes = getNumNodes(i, c), first = getFirstSegment(i, c);
+            out<<"chain "<<numNodes<<" "<<(isClosed(i, c) ? 1 : 0)<<"\n";
+            for(std::size_t s = first; s < getFirstSegment(i, c + 1); s++)
+            {
+                const std::size_t k = s - first;
+                out<<nodeTags[getNode(i, c, k)]<<" "<<nodeTags[getNode(i, c, k + 1 < numNodes ? k + 1 : 0)]<<" "
+                   <<getElementTag(getElementA(i, s))<<" "<<getElementTag(getElementB(i, s))<<"\n";
+            }
+        }
+    }
+}
+
+#endif
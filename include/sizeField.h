@@ -0,0 +1,296 @@
+#ifndef SIZE_FIELD_H
+#define SIZE_FIELD_H
+
+#include <gmsh.h>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstddef>
+
+
+/**
+ * Uniform grid over a set of segments in the xy plane, for distance queries.
+ *
+ * The grid covers the bounding box of the segments with about one cell per
+ * segment; every segment is listed in the cells its bounding box overlaps
+ * (CSR, built once). A query searches rings of cells around the point's cell
+ * and stops as soon as the best distance is below the distance to the next
+ * ring, so it touches a handful of cells whatever the number of segments.
+ */
+class SegmentIndex
+{
+public:
+    SegmentIndex() : _x0(), _y0(), _x1(), _y1(), _minX(0), _minY(0), _cellSize(1), _nx(0), _ny(0), _offsets(1, 0), _segments() {}
+    ~SegmentIndex() {}
+
+    void addSegment(const double x0, const double y0, const double x1, const double y1)
+    {
+        _x0.push_back(x0);
+        _y0.push_back(y0);
+        _x1.push_back(x1);
+        _y1.push_back(y1);
+    }
+    // (x, y) pairs of a polyline, closed adds the segment from the last point to the first
+    void addPolyline(const std::vector<double>& xy, const bool closed);
+    // call after the last addSegment()
+    void build();
+    void clear() {*this = SegmentIndex();}
+
+    std::size_t size() const {return _x0.size();}
+    // distance from (x, y) to the nearest segment, infinity if there is none;
+    // the search stops beyond maxDistance, a result above maxDistance then only
+    // says that the nearest segment is farther than maxDistance
+    double distance(const double x, const double y, const double maxDistance = std::numeric_limits<double>::infinity()) const;
+    // the same by looking at every segment, for reference
+    double distanceBruteForce(const double x, const double y) const;
+
+private:
+    double segmentDistance2(const std::size_t s, const double x, const double y) const
+    {
+        const double dx = _x1[s] - _x0[s], dy = _y1[s] - _y0[s];
+        const double len2 = dx * dx + dy * dy;
+        double t = len2 > 0 ? ((x - _x0[s]) * dx + (y - _y0[s]) * dy) / len2 : 0;
+        t = std::max(0.0, std::min(1.0, t));
+        const double ex = _x0[s] + t * dx - x, ey = _y0[s] + t * dy - y;
+        return ex * ex + ey * ey;
+    }
+    long long cellX(const double x) const {return std::max(0LL, std::min((long long)_nx - 1, (long long)std::floor((x - _minX) / _cellSize)));}
+    long long cellY(const double y) const {return std::max(0LL, std::min((long long)_ny - 1, (long long)std::floor((y - _minY) / _cellSize)));}
+
+    std::vector<double> _x0, _y0, _x1, _y1;
+    double _minX, _minY, _cellSize;
+    std::size_t _nx, _ny;
+    // segments of cell (i, j) are _segments[_offsets[j * _nx + i] .. _offsets[j * _nx + i + 1])
+    std::vector<std::size_t> _offsets;
+    std::vector<unsigned int> _segments;
+};
+
+
+inline void SegmentIndex::addPolyline(const std::vector<double>& xy, const bool closed)
+{
+    const std::size_t n = xy.size() / 2;
+    for(std::size_t i = 0; i + 1 < n; i++)
+    {
+        addSegment(xy[2*i], xy[2*i+1], xy[2*i+2], xy[2*i+3]);
+    }
+    if(closed && n > 2)
+        addSegment(xy[2*n-2], xy[2*n-1], xy[0], xy[1]);
+}
+
+inline void SegmentIndex::build()
+{
+    const std::size_t n = _x0.size();
+    if(n == 0)
+    {
+        _nx = _ny = 0;
+        _offsets.assign(1, 0);
+        _segments.clear();
+        return;
+    }
+    double maxX, maxY, length = 0;
+    _minX = maxX = _x0[0];
+    _minY = maxY = _y0[0];
+    for(std::size_t s = 0; s < n; s++)
+    {
+        _minX = std::min(_minX, std::min(_x0[s], _x1[s]));
+        _minY = std::min(_minY, std::min(_y0[s], _y1[s]));
+        maxX = std::max(maxX, std::max(_x0[s], _x1[s]));
+        maxY = std::max(maxY, std::max(_y0[s], _y1[s]));
+        length += std::sqrt((_x1[s] - _x0[s]) * (_x1[s] - _x0[s]) + (_y1[s] - _y0[s]) * (_y1[s] - _y0[s]));
+    }
+    // about one cell per segment, never smaller than the mean segment length
+    const double w = maxX - _minX, h = maxY - _minY;
+    _cellSize = w * h > 0 ? std::sqrt(w * h / n) : std::max(w, h) / n;
+    _cellSize = std::max(_cellSize, length / n);
+    if(!(_cellSize > 0))
+        _cellSize = 1;
+    _nx = (std::size_t)(w / _cellSize) + 1;
+    _ny = (std::size_t)(h / _cellSize) + 1;
+
+    _offsets.assign(_nx * _ny + 1, 0);
+    for(int pass = 0; pass < 2; pass++)
+    {
+        std::vector<std::size_t> cursor;
+        if(pass == 1)
+        {
+            for(std::size_t c = 0; c < _nx * _ny; c++)
+            {
+                _offsets[c+1] += _offsets[c];
+            }
+            _segments.resize(_offsets[_nx * _ny]);
+            cursor.assign(_offsets.begin(), _offsets.end() - 1);
+        }
+        for(std::size_t s = 0; s < n; s++)
+        {
+            const long long i0 = cellX(std::min(_x0[s], _x1[s])), i1 = cellX(std::max(_x0[s], _x1[s]));
+            const long long j0 = cellY(std::min(_y0[s], _y1[s])), j1 = cellY(std::max(_y0[s], _y1[s]));
+            for(long long j = j0; j <= j1; j++)
+            {
+                for(long long i = i0; i <= i1; i++)
+                {
+                    if(pass == 0)
+                        _offsets[j*_nx+i+1]++;
+                    else
+                        _segments[cursor[j*_nx+i]++] = (unsigned int)s;
+                }
+            }
+        }
+    }
+}
+
+inline double SegmentIndex::distance(const double x, const double y, const double maxDistance) const
+{
+    if(_nx == 0)
+        return std::numeric_limits<double>::infinity();
+    const long long ci = cellX(x), cj = cellY(y);
+    const long long maxRing = (long long)std::max(_nx, _ny);
+    double best2 = std::numeric_limits<double>::infinity();
+    for(long long r = 0; r <= maxRing; r++)
+    {
+        // every cell outside the rings searched so far is at least r cells away
+        const double bound = r > 0 ? (r - 1) * _cellSize : 0;
+        if(best2 <= bound * bound || bound > maxDistance)
+            break;
+        for(long long j = cj - r; j <= cj + r; j++)
+        {
+            if(j < 0 || j >= (long long)_ny)
+                continue;
+            // the first and last rows of the ring are full, the others only have their two ends
+            const long long step = (j == cj - r || j == cj + r) ? 1 : std::max(2 * r, 1LL);
+            for(long long i = ci - r; i <= ci + r; i += step)
+            {
+                if(i < 0 || i >= (long long)_nx)
+                    continue;
+                const std::size_t c = j * _nx + i;
+                for(std::size_t p = _offsets[c]; p < _offsets[c+1]; p++)
+                {
+                    best2 = std::min(best2, segmentDistance2(_segments[p], x, y));
+                }
+            }
+        }
+    }
+    return std::sqrt(best2);
+}
+
+inline double SegmentIndex::distanceBruteForce(const double x, const double y) const
+{
+    double best2 = std::numeric_limits<double>::infinity();
+    for(std::size_t s = 0; s < _x0.size(); s++)
+    {
+        best2 = std::min(best2, segmentDistance2(s, x, y));
+    }
+    return std::sqrt(best2);
+}
+
+
+/**
+ * Mesh size from the distance to feature curves (holes, boundaries, user
+ * curves), in the xy plane. Every feature is a threshold like gmsh's
+ * Threshold field: sizeMin closer than distMin, sizeMax farther than distMax,
+ * linear in between. The size at a point is the smallest over the features,
+ * and defaultSize where no feature asks for less.
+ *
+ * registerCallback() hands evaluate() to gmsh::model::mesh::setSizeCallback;
+ * gmsh may call it from several threads, the call count and latency are
+ * atomic counters. With Mesh.MeshSizeFromPoints and
+ * Mesh.MeshSizeExtendFromBoundary set to 0 the field alone sets the size.
+ */
+class SizeField
+{
+public:
+    SizeField(const double defaultSize = 1) : _defaultSize(defaultSize), _features(), _calls(0), _nanoseconds(0), _maxNanoseconds(0) {}
+    ~SizeField() {}
+
+    // a new feature, returns its id for addPolyline()
+    int addFeature(const double sizeMin, const double sizeMax, const double distMin, const double distMax);
+    // (x, y) pairs of a curve of feature, closed for a hole or a boundary loop
+    void addPolyline(const int feature, const std::vector<double>& xy, const bool closed) {_features[feature]._index.addPolyline(xy, closed);}
+    // build the index of every feature, once all the curves are added
+    void build();
+
+    double evaluate(const double x, const double y) const;
+    // setSizeCallback() with evaluate(), timed
+    void registerCallback();
+
+    std::size_t getNumFeatures() const {return _features.size();}
+    const SegmentIndex& getIndex(const int feature) const {return _features[feature]._index;}
+    unsigned long long getNumCalls() const {return _calls;}
+    double getMeanLatency() const {return _calls > 0 ? (double)_nanoseconds / _calls : 0;}
+    double getMaxLatency() const {return (double)_maxNanoseconds;}
+    void resetStats() {_calls = 0; _nanoseconds = 0; _maxNanoseconds = 0;}
+
+private:
+    SizeField(const SizeField&);
+    SizeField& operator = (const SizeField&);
+
+    struct Feature
+    {
+        double _sizeMin, _sizeMax, _distMin, _distMax;
+        SegmentIndex _index;
+    };
+
+    double _defaultSize;
+    std::vector<Feature> _features;
+    std::atomic<unsigned long long> _calls, _nanoseconds, _maxNanoseconds;
+};
+
+
+inline int SizeField::addFeature(const double sizeMin, const double sizeMax, const double distMin, const double distMax)
+{
+    Feature f;
+    f._sizeMin = sizeMin;
+    f._sizeMax = sizeMax;
+    f._distMin = distMin;
+    f._distMax = distMax;
+    _features.push_back(f);
+    return (int)_features.size() - 1;
+}
+
+inline void SizeField::build()
+{
+    for(std::size_t i = 0; i < _features.size(); i++)
+    {
+        _features[i]._index.build();
+    }
+}
+
+inline double SizeField::evaluate(const double x, const double y) const
+{
+    double size = _defaultSize;
+    for(std::size_t i = 0; i < _features.size(); i++)
+    {
+        const Feature& f = _features[i];
+        // no point in looking for the distance if this feature can not get below size
+        if(f._sizeMin >= size)
+            continue;
+        const double d = f._index.distance(x, y, f._distMax);
+        double s;
+        if(d <= f._distMin)
+            s = f._sizeMin;
+        else if(d >= f._distMax)
+            s = f._sizeMax;
+        else
+            s = f._sizeMin + (f._sizeMax - f._sizeMin) * (d - f._distMin) / (f._distMax - f._distMin);
+        size = std::min(size, s);
+    }
+    return size;
+}
+
+inline void SizeField::registerCallback()
+{
+    gmsh::model::mesh::setSizeCallback([this](int, int, double x, double y, double, double) {
+        const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+        const double size = evaluate(x, y);
+        const unsigned long long ns = (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+        _calls++;
+        _nanoseconds += ns;
+        unsigned long long m = _maxNanoseconds;
+        while(ns > m && !_maxNanoseconds.compare_exchange_weak(m, ns)) {}
+        return size;
+    });
+}
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef SPARSITY_PATTERN_H
+#define SPARSITY_PATTERN_H
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include "elementTypes.h"
+#include "memoryUsage.h"
+#include "meshData.h"
+#include "parallelSort.h"
+#include "trace.h"
+
+
+/**
+ * Compressed sparse row (CSR) graph of the FEM matrix of one element block:
+ * two nodes are coupled when they share an element, every node couples with
+ * itself. Row r is getColumns()[getOffsets()[r] .. getOffsets()[r+1]),
+ * columns are sorted and unique.
+ *
+ * The rows are built in two parallel passes over the nodes, one counts the
+ * columns of every row and one fills them, through a node -> element table,
+ * so no set or per-row container is ever allocated.
+ *
+ * A TRIANGLE6 / TETRAHEDRON10 block gives the P2 stencil (all nodes of an
+ * element are coupled), verticesOnly = true keeps the P1 stencil of its corners.
+ * With blockSize b every node has b unknowns, numbered node * b + component,
+ * and every coupled node pair gives a dense b x b block.
+ */
+class SparsityPattern
+{
+public:
+    SparsityPattern() : _numRows(0), _blockSize(1), _offsets(1, 0), _columns() {}
+    ~SparsityPattern() {}
+
+    // numNodes is the number of nodes of the mesh, block ids must be below it
+    void build(const ElementBlock& block, const std::size_t numNodes, const int blockSize = 1, const bool verticesOnly = false, const int numThreads = 0);
+    // the same with the stride known at compile time
+    template<int Type> void build(const TypedBlockView<Type>& block, const std::size_t numNodes, const int blockSize = 1, const bool verticesOnly = false, const int numThreads = 0);
+    void clear() {_numRows = 0; _blockSize = 1; _offsets.assign(1, 0); _columns.clear();}
+
+    std::size_t getNumRows() const {return _numRows;}
+    std::size_t getNumNonZeros() const {return _columns.size();}
+    int getBlockSize() const {return _blockSize;}
+    std::size_t getRowSize(const std::size_t r) const {return _offsets[r+1] - _offsets[r];}
+    const CountedVector<std::size_t>& getOffsets() const {return _offsets;}
+    const CountedVector<unsigned int>& getColumns() const {return _columns;}
+    // position of column c in row r, -1 if (r, c) is not in the pattern
+    long long find(const std::size_t r, const unsigned int c) const;
+    // bytes of the offsets and columns arrays
+    std::size_t getMemory() const {return _offsets.capacity() * sizeof(std::size_t) + _columns.capacity() * sizeof(unsigned int);}
+
+private:
+    // visitBlock() visitor of build(), calls the typed build() once per block
+    struct Builder
+    {
+        SparsityPattern* _pattern;
+        std::size_t _numNodes;
+        int _blockSize;
+        bool _verticesOnly;
+        int _numThreads;
+        template<int Type> void operator () (const TypedBlockView<Type>& block)
+        {
+            _pattern->build(block, _numNodes, _blockSize, _verticesOnly, _numThreads);
+        }
+    };
+
+    std::size_t _numRows;
+    int _blockSize;
+    CountedVector<std::size_t> _offsets;
+    CountedVector<unsigned int> _columns;
+};
+
+
+inline void SparsityPattern::build(const ElementBlock& block, const std::size_t numNodes, const int blockSize, const bool verticesOnly, const int numThreads)
+{
+    Builder builder = {this, numNodes, blockSize, verticesOnly, numThreads};
+    if(!visitBlock(block, builder))
+        clear();
+}
+
+template<int Type> inline void SparsityPattern::build(const TypedBlockView<Type>& block, const std::size_t numNodes, const int blockSize, const bool verticesOnly, const int numThreads)
+{
+    TRACE_SCOPE("SparsityPattern::build");
+    const std::size_t numElements = block.size();
+    const int k = verticesOnly ? ElementTraits<Type>::numVertices : ElementTraits<Type>::numNodes;
+    const std::size_t bs = blockSize > 0 ? blockSize : 1;
+
+    // node -> element table, counted then filled like the rows below
+    std::vector<std::size_t> elementOffsets(numNodes + 1, 0);
+    for(std::size_t e = 0; e < numElements; e++)
+    {
+        for(int j = 0; j < k; j++)
+        {
+            elementOffsets[block.node(e, j)+1]++;
+        }
+    }
+    for(std::size_t i = 0; i < numNodes; i++)
+    {
+        elementOffsets[i+1] += elementOffsets[i];
+    }
+    std::vector<unsigned int> elements(elementOffsets[numNodes]);
+    {
+        std::vector<std::size_t> cursor(elementOffsets.begin(), elementOffsets.end() - 1);
+        for(std::size_t e = 0; e < numElements; e++)
+        {
+            for(int j = 0; j < k; j++)
+            {
+                elements[cursor[block.node(e, j)]++] = (unsigned int)e;
+            }
+        }
+    }
+
+    // sorted unique neighbours of node i, the node itself included
+    auto gather = [&](const std::size_t i, std::vector<unsigned int>& row) {
+        row.clear();
+        row.push_back((unsigned int)i);
+        for(std::size_t p = elementOffsets[i]; p < elementOffsets[i+1]; p++)
+        {
+            const unsigned int* ele = block.nodes(elements[p]);
+            row.insert(row.end(), ele, ele + k);
+        }
+        std::sort(row.begin(), row.end());
+        row.erase(std::unique(row.begin(), row.end()), row.end());
+    };
+
+    // pass 1: number of neighbours of every node
+    std::vector<std::size_t> nodeOffsets(numNodes + 1, 0);
+    parallelFor(numNodes, numThreads, [&](int, std::size_t b, std::size_t e) {
+        std::vector<unsigned int> row;
+        for(std::size_t i = b; i < e; i++)
+        {
+            gather(i, row);
+            nodeOffsets[i+1] = row.size();
+        }
+    });
+    for(std::size_t i = 0; i < numNodes; i++)
+    {
+        nodeOffsets[i+1] += nodeOffsets[i];
+    }
+
+    // pass 2: the bs rows of node i start at nodeOffsets[i] * bs * bs and hold
+    // bs columns per neighbour
+    _numRows = numNodes * bs;
+    _blockSize = (int)bs;
+    _offsets.resize(_numRows + 1);
+    _columns.resize(nodeOffsets[numNodes] * bs * bs);
+    _offsets[_numRows] = _columns.size();
+    parallelFor(numNodes, numThreads, [&](int, std::size_t b, std::size_t e) {
+        std::vector<unsigned int> row;
+        for(std::size_t i = b; i < e; i++)
+        {
+            gather(i, row);
+            const std::size_t width = row.size() * bs;
+            for(std::size_t a = 0; a < bs; a++)
+            {
+                const std::size_t first = nodeOffsets[i] * bs * bs + a * width;
+                _offsets[i*bs+a] = first;
+                for(std::size_t j = 0; j < row.size(); j++)
+                {
+                    for(std::size_t c = 0; c < bs; c++)
+                    {
+                        _columns[first+j*bs+c] = (unsigned int)(row[j] * bs + c);
+                    }
+                }
+            }
+        }
+    });
+}
+
+inline long long SparsityPattern::find(const std::size_t r, const unsigned int c) const
+{
+    CountedVector<unsigned int>::const_iterator b = _columns.begin() + _offsets[r], e = _columns.begin() + _offsets[r+1];
+    CountedVector<unsigned int>::const_iterator it = std::lower_bound(b, e, c);
+    if(it == e || *it != c)
+        return -1;
+    return (long long)(it - _columns.begin());
+}
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef STIFFNESS_ASSEMBLY_H
+#define STIFFNESS_ASSEMBLY_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include "elementTypes.h"
+#include "meshData.h"
+#include "parallelSort.h"
+#include "sparsityPattern.h"
+#include "trace.h"
+
+
+/**
+ * Greedy colouring of chunks of consecutive elements: no two chunks of one
+ * colour share a node, so the chunks of a colour can add into a matrix from
+ * several threads without atomics, and every thread walks consecutive
+ * elements (local in memory after a MeshReorder). chunkSize = 1 is the
+ * classic element colouring.
+ * Colours are found 64 at a time with one bit mask per node, chunks left
+ * over when all 64 are taken get the next 64.
+ * The chunks of colour c are getChunks()[getOffsets()[c] .. getOffsets()[c+1]),
+ * chunk q holds the elements [q * chunkSize, min((q + 1) * chunkSize, size)).
+ */
+class ElementColouring
+{
+public:
+    ElementColouring() : _numElements(0), _chunkSize(1), _offsets(1, 0), _chunks() {}
+    ~ElementColouring() {}
+
+    // only the vertices of the block are used
+    void build(const ElementBlock& block, const std::size_t numNodes, const std::size_t chunkSize = 256);
+    // the same with the stride known at compile time
+    template<int Type> void build(const TypedBlockView<Type>& block, const std::size_t numNodes, const std::size_t chunkSize = 256);
+    void clear() {_numElements = 0; _chunkSize = 1; _offsets.assign(1, 0); _chunks.clear();}
+
+    int getNumColours() const {return (int)_offsets.size() - 1;}
+    std::size_t getChunkSize() const {return _chunkSize;}
+    std::size_t getNumChunks(const int c) const {return _offsets[c+1] - _offsets[c];}
+    // first and one past the last element of chunk q
+    std::size_t getChunkBegin(const std::size_t q) const {return q * _chunkSize;}
+    std::size_t getChunkEnd(const std::size_t q) const {return std::min((q + 1) * _chunkSize, _numElements);}
+    const std::vector<std::size_t>& getOffsets() const {return _offsets;}
+    const std::vector<unsigned int>& getChunks() const {return _chunks;}
+
+private:
+    // visitBlock() visitor of build(), calls the typed build() once per block
+    struct Builder
+    {
+        ElementColouring* _colouring;
+        std::size_t _numNodes, _chunkSize;
+        template<int Type> void operator () (const TypedBlockView<Type>& block)
+        {
+            _colouring->build(block, _numNodes, _chunkSize);
+        }
+    };
+
+    std::size_t _numElements, _chunkSize;
+    std::vector<std::size_t> _offsets;
+    std::vector<unsigned int> _chunks;
+};
+
+
+inline void ElementColouring::build(const ElementBlock& block, const std::size_t numNodes, const std::size_t chunkSize)
+{
+    Builder builder = {this, numNodes, chunkSize};
+    if(!visitBlock(block, builder))
+        clear();
+}
+
+template<int Type> inline void ElementColouring::build(const TypedBlockView<Type>& block, const std::size_t numNodes, const std::size_t chunkSize)
+{
+    TRACE_SCOPE("ElementColouring::build");
+    _numElements = block.size();
+    _chunkSize = chunkSize > 0 ? chunkSize : 1;
+    const std::size_t n = (_numElements + _chunkSize - 1) / _chunkSize;
+    const int k = ElementTraits<Type>::numVertices;
+
+    std::vector<int> colour(n, -1);
+    std::vector<unsigned long long> used;
+    std::vector<unsigned int> remaining(n), next;
+    for(std::size_t q = 0; q < n; q++)
+    {
+        remaining[q] = (unsigned int)q;
+    }
+    int base = 0, numColours = 0;
+    while(!remaining.empty())
+    {
+        used.assign(numNodes, 0ULL);
+        next.clear();
+        for(std::size_t r = 0; r < remaining.size(); r++)
+        {
+            const std::size_t b = getChunkBegin(remaining[r]), e = getChunkEnd(remaining[r]);
+            unsigned long long mask = 0;
+            for(std::size_t p = b; p < e; p++)
+            {
+                for(int j = 0; j < k; j++)
+                {
+                    mask |= used[block.node(p, j)];
+                }
+            }
+            if(mask == ~0ULL)
+            {
+                next.push_back(remaining[r]);
+                continue;
+            }
+            int c = 0;
+            while(mask & 1ULL)
+            {
+                mask >>= 1;
+                c++;
+            }
+            for(std::size_t p = b; p < e; p++)
+            {
+                for(int j = 0; j < k; j++)
+                {
+                    used[block.node(p, j)] |= 1ULL << c;
+                }
+            }
+            colour[remaining[r]] = base + c;
+            numColours = std::max(numColours, base + c + 1);
+        }
+        remaining.swap(next);
+        base += 64;
+    }
+
+    // counting sort of the chunks by colour
+    _offsets.assign(numColours + 1, 0);
+    for(std::size_t q = 0; q < n; q++)
+    {
+        _offsets[colour[q]+1]++;
+    }
+    for(int c = 0; c < numColours; c++)
+    {
+        _offsets[c+1] += _offsets[c];
+    }
+    _chunks.resize(n);
+    std::vector<std::size_t> cursor(_offsets.begin(), _offsets.end() - 1);
+    for(std::size_t q = 0; q < n; q++)
+    {
+        _chunks[cursor[colour[q]]++] = (unsigned int)q;
+    }
+}
+
+
+// elements computed together by the assembly kernel, the lane loops below are
+// written over fixed size arrays so the compiler can vectorize them
+const int ASSEMBLY_BATCH = 8;
+
+// add the 3 x 3 element matrix k to the rows of the nodes v of one triangle
+inline void scatterTriangle(const SparsityPattern& pattern, const unsigned int v[3], const double k[9], std::vector<double>& values)
+{
+    const CountedVector<std::size_t>& offsets = pattern.getOffsets();
+    const CountedVector<unsigned int>& columns = pattern.getColumns();
+    for(int i = 0; i < 3; i++)
+    {
+        const unsigned int* b = &columns[0] + offsets[v[i]];
+        const unsigned int* e = &columns[0] + offsets[v[i]+1];
+        for(int j = 0; j < 3; j++)
+        {
+            values[std::lower_bound(b, e, v[j]) - &columns[0]] += k[3*i+j];
+        }
+    }
+}
+
+/**
+ * P1 Laplace stiffness matrix of a triangle block (x / y coordinates) into
+ * values, laid out on pattern (a scalar pattern of the same block).
+ * Colours are assembled one after the other, the chunks of one colour are
+ * split over the threads and their elements taken ASSEMBLY_BATCH at a time:
+ * coordinates are gathered into lane arrays, the Jacobians, gradients and
+ * element matrices of the batch computed lane by lane, then scattered into
+ * the matrix.
+ */
+template<int Type> inline void assembleStiffness(const MeshData& mesh, const TypedBlockView<Type>& triangles, const ElementColouring& colouring, const SparsityPattern& pattern, std::vector<double>& values, const int numThreads = 0)
+{
+    static_assert(ElementTraits<Type>::dim == 2 && ElementTraits<Type>::numVertices == 3, "the P1 stiffness needs triangles");
+    const std::vector<unsigned int>& chunks = colouring.getChunks();
+    const double* X = mesh.getXs().empty() ? 0 : &mesh.getXs()[0];
+    const double* Y = mesh.getYs().empty() ? 0 : &mesh.getYs()[0];
+    values.assign(pattern.getNumNonZeros(), 0.0);
+    for(int c = 0; c < colouring.getNumColours(); c++)
+    {
+        const std::size_t first = colouring.getOffsets()[c];
+        parallelFor(colouring.getNumChunks(c), numThreads, [&](int, std::size_t qb, std::size_t qe) {
+            const int W = ASSEMBLY_BATCH;
+            unsigned int v[W][3];
+            double x[3][W], y[3][W], k[9][W];
+            for(std::size_t q = qb; q < qe; q++)
+            {
+                const std::size_t b = colouring.getChunkBegin(chunks[first+q]), e = colouring.getChunkEnd(chunks[first+q]);
+                for(std::size_t s = b; s < e; s += W)
+                {
+                    const int m = (int)std::min<std::size_t>(W, e - s);
+                    for(int l = 0; l < W; l++)
+                    {
+                        // a short last batch repeats its first element, the extra lanes are not scattered
+                        const unsigned int* ele = triangles.nodes(s + (l < m ? l : 0));
+                        for(int a = 0; a < 3; a++)
+                        {
+                            v[l][a] = ele[a];
+                            x[a][l] = X[ele[a]];
+                            y[a][l] = Y[ele[a]];
+                        }
+                    }
+                    for(int l = 0; l < W; l++)
+                    {
+                        // gradient of vertex a is (gy[a], gx[a]) / det, the area is |det| / 2
+                        const double gy0 = y[1][l] - y[2][l], gy1 = y[2][l] - y[0][l], gy2 = y[0][l] - y[1][l];
+                        const double gx0 = x[2][l] - x[1][l], gx1 = x[0][l] - x[2][l], gx2 = x[1][l] - x[0][l];
+                        const double det = gx2 * gy1 - gx1 * gy2;
+                        const double s2 = 0.5 / std::fabs(det);
+                        k[0][l] = (gy0 * gy0 + gx0 * gx0) * s2;
+                        k[1][l] = (gy0 * gy1 + gx0 * gx1) * s2;
+                        k[2][l] = (gy0 * gy2 + gx0 * gx2) * s2;
+                        k[4][l] = (gy1 * gy1 + gx1 * gx1) * s2;
+                        k[5][l] = (gy1 * gy2 + gx1 * gx2) * s2;
+                        k[8][l] = (gy2 * gy2 + gx2 * gx2) * s2;
+                        k[3][l] = k[1][l];
+                        k[6][l] = k[2][l];
+                        k[7][l] = k[5][l];
+                    }
+                    for(int l = 0; l < m; l++)
+                    {
+                        double ke[9];
+                        for(int a = 0; a < 9; a++)
+                        {
+                            ke[a] = k[a][l];
+                        }
+                        scatterTriangle(pattern, v[l], ke, values);
+                    }
+                }
+            }
+        }, 4);
+    }
+}
+
+// triangles must be a TRIANGLE or TRIANGLE6 block, any other block gives a zero matrix
+inline void assembleStiffness(const MeshData& mesh, const ElementBlock& triangles, const ElementColouring& colouring, const SparsityPattern& pattern, std::vector<double>& values, const int numThreads = 0)
+{
+    switch(triangles.getType())
+    {
+        case TRIANGLE: assembleStiffness(mesh, triangles.view<TRIANGLE>(), colouring, pattern, values, numThreads); break;
+        case TRIANGLE6: assembleStiffness(mesh, triangles.view<TRIANGLE6>(), colouring, pattern, values, numThreads); break;
+        default: values.assign(pattern.getNumNonZeros(), 0.0);
+    }
+}
+
+// the same matrix, one element after the other on one thread
+template<int Type> inline void assembleStiffnessSerial(const MeshData& mesh, const TypedBlockView<Type>& triangles, const SparsityPattern& pattern, std::vector<double>& values)
+{
+    static_assert(ElementTraits<Type>::dim == 2 && ElementTraits<Type>::numVertices == 3, "the P1 stiffness needs triangles");
+    values.assign(pattern.getNumNonZeros(), 0.0);
+    for(std::size_t e = 0; e < triangles.size(); e++)
+    {
+        const unsigned int v[3] = {triangles.node(e, 0), triangles.node(e, 1), triangles.node(e, 2)};
+        double b[3], c[3];
+        for(int a = 0; a < 3; a++)
+        {
+            const unsigned int p = v[(a+1)%3], q = v[(a+2)%3];
+            b[a] = mesh.getY(p) - mesh.getY(q);
+            c[a] = mesh.getX(q) - mesh.getX(p);
+        }
+        const double area = 0.5 * std::fabs(b[0] * c[1] - b[1] * c[0]);
+        double k[9];
+        for(int i = 0; i < 3; i++)
+        {
+            for(int j = 0; j < 3; j++)
+            {
+                k[3*i+j] = (b[i] * b[j] + c[i] * c[j]) / (4 * area);
+            }
+        }
+        scatterTriangle(pattern, v, k, values);
+    }
+}
+
+inline void assembleStiffnessSerial(const MeshData& mesh, const ElementBlock& triangles, const SparsityPattern& pattern, std::vector<double>& values)
+{
+    switch(triangles.getType())
+    {
+        case TRIANGLE: assembleStiffnessSerial(mesh, triangles.view<TRIANGLE>(), pattern, values); break;
+        case TRIANGLE6: assembleStiffnessSerial(mesh, triangles.view<TRIANGLE6>(), pattern, values); break;
+        default: values.assign(pattern.getNumNonZeros(), 0.0);
+    }
+}
+
+#endif
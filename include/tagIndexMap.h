@@ -0,0 +1,123 @@
+#ifndef TAG_INDEX_MAP_H
+#define TAG_INDEX_MAP_H
+
+#include <vector>
+#include <cstddef>
+#include "meshHash.h"
+#include "memoryUsage.h"
+
+
+/**
+ * gmsh tag -> compact 0-based index.
+ *
+ * Tags are only dense and 1-based on a freshly generated mesh; after
+ * refinement, partial meshing or a merge they have gaps. When the tag range is
+ * at most denseFactor times the number of tags the map is a flat
+ * direct-address table, otherwise a linear probing hash table with 2^k slots.
+ */
+class TagIndexMap
+{
+public:
+    static const unsigned int npos = (unsigned int)-1;
+
+    TagIndexMap() : _minTag(0), _dense(true), _table(), _keys(), _values(), _mask(0), _size(0) {}
+    ~TagIndexMap() {}
+
+    // index i is given to tags[i]; a repeated tag keeps its first index. Tags is a
+    // vector of std::size_t, from gmsh or a CountedVector
+    template<class Tags> void build(const Tags& tags, const double denseFactor = 4);
+    // index of tag, npos if the tag is unknown
+    unsigned int find(const std::size_t tag) const
+    {
+        if(_dense)
+        {
+            const std::size_t i = tag - _minTag;
+            return tag >= _minTag && i < _table.size() ? _table[i] : npos;
+        }
+        for(std::size_t slot = mixHash(tag) & _mask; ; slot = (slot + 1) & _mask)
+        {
+            if(_keys[slot] == tag)
+                return _values[slot];
+            if(_keys[slot] == 0)
+                return npos;
+        }
+    }
+    // indices of a whole tag list, e.g. a connectivity block or a boundary node list
+    template<class Tags, class Ids> void map(const Tags& tags, Ids& ids) const
+    {
+        ids.resize(tags.size());
+        for(std::size_t i = 0; i < tags.size(); i++)
+        {
+            ids[i] = find(tags[i]);
+        }
+    }
+
+    bool isDense() const {return _dense;}
+    std::size_t size() const {return _size;}
+    // bytes used by the table
+    std::size_t memory() const {return _table.size()*sizeof(unsigned int) + _keys.size()*sizeof(std::size_t) + _values.size()*sizeof(unsigned int);}
+    void clear()
+    {
+        _table.clear();
+        _keys.clear();
+        _values.clear();
+        _size = 0;
+        _dense = true;
+    }
+
+private:
+    std::size_t _minTag;
+    bool _dense;
+    CountedVector<unsigned int> _table;
+    // tag 0 marks an empty slot, gmsh tags start at 1
+    CountedVector<std::size_t> _keys;
+    CountedVector<unsigned int> _values;
+    std::size_t _mask, _size;
+};
+
+
+template<class Tags> inline void TagIndexMap::build(const Tags& tags, const double denseFactor)
+{
+    clear();
+    _size = tags.size();
+    if(tags.empty())
+        return;
+    std::size_t minTag = tags[0], maxTag = tags[0];
+    for(std::size_t i = 1; i < tags.size(); i++)
+    {
+        if(tags[i] < minTag) minTag = tags[i];
+        if(tags[i] > maxTag) maxTag = tags[i];
+    }
+    _minTag = minTag;
+    _dense = (double)(maxTag - minTag + 1) <= denseFactor * tags.size();
+    if(_dense)
+    {
+        _table.assign(maxTag - minTag + 1, (unsigned int)npos);
+        for(std::size_t i = 0; i < tags.size(); i++)
+        {
+            unsigned int& id = _table[tags[i] - minTag];
+            if(id == npos)
+                id = (unsigned int)i;
+        }
+        return;
+    }
+    std::size_t capacity = 16;
+    while(capacity < 2 * tags.size())
+        capacity *= 2;
+    _mask = capacity - 1;
+    _keys.assign(capacity, 0);
+    _values.assign(capacity, (unsigned int)npos);
+    for(std::size_t i = 0; i < tags.size(); i++)
+    {
+        std::size_t slot = mixHash(tags[i]) & _mask;
+        while(_keys[slot] != 0 && _keys[slot] != tags[i])
+            slot = (slot + 1) & _mask;
+        if(_keys[slot] == 0)
+        {
+            _keys[slot] = tags[i];
+            _values[slot] = (unsigned int)i;
+        }
+    }
+}
+
+#endif
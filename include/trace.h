@@ -0,0 +1,330 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <string>
+#include <set>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <fstream>
+#include <ostream>
+#include <cstdio>
+#include <cstddef>
+#include <unistd.h>
+
+
+// one finished scope, times in nanoseconds since the tracer was created
+struct TraceEvent
+{
+    const char* _name;
+    unsigned long long _begin, _duration;
+    // shown as args.n in the trace, -1 for none
+    long long _arg;
+};
+
+
+/**
+ * Ring of the events of one thread. It grows up to its capacity, then the
+ * newest event overwrites the oldest one. Only the owning thread writes it.
+ */
+class TraceBuffer
+{
+public:
+    TraceBuffer(const int index, const std::size_t capacity) : _index(index), _name(), _capacity(capacity > 0 ? capacity : 1), _next(0), _count(0), _events() {}
+    ~TraceBuffer() {}
+
+    void record(const TraceEvent& e)
+    {
+        if(_events.size() < _capacity)
+            _events.push_back(e);
+        else
+            _events[_next] = e;
+        if(++_next == _capacity)
+            _next = 0;
+        _count++;
+    }
+    void clear()
+    {
+        _events.clear();
+        _next = 0;
+        _count = 0;
+    }
+
+    int getIndex() const {return _index;}
+    const std::string& getName() const {return _name;}
+    void setName(const std::string& name) {_name = name;}
+    std::size_t size() const {return _events.size();}
+    // events lost to the ring since the last clear()
+    unsigned long long getNumDropped() const {return _count - _events.size();}
+    // i-th event from the oldest one
+    const TraceEvent& getEvent(const std::size_t i) const {return _events[_events.size() < _capacity ? i : (_next + i) % _capacity];}
+
+private:
+    int _index;
+    std::string _name;
+    std::size_t _capacity, _next;
+    unsigned long long _count;
+    std::vector<TraceEvent> _events;
+};
+
+
+/**
+ * Scoped tracing, written as Chrome trace event JSON (chrome://tracing,
+ * ui.perfetto.dev).
+ *
+ * Every thread records into its own TraceBuffer, so recording takes no lock:
+ * a thread takes a buffer at its first event and gives it back when it ends,
+ * the next new thread reuses it (one trace row per concurrent thread rather
+ * than one per std::thread ever started). Disabled, a TraceScope costs one
+ * relaxed atomic load; built with -DNO_TRACE the macros are empty.
+ *
+ * Event names must outlive the tracer (string literals, or intern()).
+ * writeChromeTrace() reads every buffer, call it while no traced thread is
+ * running. Forked workers trace into their own copy of the process.
+ */
+class Tracer
+{
+public:
+    Tracer() : _enabled(false), _capacity(1 << 16), _origin(std::chrono::steady_clock::now()), _mutex(), _buffers(), _free(), _names() {}
+    ~Tracer()
+    {
+        for(std::size_t i = 0; i < _buffers.size(); i++)
+        {
+            delete _buffers[i];
+        }
+    }
+
+    // start recording, capacity is the number of events kept per thread for threads that did not trace yet
+    void enable(const std::size_t capacity = 1 << 16)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _capacity = capacity;
+        }
+        _enabled.store(true, std::memory_order_relaxed);
+    }
+    void disable() {_enabled.store(false, std::memory_order_relaxed);}
+    bool isEnabled() const {return _enabled.load(std::memory_order_relaxed);}
+    // drop the recorded events, the buffers stay with their threads
+    void clear()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for(std::size_t i = 0; i < _buffers.size(); i++)
+        {
+            _buffers[i]->clear();
+        }
+    }
+
+    unsigned long long now() const {return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _origin).count();}
+    void record(const char* name, const unsigned long long begin, const unsigned long long duration, const long long arg = -1)
+    {
+        TraceEvent e = {name, begin, duration, arg};
+        getThreadBuffer().record(e);
+    }
+    // a copy of name that lives as long as the tracer, for names built at run time
+    const char* intern(const std::string& name)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _names.insert(name).first->c_str();
+    }
+    // buffer of the calling thread, taken at its first call; scopes take it when they
+    // open so that a thread that ended can not hand its row to a scope still open
+    TraceBuffer& getThreadBuffer()
+    {
+        static thread_local ThreadSlot slot;
+        if(!slot._buffer)
+        {
+            slot._tracer = this;
+            slot._buffer = acquire();
+        }
+        return *slot._buffer;
+    }
+    // row name of the calling thread in the trace
+    void setThreadName(const std::string& name) {getThreadBuffer().setName(name);}
+
+    std::size_t getNumEvents() const;
+    unsigned long long getNumDropped() const;
+    void writeChromeTrace(std::ostream& out) const;
+    bool writeChromeTrace(const std::string& filename) const;
+
+private:
+    Tracer(const Tracer&);
+    Tracer& operator = (const Tracer&);
+
+    // gives the buffer back to the tracer when its thread ends
+    struct ThreadSlot
+    {
+        ThreadSlot() : _tracer(0), _buffer(0) {}
+        ~ThreadSlot() {if(_buffer) _tracer->release(_buffer);}
+        Tracer* _tracer;
+        TraceBuffer* _buffer;
+    };
+
+    TraceBuffer* acquire()
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(!_free.empty())
+        {
+            TraceBuffer* buffer = _free.back();
+            _free.pop_back();
+            return buffer;
+        }
+        _buffers.push_back(new TraceBuffer((int)_buffers.size(), _capacity));
+        return _buffers.back();
+    }
+    void release(TraceBuffer* buffer)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _free.push_back(buffer);
+    }
+
+    std::atomic<bool> _enabled;
+    std::size_t _capacity;
+    std::chrono::steady_clock::time_point _origin;
+    mutable std::mutex _mutex;
+    std::vector<TraceBuffer*> _buffers, _free;
+    std::set<std::string> _names;
+};
+
+inline Tracer& getTracer()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+
+inline std::size_t Tracer::getNumEvents() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::size_t n = 0;
+    for(std::size_t i = 0; i < _buffers.size(); i++)
+    {
+        n += _buffers[i]->size();
+    }
+    return n;
+}
+
+inline unsigned long long Tracer::getNumDropped() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    unsigned long long n = 0;
+    for(std::size_t i = 0; i < _buffers.size(); i++)
+    {
+        n += _buffers[i]->getNumDropped();
+    }
+    return n;
+}
+
+// name as a JSON string, names are code text so only quotes, backslashes and control characters need care
+inline void writeTraceString(std::ostream& out, const char* s)
+{
+    out<<'"';
+    for(; *s; s++)
+    {
+        if(*s == '"' || *s == '\\')
+            out<<'\\'<<*s;
+        else if((unsigned char)*s < 0x20)
+            out<<' ';
+        else
+            out<<*s;
+    }
+    out<<'"';
+}
+
+inline void Tracer::writeChromeTrace(std::ostream& out) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const int pid = (int)getpid();
+    char number[64];
+    out<<"{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+    bool first = true;
+    for(std::size_t b = 0; b < _buffers.size(); b++)
+    {
+        const TraceBuffer& buffer = *_buffers[b];
+        const std::string name = buffer.getName().empty() ? "thread " + std::to_string(b) : buffer.getName();
+        out<<(first ? "\n" : ",\n")<<"{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": "<<pid<<", \"tid\": "<<buffer.getIndex()<<", \"args\": {\"name\": ";
+        writeTraceString(out, name.c_str());
+        out<<"}}";
+        first = false;
+        for(std::size_t i = 0; i < buffer.size(); i++)
+        {
+            const TraceEvent& e = buffer.getEvent(i);
+            out<<",\n{\"name\": ";
+            writeTraceString(out, e._name);
+            // microseconds with the nanoseconds kept as decimals
+            std::snprintf(number, sizeof(number), "%llu.%03llu, \"dur\": %llu.%03llu", e._begin / 1000, e._begin % 1000, e._duration / 1000, e._duration % 1000);
+            out<<", \"ph\": \"X\", \"pid\": "<<pid<<", \"tid\": "<<buffer.getIndex()<<", \"ts\": "<<number;
+            if(e._arg >= 0)
+                out<<", \"args\": {\"n\": "<<e._arg<<"}";
+            out<<"}";
+        }
+    }
+    out<<"\n]}\n";
+}
+
+inline bool Tracer::writeChromeTrace(const std::string& filename) const
+{
+    std::ofstream out(filename.c_str());
+    if(!out)
+        return false;
+    writeChromeTrace(out);
+    return (bool)out;
+}
+
+
+// records the time from its construction to its destruction, when the tracer is enabled
+class TraceScope
+{
+public:
+    TraceScope(const char* name, const long long arg = -1) : _buffer(0), _name(name), _begin(0), _arg(arg)
+    {
+        if(getTracer().isEnabled())
+        {
+            _buffer = &getTracer().getThreadBuffer();
+            _begin = getTracer().now();
+        }
+    }
+    ~TraceScope()
+    {
+        if(_buffer)
+        {
+            TraceEvent e = {_name, _begin, getTracer().now() - _begin, _arg};
+            _buffer->record(e);
+        }
+    }
+
+private:
+    TraceScope(const TraceScope&);
+    TraceScope& operator = (const TraceScope&);
+
+    TraceBuffer* _buffer;
+    const char* _name;
+    unsigned long long _begin;
+    long long _arg;
+};
+
+// f() inside a scope named name, returns what f returns
+template<class F> auto traceCall(const char* name, F f) -> decltype(f())
+{
+    TraceScope scope(name);
+    return f();
+}
+
+#define TRACE_JOIN2(a, b) a##b
+#define TRACE_JOIN(a, b) TRACE_JOIN2(a, b)
+#ifdef NO_TRACE
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_ARG(name, arg)
+#define TRACE_CALL(call) (call)
+#else
+// traces the rest of the enclosing block
+#define TRACE_SCOPE(name) TraceScope TRACE_JOIN(traceScope, __LINE__)(name)
+// the same with an integer shown in the event, e.g. an entity tag or a loop index
+#define TRACE_SCOPE_ARG(name, arg) TraceScope TRACE_JOIN(traceScope, __LINE__)(name, (long long)(arg))
+// traces one call, named by its source text: TRACE_CALL(gmsh::model::mesh::generate(2))
+#define TRACE_CALL(call) traceCall(#call, [&]() {return call;})
+#endif
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef VERTEX_WELDER_H
+#define VERTEX_WELDER_H
+
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <cmath>
+#include <cstddef>
+#include "meshHash.h"
+#include "memoryUsage.h"
+
+
+/**
+ * Grid hash that welds vertices closer than epsilon, in 3D.
+ *
+ * Space is cut into cubic cells of size 16 epsilon and a query searches every
+ * cell its epsilon box overlaps: one cell most of the time, at most 2 x 2 x 2
+ * near cell boundaries. Welding is therefore correct across cell boundaries
+ * and costs amortized O(1) per vertex.
+ * The first vertex inserted in a cluster is kept as its representative.
+ */
+class VertexWelder
+{
+public:
+    VertexWelder(const double epsilon = 1e-9) : _epsilon(epsilon > 0 ? epsilon : 1e-9), _cellSize(16 * _epsilon), _cells(), _x(), _y(), _z(), _next() {}
+    ~VertexWelder() {}
+
+    // id of the vertex within epsilon of (x, y, z), -1 if there is none
+    int find(const double x, const double y, const double z) const;
+    // id of the welded vertex, a new id is added if no vertex is within epsilon
+    int insert(const double x, const double y, const double z, bool* isNew = 0);
+
+    std::size_t size() const {return _x.size();}
+    double getEpsilon() const {return _epsilon;}
+    double getX(const int id) const {return _x[id];}
+    double getY(const int id) const {return _y[id];}
+    double getZ(const int id) const {return _z[id];}
+    void reserve(const std::size_t n);
+    void clear();
+
+private:
+    struct Cell
+    {
+        long long _i, _j, _k;
+        bool operator == (const Cell& c) const {return _i == c._i && _j == c._j && _k == c._k;}
+    };
+    struct CellHash
+    {
+        std::size_t operator () (const Cell& c) const
+        {
+            // cell indices of welded coordinates are large and regular, mix every bit
+            unsigned long long h = mixHash((unsigned long long)c._i);
+            h = mixHash(h ^ (unsigned long long)c._j);
+            h = mixHash(h ^ (unsigned long long)c._k);
+            return (std::size_t)h;
+        }
+    };
+    Cell cellOf(const double x, const double y, const double z) const
+    {
+        Cell c = {cellIndex(x), cellIndex(y), cellIndex(z)};
+        return c;
+    }
+    // floor(v / cellSize) clamped to +-2^62 (NaN to the low end) before the cast, which is undefined
+    // out of the long long range; far coordinates share the edge cells and are still welded exactly
+    long long cellIndex(const double v) const
+    {
+        const double limit = 4611686018427387904.0, c = std::floor(v / _cellSize);
+        if(!(c > -limit))
+            return -(long long)limit;
+        return c < limit ? (long long)c : (long long)limit;
+    }
+
+    typedef std::unordered_map<Cell, int, CellHash, std::equal_to<Cell>, CountingAllocator<std::pair<const Cell, int> > > CellMap;
+
+    double _epsilon, _cellSize;
+    // cell -> first vertex id, the other vertices of the cell follow through _next
+    CellMap _cells;
+    std::vector<double, CountingAllocator<double> > _x, _y, _z;
+    std::vector<int, CountingAllocator<int> > _next;
+};
+
+
+inline int VertexWelder::find(const double x, const double y, const double z) const
+{
+    const Cell lo = cellOf(x - _epsilon, y - _epsilon, z - _epsilon);
+    const Cell hi = cellOf(x + _epsilon, y + _epsilon, z + _epsilon);
+    const double eps2 = _epsilon * _epsilon;
+    for(long long i = lo._i; i <= hi._i; i++)
+    {
+        for(long long j = lo._j; j <= hi._j; j++)
+        {
+            for(long long k = lo._k; k <= hi._k; k++)
+            {
+                Cell n = {i, j, k};
+                CellMap::const_iterator iter = _cells.find(n);
+                if(iter == _cells.end())
+                    continue;
+                for(int id = iter->second; id >= 0; id = _next[id])
+                {
+                    const double dx = _x[id] - x, dy = _y[id] - y, dz = _z[id] - z;
+                    if(dx*dx + dy*dy + dz*dz <= eps2)
+                        return id;
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+inline int VertexWelder::insert(const double x, const double y, const double z, bool* isNew)
+{
+    int id = find(x, y, z);
+    if(isNew)
+        *isNew = id < 0;
+    if(id >= 0)
+        return id;
+
+    id = (int)_x.size();
+    _x.push_back(x);
+    _y.push_back(y);
+    _z.push_back(z);
+    std::pair<CellMap::iterator, bool> res = _cells.insert(std::make_pair(cellOf(x, y, z), id));
+    _next.push_back(res.second ? -1 : res.first->second);
+    res.first->second = id;
+    return id;
+}
+
+inline void VertexWelder::reserve(const std::size_t n)
+{
+    _cells.reserve(n);
+    _x.reserve(n);
+    _y.reserve(n);
+    _z.reserve(n);
+    _next.reserve(n);
+}
+
+inline void VertexWelder::clear()
+{
+    _cells.clear();
+    _x.clear();
+    _y.clear();
+    _z.clear();
+    _next.clear();
+}
+
+
+/**
+ * Hashed table of the geometry lines between welded vertices.
+ * A line is stored once; find() returns its tag signed for the requested
+ * direction, so (a, b) gives tag and (b, a) gives -tag.
+ */
+class EdgeTable
+{
+public:
+    EdgeTable() : _lines() {}
+    ~EdgeTable() {}
+
+    // signed tag of the line a -> b, 0 if it does not exist
+    int find(const int a, const int b) const
+    {
+        LineMap::const_iterator iter = _lines.find(EdgeKey(a, b));
+        if(iter == _lines.end())
+            return 0;
+        return a <= b ? iter->second : -iter->second;
+    }
+    // record the line a -> b with the given tag
+    void insert(const int a, const int b, const int tag)
+    {
+        _lines[EdgeKey(a, b)] = a <= b ? tag : -tag;
+    }
+    std::size_t size() const {return _lines.size();}
+    void reserve(const std::size_t n) {_lines.reserve(n);}
+    void clear() {_lines.clear();}
+
+private:
+    typedef std::unordered_map<EdgeKey, int, EdgeKeyHash, std::equal_to<EdgeKey>, CountingAllocator<std::pair<const EdgeKey, int> > > LineMap;
+
+    LineMap _lines;
+};
+
+#endif